@@ -1,3 +1,11 @@
 FILE(READ ${SRC1} S1)
 FILE(READ ${SRC2} S2)
-FILE(WRITE ${DST} "${S1}\n${S2}")
\ No newline at end of file
+#Expand the #include "file" lines of the shader, relative to its directory
+get_filename_component(SRC2_DIR ${SRC2} DIRECTORY)
+string(REGEX MATCHALL "#include \"[^\"]+\"" INCLUDES "${S2}")
+foreach(INCLUDE ${INCLUDES})
+	string(REGEX REPLACE "#include \"([^\"]+)\"" "\\1" INCLUDE_NAME "${INCLUDE}")
+	FILE(READ ${SRC2_DIR}/${INCLUDE_NAME} INCLUDE_SOURCE)
+	string(REPLACE "${INCLUDE}" "${INCLUDE_SOURCE}" S2 "${S2}")
+endforeach(INCLUDE)
+FILE(WRITE ${DST} "${S1}\n${S2}")
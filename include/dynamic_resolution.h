@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <graphics.h>
+
+//Offscreen HDR target the drawing programs render into at a varying resolution, then upscaled to the window.
+//The render scale follows the GPU time of the scene read back from timer queries a few frames late, so the
+//queries never stall. The target is allocated with some slack over the window size and the frame only uses its
+//bottom left corner, a new scale or a small window resize changes the viewport and not the allocation.
+class DynamicResolution
+{
+public:
+	static constexpr int queryNmb = 4;
+
+	void Init();
+	void Destroy();
+	//Bind the target and set the viewport to the render size, stored in the configuration render size
+	void Begin(int windowWidth, int windowHeight);
+	//Stop the GPU timing of the scene
+	void End();
+	//Bilinear upscale and sharpening of the frame to the currently bound framebuffer
+	void Present(int windowWidth, int windowHeight);
+	//Same from a frame already resolved at the window size, e.g. by the TAA, only sharpened
+	void Present(int windowWidth, int windowHeight, unsigned texture, const glm::vec2& uvScale, const glm::vec2& textureSize);
+	void UpdateUi();
+
+	unsigned GetFramebuffer() const { return fbo; }
+	unsigned GetColorTexture() const { return colorTexture; }
+	unsigned GetDepthTexture() const { return depthTexture; }
+	//Allocated size, larger or equal to the render size
+	int GetTargetWidth() const { return targetWidth; }
+	int GetTargetHeight() const { return targetHeight; }
+	float GetRenderScale() const { return renderScale; }
+	float GetGpuTime() const { return gpuTime; }
+
+	bool& GetEnable() { return enable; }
+	float& GetTargetGpuTime() { return targetGpuTime; }
+	float& GetSharpness() { return sharpness; }
+private:
+	void ResizeTarget(int width, int height);
+	void Upscale(int windowWidth, int windowHeight, unsigned texture, const glm::vec2& uvScale, const glm::vec2& textureSize, float frameSharpness);
+	void UpdateScale();
+
+	Shader upscaleShader;
+	unsigned emptyVao = 0;
+	unsigned fbo = 0;
+	unsigned colorTexture = 0;
+	unsigned depthTexture = 0;
+	int targetWidth = 0;
+	int targetHeight = 0;
+	int renderWidth = 0;
+	int renderHeight = 0;
+
+	unsigned queries[queryNmb] = {};
+	bool queryPending[queryNmb] = {};
+	int queryIndex = 0;
+	bool timedFrame = false;
+
+	bool enable = true;
+	//Milliseconds of GPU time the scene should take
+	float targetGpuTime = 14.0f;
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+	float renderScale = 1.0f;
+	//Smoothed GPU time of the scene in milliseconds
+	float gpuTime = 0.0f;
+	//Frames left before the scale may change again, the downstream targets follow the render size
+	int cooldown = 0;
+	float sharpness = 0.5f;
+};
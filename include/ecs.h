@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+#include <job_system.h>
+
+using Entity = uint32_t;
+const Entity invalidEntity = UINT32_MAX;
+
+//Sparse set: the components are packed in a dense array, the sparse array maps an entity to its dense index.
+//Removing swaps the last component in the hole so the dense array never has gaps.
+template<typename T>
+class ComponentPool
+{
+public:
+	T& Add(Entity entity, const T& component)
+	{
+		if (entity >= sparse.size())
+			sparse.resize(entity + 1, invalidIndex);
+		if (sparse[entity] != invalidIndex)
+			return components[sparse[entity]] = component;
+		sparse[entity] = (uint32_t)dense.size();
+		dense.push_back(entity);
+		components.push_back(component);
+		return components.back();
+	}
+	void Remove(Entity entity)
+	{
+		if (!Has(entity))
+			return;
+		const uint32_t index = sparse[entity];
+		const Entity last = dense.back();
+		dense[index] = last;
+		components[index] = components.back();
+		sparse[last] = index;
+		dense.pop_back();
+		components.pop_back();
+		sparse[entity] = invalidIndex;
+	}
+	bool Has(Entity entity) const { return entity < sparse.size() && sparse[entity] != invalidIndex; }
+	T& Get(Entity entity) { return components[sparse[entity]]; }
+	const T& Get(Entity entity) const { return components[sparse[entity]]; }
+	void Clear()
+	{
+		sparse.clear();
+		dense.clear();
+		components.clear();
+	}
+
+	size_t GetSize() const { return dense.size(); }
+	const std::vector<Entity>& GetEntities() const { return dense; }
+	std::vector<T>& GetComponents() { return components; }
+	const std::vector<T>& GetComponents() const { return components; }
+private:
+	static constexpr uint32_t invalidIndex = UINT32_MAX;
+	std::vector<uint32_t> sparse;
+	std::vector<Entity> dense;
+	std::vector<T> components;
+};
+
+//Entities and one pool per component type known at compile time.
+//Systems iterate the dense array of their first component and look the others up,
+//entities created together with the same components keep the same order in every pool.
+template<typename... Components>
+class Registry
+{
+public:
+	Entity Create()
+	{
+		if (!freeEntities.empty())
+		{
+			const Entity entity = freeEntities.back();
+			freeEntities.pop_back();
+			return entity;
+		}
+		return entityNmb++;
+	}
+	void Destroy(Entity entity)
+	{
+		std::apply([entity](auto&... pools) { (pools.Remove(entity), ...); }, pools);
+		freeEntities.push_back(entity);
+	}
+	void Clear()
+	{
+		std::apply([](auto&... pools) { (pools.Clear(), ...); }, pools);
+		freeEntities.clear();
+		entityNmb = 0;
+	}
+
+	template<typename T>
+	ComponentPool<T>& GetPool() { return std::get<ComponentPool<T>>(pools); }
+	template<typename T>
+	T& Add(Entity entity, const T& component) { return GetPool<T>().Add(entity, component); }
+	template<typename T>
+	void Remove(Entity entity) { GetPool<T>().Remove(entity); }
+	template<typename T>
+	bool Has(Entity entity) { return GetPool<T>().Has(entity); }
+	template<typename T>
+	T& Get(Entity entity) { return GetPool<T>().Get(entity); }
+	size_t GetEntityNmb() const { return entityNmb - freeEntities.size(); }
+
+	//Call function(entity, First&, Others&...) for every entity having all the components
+	template<typename First, typename... Others, typename Function>
+	void Each(Function&& function)
+	{
+		EachRange<First, Others...>(0, GetPool<First>().GetSize(), function);
+	}
+	//Same split over the job system, the function must only write the components of its entity
+	template<typename First, typename... Others, typename Function>
+	void ParallelEach(JobSystem& jobSystem, size_t grainSize, Function&& function)
+	{
+		jobSystem.ParallelFor(GetPool<First>().GetSize(), grainSize, [this, &function](size_t begin, size_t end)
+		{
+			EachRange<First, Others...>(begin, end, function);
+		});
+	}
+private:
+	template<typename First, typename... Others, typename Function>
+	void EachRange(size_t begin, size_t end, Function& function)
+	{
+		auto& firstPool = GetPool<First>();
+		const auto& entities = firstPool.GetEntities();
+		auto& firstComponents = firstPool.GetComponents();
+		for (size_t i = begin; i < end; i++)
+		{
+			const Entity entity = entities[i];
+			if (!(GetPool<Others>().Has(entity) && ...))
+				continue;
+			function(entity, firstComponents[i], GetPool<Others>().Get(entity)...);
+		}
+	}
+
+	std::tuple<ComponentPool<Components>...> pools;
+	std::vector<Entity> freeEntities;
+	Entity entityNmb = 0;
+};
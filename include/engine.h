@@ -15,8 +15,13 @@
 #endif
 
 #include <chrono>
+#include <map>
 #include <input.h>
 #include <camera.h>
+#include <job_system.h>
+#include <vfs.h>
+#include <dynamic_resolution.h>
+#include <taa.h>
 
 class DrawingProgram;
 struct Remotery;
@@ -30,12 +35,17 @@ struct Configuration
 {
 	unsigned int screenWidth = 800;
 	unsigned int screenHeight = 600;
+	//Size the scene is rendered at this frame, the window size scaled by the dynamic resolution
+	unsigned int renderWidth = 800;
+	unsigned int renderHeight = 600;
 	int vsync = 0;
 	Color bgColor = {0,0,0,0};
 
 	std::string windowName = "OpenGL";
 	unsigned int glMajorVersion = 4;
 	unsigned int glMinorVersion = 4;
+	//Built by the AssetsPak target from the data and shaders directories, optional
+	std::string assetsPak = "assets.pak";
 };
 
 class Engine
@@ -54,9 +64,19 @@ public:
 	Configuration& GetConfiguration();
 	InputManager& GetInputManager();
 	Camera& GetCamera();
+	JobSystem& GetJobSystem();
+	FileSystem& GetFileSystem();
+	//Per frame statistics displayed in the debug info window
+	void SetFrameCounter(const std::string& name, size_t value);
 	void AddDrawingProgram(DrawingProgram* drawingProgram);
 	std::vector<DrawingProgram*>& GetDrawingPrograms() { return drawingPrograms; };
 	SDL_Window* GetWindow();
+	//Framebuffer the drawing programs render into, presented by the dynamic resolution upscale
+	unsigned GetSceneFramebuffer() const { return dynamicResolution.GetFramebuffer(); }
+	DynamicResolution& GetDynamicResolution() { return dynamicResolution; }
+	TemporalAntiAliasing& GetTemporalAa() { return temporalAa; }
+	//Projection to draw the frame with, shifted by the TAA jitter
+	glm::mat4 JitterProjection(const glm::mat4& view, const glm::mat4& projection) { return temporalAa.JitterProjection(view, projection); }
 
 	static Engine* GetPtr();
 private:
@@ -78,6 +98,11 @@ private:
 	std::vector<DrawingProgram*> drawingPrograms;
 	InputManager inputManager;
 	Camera camera;
+	JobSystem jobSystem;
+	FileSystem fileSystem;
+	DynamicResolution dynamicResolution;
+	TemporalAntiAliasing temporalAa;
+	std::map<std::string, size_t> frameCounters;
 	Configuration configuration;
 	Remotery* rmt;
 	int selectedDrawingProgram = -1;
@@ -1,14 +1,58 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 
-struct BinaryFile
-{
-    char* bin;
-    size_t size;
-};
+class FileView;
 
+//Both read through the engine file system, a pak archive overrides the loose files
 const std::string LoadFile(std::string path);
-const BinaryFile LoadBinaryFile(std::string path);
+FileView LoadBinaryFile(std::string path);
 std::string GetFilenameExtension(std::string path);
-std::string GetFilenameFromPath(std::string path);
\ No newline at end of file
+std::string GetFilenameFromPath(std::string path);
+
+//Read only memory mapping of a whole file, the content stays on disk until touched
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+	const uint8_t* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+	bool IsOpen() const { return data != nullptr; }
+	//Ask the system to read a range ahead, the pages are then already there when touched
+	void Prefetch(size_t offset, size_t length) const;
+private:
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+#ifdef WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+//Read only span on a file content. It either points inside a mounted pak or owns the mapping of a loose file,
+//the span of a pak entry stays valid while the pak is mounted.
+class FileView
+{
+public:
+	FileView() = default;
+	FileView(const uint8_t* data, size_t size) : data(data), size(size) {}
+	explicit FileView(std::unique_ptr<MappedFile> file) : data(file->GetData()), size(file->GetSize()), file(std::move(file)) {}
+
+	const uint8_t* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+	std::string_view GetString() const { return std::string_view(reinterpret_cast<const char*>(data), size); }
+	bool IsValid() const { return data != nullptr; }
+private:
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	std::unique_ptr<MappedFile> file;
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <graphics.h>
+#include <geometry.h>
+
+class Terrain;
+
+//One kind of scattered instance, all its visible chunks are a single multi draw
+struct FoliageLayer
+{
+	std::string texturePath = "data/sprites/grass.png";
+	//Camera facing quad, otherwise three crossed quads
+	bool billboard = false;
+	//Instances per square meter where the density is 1
+	float density = 4.0f;
+	glm::vec2 sizeRange = glm::vec2(0.5f, 1.0f);
+	//Instances drop out one by one between the two distances
+	float fadeStart = 40.0f;
+	float fadeEnd = 80.0f;
+	//Perlin noise density, remapped so the values under the threshold are empty
+	float noiseFrequency = 0.02f;
+	int noiseOctaves = 3;
+	float noiseThreshold = 0.4f;
+	//Optional grayscale image stretched over the surface, multiplies the density
+	std::string maskPath;
+};
+
+//Area the foliage is scattered on
+struct FoliageSurface
+{
+	glm::vec2 min = glm::vec2(0.0f);
+	glm::vec2 max = glm::vec2(0.0f);
+	//World height range over a rectangle, bounds the chunks
+	std::function<glm::vec2(const glm::vec2& min, const glm::vec2& max)> heightRange;
+	//Height of a point, leave empty when the vertex shader samples a terrain bound at draw
+	std::function<float(float x, float z)> height;
+};
+FoliageSurface MakeFoliageSurface(const Terrain& terrain);
+
+//Grass and billboards scattered once at Init into a grid of chunks, every layer keeps its instances in one
+//buffer sorted by chunk. Frames only cull the chunks on the workers and write one indirect command per visible
+//chunk, the instances themselves are never touched on the CPU after the scattering.
+//A chunk instances are shuffled and ranked, far chunks draw a prefix of them and the vertex shader fades the
+//instances out in the same rank order.
+class Foliage
+{
+public:
+	bool Init(const std::vector<FoliageLayer>& layers, const FoliageSurface& surface, float chunkSize = 32.0f, unsigned seed = 1);
+	void Destroy();
+	//Cull the chunks, does not touch the GPU
+	void Update(const glm::vec3& cameraPosition, const glm::mat4& viewProjection);
+	//terrain binds its heights when the surface had no height function
+	void Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, const Terrain* terrain = nullptr);
+
+	size_t GetInstanceNmb() const { return instanceNmb; }
+	size_t GetVisibleChunkNmb() const { return visibleChunkNmb; }
+	size_t GetDrawnInstanceNmb() const { return drawnInstanceNmb; }
+	float& GetWindStrength() { return windStrength; }
+private:
+	//x, y, z and size, then the fade rank in [0,1)
+	struct Instance
+	{
+		glm::vec4 positionSize;
+		float rank;
+	};
+	struct Chunk
+	{
+		BoundingBox box;
+		unsigned first = 0;
+		unsigned count = 0;
+	};
+	struct Layer
+	{
+		FoliageLayer description;
+		std::vector<Chunk> chunks;
+		std::vector<DrawArraysIndirectCommand> commands;
+		unsigned texture = 0;
+		unsigned vao = 0;
+		unsigned instanceVbo = 0;
+		unsigned indirectBuffer = 0;
+		size_t commandNmb = 0;
+	};
+	void ScatterLayer(Layer& layer, const FoliageSurface& surface, unsigned seed);
+
+	std::vector<Layer> layers;
+	Shader foliageShader;
+	bool terrainHeights = false;
+	float chunkSize = 32.0f;
+	int chunkNmbX = 0;
+	int chunkNmbZ = 0;
+	float windStrength = 0.1f;
+
+	size_t instanceNmb = 0;
+	size_t visibleChunkNmb = 0;
+	size_t drawnInstanceNmb = 0;
+};
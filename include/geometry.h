@@ -1,11 +1,31 @@
 #pragma once
 #include <vector>
+#include <glm/glm.hpp>
+
+struct BoundingBox
+{
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+};
+
+//Axis aligned box enclosing the transformed corners of box
+BoundingBox TransformBoundingBox(const BoundingBox& box, const glm::mat4& transform);
+
+struct Frustum
+{
+	//Normalized planes pointing inside: left, right, bottom, top, near, far
+	glm::vec4 planes[6];
+};
+
+Frustum ExtractFrustum(const glm::mat4& viewProjection);
+bool IsInFrustum(const Frustum& frustum, const BoundingBox& box);
 
 class Plane
 {
 public:
 	void Init();
 	void Draw() const;
+	unsigned GetVAO() const { return quadVAO; }
 private:
 	std::vector<float> vertices;
 	unsigned quadVAO;
@@ -44,10 +64,53 @@ class Grid
 public:
 	void Init(int size);
 	void Draw();
+	//Per instance attributes must be set up on the vertex array beforehand
+	void DrawInstanced(int instanceNmb);
+	unsigned GetVAO() const { return gridVAO; }
+	size_t GetIndexNmb() const { return indexNmb; }
 private:
 	std::vector<glm::vec3> vertices;
-	std::vector<short> indices;
+	size_t indexNmb = 0;
+	//16 bits indices while the vertices fit, 32 bits above
+	unsigned indexType = 0;
 	unsigned gridVAO = 0;
 	unsigned gridVBO = 0;
 	unsigned gridEBO = 0;
 };
+
+class Shader;
+
+//Grid without vertex buffer, the vertex shader rebuilds the positions from gl_VertexID
+//with procedural_grid_position(). Every level halves the resolution over the same extent.
+class ProceduralGrid
+{
+public:
+	static const int maxLodNmb = 8;
+
+	//size is the vertex count per side of the finest level
+	void Init(int size, int lodNmb = 4);
+	void Destroy();
+	//Set the grid uniforms of the level and draw it, the shader must be bound
+	void Draw(Shader& shader, int lod) const;
+	//Finest level that still has at least one vertex every pixelsPerVertex pixels, screenSize is the grid extent in pixels
+	int SelectLod(float screenSize, float pixelsPerVertex) const;
+
+	unsigned GetVAO() const { return gridVAO; }
+	int GetLodNmb() const { return lodNmb; }
+	int GetResolution(int lod) const { return levels[lod].resolution; }
+	size_t GetTriangleNmb(int lod) const { return levels[lod].indexNmb / 3; }
+private:
+	struct Level
+	{
+		int resolution = 0;
+		size_t indexNmb = 0;
+		size_t indexOffset = 0;
+		unsigned indexType = 0;
+	};
+	Level levels[maxLodNmb];
+	int lodNmb = 0;
+	//Extent of the grid in vertex units of the finest level
+	float extent = 0.0f;
+	unsigned gridVAO = 0;
+	unsigned gridEBO = 0;
+};
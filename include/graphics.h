@@ -18,7 +18,9 @@ class Shader
 {
 public:
 	void CompileSource(std::string vertexShaderPath, std::string fragmentShaderPath);
+	void CompileSource(std::string vertexShaderPath, std::string geometryShaderPath, std::string fragmentShaderPath);
 	void CompileSpirV(std::string vertexShaderPath, std::string fragmentShaderPath);
+	void CompileCompute(std::string computeShaderPath);
 	void Bind();
 	int GetProgram();
 	void SetBool(const std::string& attributeName, bool value) const;
@@ -47,6 +49,8 @@ public:
 	virtual ~DrawingProgram() = default;
 	virtual void Init() = 0;
 	virtual void Draw() = 0;
+	//Drawn on the window once the scene is resolved and upscaled, neither jittered nor reprojected by the TAA
+	virtual void DrawOverlay() {};
 	virtual void Destroy() = 0;
 	virtual void UpdateUi() {};
 	const std::string& GetProgramName();
@@ -120,6 +124,15 @@ private:
 	};
 };
 
+//Layout of the commands read by glMultiDrawArraysIndirect
+struct DrawArraysIndirectCommand
+{
+	unsigned count;
+	unsigned instanceCount;
+	unsigned first;
+	unsigned baseInstance;
+};
+
 unsigned int gliCreateTexture(char const* filename);
 unsigned int stbCreateTexture(const char* filename, bool smooth = true, bool mipMaps = true, bool clampWrap=false);
 
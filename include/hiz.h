@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <graphics.h>
+#include <geometry.h>
+
+//GPU occlusion culling against a hierarchical max depth pyramid, in two passes.
+//The first pass tests the boxes against the previous frame pyramid, reprojected with the view projection it was
+//built with. Its result is written to a ring of persistently mapped buffers and read back behind a fence a few
+//frames later, so the CPU never waits on the GPU, and it gives the draw list of the first pass.
+//Once that list is drawn the pyramid is rebuilt from the current depth and the second pass tests the boxes the
+//first pass rejected again on the GPU. It writes the instance count of their indirect draws, the late draws are
+//then submitted without knowing the result and the false negatives of the first pass still show up this frame.
+//The pyramid is built again after the late draws, the first pass of the next frame sees their depth too.
+class HiZCuller
+{
+public:
+	static constexpr int readbackNmb = 3;
+
+	//Layout shared by the indexed and non indexed indirect draw commands, the second pass only writes instanceCount
+	struct IndirectCommand
+	{
+		unsigned count = 0;
+		unsigned instanceCount = 0;
+		unsigned first = 0;
+		int baseVertex = 0;
+		unsigned baseInstance = 0;
+	};
+
+	void Init();
+	void Destroy();
+	void SetBoxes(const std::vector<BoundingBox>& worldBoxes);
+
+	//Take the newest first pass result the GPU finished, then test the boxes against the previous pyramid
+	void CullFirstPass();
+	//Copy the depth of the currently bound framebuffer and build the pyramid from it
+	void BuildPyramid(const glm::mat4& viewProjection);
+	//Add an indirect draw of elementNmb elements for a box rejected by the first pass, returns its byte offset in
+	//the late command buffer. Its instance count is written by CullSecondPass.
+	size_t AddLateDraw(size_t index, unsigned elementNmb);
+	//Test the boxes of the late draws against the pyramid of this frame, build the pyramid again once they are drawn
+	void CullSecondPass();
+
+	//Drawn by the first pass
+	bool IsVisibleFirstPass(size_t index) const { return visibility[index] != 0; }
+	unsigned GetLateCommandBuffer() const { return lateCommandBuffer; }
+	size_t GetCulledNmb() const { return culledNmb; }
+	size_t GetLateDrawNmb() const { return lateCommands.size(); }
+	//Frames between the depth a first pass result was tested against and the frame drawing with it
+	int GetLatency() const { return latency; }
+	bool& GetEnable() { return enable; }
+private:
+	void ResizeTargets(int width, int height);
+	void ResizeReadback(size_t boxCapacity);
+	void ReadBack();
+	void DiscardReadback();
+	void Cull(bool secondPass, unsigned visibilityBuffer, size_t invocationNmb);
+
+	Shader copyShader;
+	Shader downsampleShader;
+	Shader cullShader;
+
+	unsigned depthFbo = 0;
+	unsigned depthTexture = 0;
+	unsigned hiZTexture = 0;
+	int width = 0;
+	int height = 0;
+	int renderWidth = 0;
+	int renderHeight = 0;
+	int levelNmb = 0;
+	bool pyramidValid = false;
+	glm::mat4 pyramidViewProjection = glm::mat4(1.0f);
+
+	unsigned boxesSsbo = 0;
+	size_t boxNmb = 0;
+	size_t boxCapacity = 0;
+	//Ring of results, each written by one frame and read once its fence is signaled
+	unsigned visibilitySsbos[readbackNmb] = {};
+	const unsigned* mappedVisibility[readbackNmb] = {};
+	//GLsync of the cull writing each slot, null when the slot holds nothing to read
+	void* fences[readbackNmb] = {};
+	int slotFrames[readbackNmb] = {};
+	int writeIndex = 0;
+	int readIndex = 0;
+	int frameIndex = 0;
+	int latency = 0;
+
+	//Box of each late draw and its command, filled during the frame then uploaded by the second pass
+	unsigned lateBoxBuffer = 0;
+	unsigned lateCommandBuffer = 0;
+	std::vector<unsigned> lateBoxes;
+	std::vector<IndirectCommand> lateCommands;
+
+	std::vector<unsigned> visibility;
+	size_t culledNmb = 0;
+	bool enable = true;
+};
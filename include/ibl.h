@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <glm/glm.hpp>
+#include <graphics.h>
+
+//Image based lighting from an equirectangular HDR environment.
+//The environment is converted to a cube map, its irradiance is projected on 9 spherical harmonics on the CPU,
+//the specular chain is GGX prefiltered with one roughness per level and the split sum BRDF is stored in a LUT.
+//Everything is cached as DDS next to the HDR so the convolutions only run the first time.
+class ImageBasedLighting
+{
+public:
+	static constexpr int irradianceCoefficientNmb = 9;
+
+	bool Init(const std::string& equirectPath, int environmentSize = 512, int specularSize = 128);
+	void Destroy();
+	//Bind the prefiltered map and the BRDF LUT on two consecutive texture units, the shader must be bound
+	void Bind(Shader& shader, int firstTextureUnit = 11) const;
+
+	unsigned GetEnvironmentMap() const { return environmentMap; }
+	const std::array<glm::vec3, irradianceCoefficientNmb>& GetIrradiance() const { return irradiance; }
+	//Radiance coefficients of an RGB float image, convolved with the cosine lobe and divided by pi
+	static std::array<glm::vec3, irradianceCoefficientNmb> ProjectIrradiance(const float* rgb, int width, int height);
+private:
+	bool LoadCache();
+	bool Compute(const std::string& equirectPath, int environmentSize, int specularSize);
+	void SaveCache() const;
+
+	std::string environmentCachePath;
+	std::string specularCachePath;
+	std::string irradianceCachePath;
+	std::string brdfCachePath;
+
+	unsigned environmentMap = 0;
+	unsigned specularMap = 0;
+	unsigned brdfLut = 0;
+	int specularLevelNmb = 0;
+	std::array<glm::vec3, irradianceCoefficientNmb> irradiance = {};
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <ctpl_stl.h>
+
+class JobSystem
+{
+public:
+	//threadNmb < 0 uses every hardware thread except the main one
+	void Init(int threadNmb = -1);
+	void Destroy();
+
+	template<typename F>
+	auto Schedule(F&& job) -> std::future<decltype(job())>
+	{
+		return pool.push([job](int) { return job(); });
+	}
+	//Split [0, count) in chunks of at least grainSize and run them on the workers, the calling thread takes its share and waits for the rest
+	void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& job);
+	int GetThreadNmb() { return pool.size(); }
+private:
+	ctpl::thread_pool pool;
+};
@@ -26,6 +26,8 @@
 
 #include <string>
 #include <memory>
+#include <initializer_list>
+#include <vector>
  //Externals includes
 #include <glm/glm.hpp>
 #include <json.hpp>
@@ -39,4 +41,57 @@ bool CheckJsonNumber(const json& jsonObject, std::string parameterName);
 std::unique_ptr<json> LoadJson(std::string jsonPath);
 glm::vec3 ConvertVec3FromJson(const json& vec3Json);
 
+//Streaming JSON reader: the file is mapped and parsed with the SAX interface, no DOM is built.
+//Derived readers get one call per value with the path of the value, they keep all their state
+//so several readers can parse on worker threads at the same time.
+class JsonSaxReader : public nlohmann::json_sax<json>
+{
+public:
+	//Syntax errors are reported with their line and column, semantic errors with the path of the value
+	bool Parse(const std::string& jsonPath);
+protected:
+	virtual bool OnNumber(double) { return true; }
+	virtual bool OnBoolean(bool) { return true; }
+	virtual bool OnString(const std::string&) { return true; }
+	//Called before entering the object or array, the path is the one of the container
+	virtual bool OnStartObject() { return true; }
+	virtual bool OnStartArray() { return true; }
+	//Called after leaving the object, with the same path as its OnStartObject
+	virtual bool OnEndObject() { return true; }
+
+	//Keys or "[]" for any array element, e.g. {"models", "[]", "position", "[]"}
+	bool Matches(std::initializer_list<const char*> pattern) const;
+	//Array index at a depth of the path
+	size_t GetIndex(size_t depth) const { return frames[depth].index; }
+	size_t GetDepth() const { return frames.size(); }
+	std::string GetPathString() const;
+	//Stop the parsing, the message is printed with the current path
+	bool Fail(const std::string& message);
+private:
+	struct Frame
+	{
+		bool array = false;
+		std::string key;
+		size_t index = 0;
+	};
+	bool EndValue();
+
+	bool null() override { return EndValue(); }
+	bool boolean(bool value) override { return OnBoolean(value) && EndValue(); }
+	bool number_integer(number_integer_t value) override { return OnNumber((double)value) && EndValue(); }
+	bool number_unsigned(number_unsigned_t value) override { return OnNumber((double)value) && EndValue(); }
+	bool number_float(number_float_t value, const string_t&) override { return OnNumber(value) && EndValue(); }
+	bool string(string_t& value) override { return OnString(value) && EndValue(); }
+	bool start_object(std::size_t) override;
+	bool key(string_t& value) override;
+	bool end_object() override;
+	bool start_array(std::size_t) override;
+	bool end_array() override;
+	bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& exception) override;
+
+	std::vector<Frame> frames;
+	std::string path;
+	bool failed = false;
+};
+
 #endif
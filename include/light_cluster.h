@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <graphics.h>
+#include <light.h>
+
+//Clustered forward lighting: the view frustum is cut in froxels (screen tiles times exponential depth slices),
+//each froxel gets the list of point and spot lights touching it so the fragment shader only iterates those.
+//Spot lights are bounded by the box of their cone, they have no range so the cone goes to the far plane.
+class LightCluster
+{
+public:
+	static const int clusterX = 16;
+	static const int clusterY = 9;
+	static const int clusterZ = 24;
+	static const int clusterNmb = clusterX * clusterY * clusterZ;
+
+	void Init();
+	void Destroy();
+	void Update(const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights,
+		const glm::mat4& view, const glm::mat4& projection, float near, float far);
+	//Bind the light buffers and set the cluster uniforms, the shader must be bound
+	void Bind(Shader& shader) const;
+
+	size_t GetLightNmb() const { return pointLightNmb; }
+	size_t GetSpotLightNmb() const { return lightMinX.size() - pointLightNmb; }
+	size_t GetLightIndexNmb() const { return lightIndices.size(); }
+private:
+	void AssignSlice(int slice);
+	void AddLightBounds(const glm::vec3& viewMin, const glm::vec3& viewMax);
+
+	unsigned lightsSsbo = 0;
+	unsigned spotLightsSsbo = 0;
+	unsigned gridSsbo = 0;
+	unsigned indicesSsbo = 0;
+
+	float near = 0.1f;
+	float far = 100.0f;
+	glm::vec2 projectionScale = glm::vec2(1.0f);
+
+	//View space bounds of the point lights then the spot lights, split by component so the slice tests stay simple loops
+	std::vector<float> lightMinX;
+	std::vector<float> lightMaxX;
+	std::vector<float> lightMinY;
+	std::vector<float> lightMaxY;
+	std::vector<float> lightMinDepth;
+	std::vector<float> lightMaxDepth;
+	size_t pointLightNmb = 0;
+
+	//Position and distance, color and intensity
+	std::vector<glm::vec4> lightData;
+	//Position and cosine of the cut off, direction and cosine of the outer cut off, color and intensity
+	std::vector<glm::vec4> spotLightData;
+	std::vector<std::vector<uint32_t>> clusterLights;
+	//Offset, point light count and spot light count in the index list for each cluster, the spot lights follow the point lights
+	std::vector<glm::uvec4> grid;
+	std::vector<uint32_t> lightIndices;
+};
@@ -1,3 +1,7 @@
 #pragma once
+#include <cstdint>
+#include <glm/vec4.hpp>
 
-int RandomRange(int start, int end);
\ No newline at end of file
+int RandomRange(int start, int end);
+//RGBA8 color with red in the low byte, as read by unpackUnorm4x8
+uint32_t PackColor(const glm::vec4& color);
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include <engine.h>
 #include <graphics.h>
+#include <pbr_material.h>
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -34,9 +35,14 @@ public:
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
+	//Imported from a metallic-roughness material, the textures are texture_diffuse, texture_normal and texture_orm
+	bool pbr = false;
+	PbrFactors pbrFactors;
 	/*  Functions  */
 	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
 	void Draw(Shader shader);
+	//Bind the vertex array and draw without touching the shader state
+	void DrawGeometry();
 	unsigned GetVAO() { return VAO; };
 private:
 	/*  Render data  */
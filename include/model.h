@@ -3,10 +3,12 @@
 #include <engine.h>
 #include <graphics.h>
 #include <mesh.h>
+#include <geometry.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <limits>
 
 class Model
 {
@@ -18,6 +20,7 @@ public:
 	bool gammaCorrection;
 	glm::vec3 modelCenter;
 	float modelRadius;
+	BoundingBox bounds;
 	/*  Functions   */
 	void Init(const char *path, bool generateSphere=false)
 	{
@@ -31,5 +34,9 @@ private:
 	void processNode(aiNode *node, const aiScene *scene);
 	Mesh processMesh(aiMesh *mesh, const aiScene *scene);
 	std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type,
-		std::string typeName);
+		std::string typeName, unsigned int maxCount = std::numeric_limits<unsigned int>::max());
+	//glTF metallic-roughness factors, returns false for the other materials
+	bool loadPbrFactors(aiMaterial* mat, PbrFactors& factors);
+	//Occlusion and metallic-roughness maps cooked into one texture_orm
+	Texture loadOrmTexture(aiMaterial* mat);
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <geometry.h>
+
+//Software occlusion culling: a few large occluders are rasterized on the CPU in a small depth buffer,
+//then candidate boxes are tested against it before being submitted to OpenGL
+class OcclusionCuller
+{
+public:
+	void Init(int width = 256, int height = 128);
+	//Triangles are world space vertex triplets, the occluder is considered static
+	int RegisterOccluder(const std::vector<glm::vec3>& triangles);
+	int RegisterOccludee(const BoundingBox& worldBox);
+	void SetOccludeeBox(int occludee, const BoundingBox& worldBox);
+	void Clear();
+	//Rasterize the occluders and test every occludee, the results are valid until the next update
+	void Update(const glm::mat4& viewProjection);
+
+	bool IsVisible(int occludee) const { return !enable || visibility[occludee] != 0; }
+	size_t GetOccludeeNmb() const { return occludeeBoxes.size(); }
+	size_t GetCulledNmb() const { return culledNmb; }
+	const std::vector<float>& GetDepthBuffer() const { return depthBuffer; }
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+	bool& GetEnable() { return enable; }
+
+private:
+	struct ScreenTriangle
+	{
+		//x and y in pixels, z depth in [0,1]
+		glm::vec3 vertices[3];
+	};
+	void SetupTriangles(const glm::mat4& viewProjection);
+	void RasterizeTile(int tileIndex);
+	void RasterizeTriangle(const ScreenTriangle& triangle, int minX, int minY, int maxX, int maxY);
+	bool TestOccludee(const BoundingBox& box, const glm::mat4& viewProjection) const;
+
+	static const int tileWidth = 64;
+	static const int tileHeight = 32;
+	static const int blockSize = 8;
+	int width = 0;
+	int height = 0;
+	int tilesX = 0;
+	int tilesY = 0;
+	int blocksX = 0;
+	int blocksY = 0;
+
+	std::vector<float> depthBuffer;
+	//Farthest depth of each block, first level of the depth hierarchy
+	std::vector<float> blockMaxDepth;
+	std::vector<glm::vec3> occluderTriangles;
+	int occluderNmb = 0;
+	std::vector<ScreenTriangle> screenTriangles;
+	std::vector<std::vector<int>> tileBins;
+
+	std::vector<BoundingBox> occludeeBoxes;
+	std::vector<char> visibility;
+	size_t culledNmb = 0;
+	bool enable = true;
+};
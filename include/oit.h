@@ -0,0 +1,35 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <graphics.h>
+
+//Weighted blended order independent transparency.
+//Transparent fragments are added in an accumulation target weighted by their depth and alpha, and multiplied
+//in a revealage target, so they can be drawn in any order. The composite resolves both over the opaque image.
+class WeightedBlendedOit
+{
+public:
+	void Init();
+	void Destroy();
+	//Copy the depth of the currently bound framebuffer and redirect the draws to the accumulation targets
+	void Begin();
+	//Restore the framebuffer and the depth and blend state of Begin and blend the transparent surfaces over it
+	void End();
+private:
+	void ResizeTargets(int width, int height);
+
+	Shader compositeShader;
+	unsigned emptyVao = 0;
+	unsigned fbo = 0;
+	unsigned accumulationTexture = 0;
+	unsigned revealageTexture = 0;
+	unsigned depthTexture = 0;
+	int width = 0;
+	int height = 0;
+	int previousFbo = 0;
+	//Restored by End
+	GLboolean previousDepthTest = GL_TRUE;
+	GLboolean previousDepthMask = GL_TRUE;
+	GLboolean previousBlend = GL_FALSE;
+	GLint previousBlendFunc[4] = { GL_ONE, GL_ZERO, GL_ONE, GL_ZERO };
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <glm/glm.hpp>
+
+class FileSystem;
+
+//Constant part of a metallic-roughness material, multiplied with the maps when they exist
+struct PbrFactors
+{
+	glm::vec4 baseColor = glm::vec4(1.0f);
+	float metallic = 1.0f;
+	float roughness = 1.0f;
+	float normalScale = 1.0f;
+};
+
+//One channel of a grayscale or packed map
+struct OrmSource
+{
+	std::string path;
+	int channel = 0;
+};
+
+//Pack occlusion, roughness and metallic in the red, green and blue channels of one RGBA8 DDS with its mip chain.
+//The output is rebuilt when missing or older than a source, a missing source gets its neutral value:
+//no occlusion, full roughness and no metal.
+bool CookOrmTexture(const OrmSource& occlusion, const OrmSource& roughness, const OrmSource& metallic, const std::string& outputPath);
+
+//Maps of a texture set folder, the images whose name ends with one of the usual suffixes in any case (_COLOR/_col,
+//_NORM/_nrm, _ROUGH/_rgh, _OCC/_AO, _met, _DISP), listed through the file system so paks resolve like loose files
+struct PbrTextureSet
+{
+	std::string color;
+	std::string normal;
+	std::string occlusion;
+	std::string roughness;
+	std::string metallic;
+	std::string height;
+};
+
+PbrTextureSet FindPbrTextureSet(const std::string& directory);
+PbrTextureSet FindPbrTextureSet(const std::string& directory, const FileSystem& fileSystem);
+//Packed map of a texture set, "<directory>/<folder name>_ORM.dds"
+std::string GetOrmTexturePath(const std::string& directory);
+
+//Load a cooked ORM texture with trilinear filtering
+unsigned CreateOrmTexture(const std::string& path);
+
+struct PbrTextures
+{
+	unsigned baseColor = 0;
+	unsigned normal = 0;
+	unsigned orm = 0;
+};
+//Cook the ORM of a texture set folder if needed and load its maps, a missing map stays 0
+PbrTextures LoadPbrTextureSet(const std::string& directory);
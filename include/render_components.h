@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <ecs.h>
+#include <geometry.h>
+#include <graphics.h>
+#include <mesh.h>
+#include <pbr_material.h>
+
+struct TransformComponent
+{
+	glm::mat4 modelMatrix = glm::mat4(1.0f);
+	//Node in the scene transform hierarchy, -1 when the matrix is set directly
+	int node = -1;
+};
+
+struct BoundsComponent
+{
+	BoundingBox worldBounds;
+	//Index of the box in the occlusion cullers
+	int cullIndex = -1;
+};
+
+//Geometry owned by a Mesh or a primitive, drawn with the shader already bound
+struct MeshComponent
+{
+	unsigned vao = 0;
+	unsigned elementNmb = 0;
+	bool indexed = false;
+};
+
+struct MaterialComponent
+{
+	static constexpr int maxTextureNmb = 4;
+
+	Shader* shader = nullptr;
+	unsigned textures[maxTextureNmb] = {};
+	//Sampler uniform of each texture, static strings
+	const char* samplerNames[maxTextureNmb] = {};
+	int textureNmb = 0;
+	//Metallic-roughness materials bind pbrMaterial.* instead of the Blinn-Phong material
+	bool pbr = false;
+	PbrFactors pbrFactors;
+	//Same key for the same shader, textures and factors, the render queue groups the draws with it
+	unsigned sortKey = 0;
+	//Index of the first texture in a TextureResidency, -1 when the textures are bound per draw
+	int residentTexture = -1;
+	//Drawn in the transparent pass, the shader writes the OIT outputs (see transparent.frag)
+	bool transparent = false;
+};
+
+struct VisibilityComponent
+{
+	bool visible = true;
+	//Rejected by the Hi-Z first pass only, drawn late if its second pass finds it visible
+	bool late = false;
+};
+
+using RenderRegistry = Registry<TransformComponent, BoundsComponent, MeshComponent, MaterialComponent, VisibilityComponent>;
+
+MeshComponent MakeMeshComponent(Mesh& mesh);
+//Textures follow the Mesh naming: material.texture_diffuse1, material.texture_specular1, material.texture_normal...
+MaterialComponent MakeMaterialComponent(Shader& shader, const std::vector<Texture>& textures);
+//texture_diffuse is the base color, texture_normal the normal map and texture_orm the packed occlusion, roughness and metallic
+MaterialComponent MakePbrMaterialComponent(Shader& shader, const std::vector<Texture>& textures, const PbrFactors& factors);
+//Dense identifier of the material content, to call once the component is filled
+unsigned GetMaterialSortKey(const MaterialComponent& material);
+void DrawMeshComponent(const MeshComponent& mesh);
+//Same draw from the indirect command at commandOffset in indirectBuffer, its count matching the mesh
+void DrawMeshComponentIndirect(const MeshComponent& mesh, unsigned indirectBuffer, size_t commandOffset);
+//Bind the textures on the first units, the shader must be bound
+void BindMaterialComponent(const MaterialComponent& material);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include <graphics.h>
+#include <oit.h>
+
+enum class RenderPass : uint8_t
+{
+	OPAQUE_PASS = 0,
+	TRANSPARENT_PASS = 1,
+};
+
+struct DrawPacket
+{
+	RenderPass pass = RenderPass::OPAQUE_PASS;
+	Shader* shader = nullptr;
+	//Texture or material identifier, only used to group draws
+	unsigned material = 0;
+	//Vertex array or mesh identifier, only used to group draws
+	unsigned mesh = 0;
+	glm::mat4 modelMatrix = glm::mat4(1.0f);
+	//Model matrix of the previous frame, gives the TAA motion vectors of a moving object. Null for static draws.
+	const glm::mat4* previousModelMatrix = nullptr;
+	glm::vec3 worldCenter = glm::vec3(0.0f);
+	//Called with the packet shader bound and its model matrix set
+	std::function<void()> draw = nullptr;
+	//Geometry only draw for the depth prepass, leave empty to keep the packet out of the prepass
+	std::function<void()> drawGeometry = nullptr;
+	//Depth only program of drawGeometry when the vertices are not placed by the model matrix alone (multi draws,
+	//displaced grids). It is bound with lightSpaceMatrix and model set, like depth.vert. Null uses depth.vert.
+	Shader* depthShader = nullptr;
+};
+
+//Collects the draws of a frame and submits them sorted by a 64 bits key:
+//pass (4 bits) | depth bucket (16 bits) | program (12 bits) | material (16 bits) | mesh (16 bits)
+//Opaque draws go front to back. Transparent draws are resolved by weighted blended OIT, their order does not
+//matter so they keep a null depth bucket and are only grouped by state. Their shader writes the two OIT
+//outputs, see transparent.frag.
+class RenderQueue
+{
+public:
+	void Init();
+	void Destroy();
+	void Begin(const glm::mat4& view, const glm::mat4& projection, float near, float far);
+	void Submit(const DrawPacket& packet);
+	//Sort, optionally lay down the depth of the opaque draws, then draw everything and clear the queue
+	void Flush();
+
+	bool& GetDepthPrepass() { return depthPrepass; }
+	size_t GetPacketNmb() const { return packets.size(); }
+	size_t GetDrawCallNmb() const { return drawCallNmb; }
+	size_t GetProgramSwitchNmb() const { return programSwitchNmb; }
+	size_t GetTransparentDrawNmb() const { return transparentDrawNmb; }
+	size_t GetMotionDrawNmb() const { return motionDrawNmb; }
+
+	static uint64_t ComputeKey(RenderPass pass, uint16_t depthBucket, unsigned program, unsigned material, unsigned mesh);
+private:
+	void SortKeys();
+	void DrawMotionVectors();
+	uint16_t ComputeDepthBucket(const glm::vec3& worldCenter) const;
+
+	Shader depthShader;
+	WeightedBlendedOit oit;
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	float logNear = 0.0f;
+	float logRange = 1.0f;
+
+	std::vector<DrawPacket> packets;
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> tmpOrder;
+	size_t drawCallNmb = 0;
+	size_t programSwitchNmb = 0;
+	size_t transparentDrawNmb = 0;
+	size_t motionDrawNmb = 0;
+	bool depthPrepass = true;
+};
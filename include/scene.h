@@ -7,27 +7,57 @@
 #include <model.h>
 #include <map>
 #include "light.h"
+#include <occlusion.h>
+#include <hiz.h>
+#include <render_queue.h>
+#include <light_cluster.h>
+#include <shadow.h>
+#include <transform.h>
+#include <render_components.h>
+#include <ibl.h>
 
 class Scene
 {
 public:
-	void Init();
+	//Every mesh of every model becomes a renderable entity drawn with materialShader,
+	//or with pbrShader for metallic-roughness materials and models given a texture set.
+	//Returns false when the scene cannot be loaded, the scene is then left empty
+	bool Init(Shader& materialShader, Shader& pbrShader);
+	//Update the moved transforms and their bounds, returns true when a world bound changed
+	bool Update();
 	std::vector<Model*>& GetModels() { return models; }
-	std::vector<glm::vec3>& GetPositions() { return positions; }
-	std::vector<glm::vec3>& GetScales() { return scales; }
-	std::vector<glm::vec3>& GetRotations() { return rotations; }
+	TransformHierarchy& GetTransforms() { return transforms; }
+	RenderRegistry& GetRegistry() { return registry; }
+	int GetModelNode(size_t index) const { return modelNodes[index]; }
 	void SetScenePath(std::string jsonPath) { this->jsonPath = jsonPath; }
 	size_t GetModelNmb() { return modelNmb; }
+	const glm::mat4& GetModelMatrix(size_t index) const { return transforms.GetWorldMatrix(modelNodes[index]); }
+	const std::vector<BoundingBox>& GetWorldBounds() const { return worldBounds; }
+	const BoundingBox& GetSceneBounds() const { return sceneBounds; }
 
+	//Occluders are world space triangles, occludees are world space boxes tested each frame
+	int RegisterOccluder(const std::vector<glm::vec3>& triangles);
+	int RegisterOccludee(const BoundingBox& worldBox);
+	OcclusionCuller& GetOcclusionCuller() { return occlusionCuller; }
+
+	std::vector<PointLight>& GetPointLights() { return pointLights; }
+	std::vector<SpotLight>& GetSpotLights() { return spotLights; }
+	DirectionLight& GetDirectionLight() { return directionLight; }
 	void BindLights(Shader& shader);
 private:
 	std::string jsonPath;
-	size_t modelNmb;
+	size_t modelNmb = 0;
 	std::vector<Model*> models;
-	std::vector<glm::vec3> positions;
-	std::vector<glm::vec3> scales;
-	std::vector<glm::vec3> rotations;
+	void UpdateSceneBounds();
+
+	TransformHierarchy transforms;
+	std::vector<int> modelNodes;
+	RenderRegistry registry;
 	std::map<std::string, Model> modelMap;
+	std::map<std::string, PbrTextures> textureSets;
+	std::vector<BoundingBox> worldBounds;
+	BoundingBox sceneBounds = {};
+	OcclusionCuller occlusionCuller;
 	//Lights
 	std::vector<PointLight> pointLights;
 	std::vector<SpotLight> spotLights;
@@ -42,10 +72,23 @@ public:
 	void Draw() override;
 	void Destroy() override;
 	void ProcessInput();
+	void UpdateUi() override;
 	Scene& GetScene() { return scene; }
 private:
+	//Linear scans over the renderables, visibility first then submission of the visible ones.
+	//The late submission draws the Hi-Z first pass rejections through the second pass indirect commands.
+	void CullEntities();
+	size_t SubmitVisibleEntities(bool late);
 	Scene scene = {};
+	//Nothing is drawn from a scene that failed to load
+	bool sceneLoaded = false;
+	HiZCuller hiZCuller;
+	RenderQueue renderQueue;
+	LightCluster lightCluster;
+	ShadowSystem shadowSystem;
+	ImageBasedLighting ibl;
 	//Camera camera = Camera(glm::vec3(0.0f, 3.0f, 10.0f));
 	Shader modelShader;
+	Shader pbrShader;
 	glm::mat4 projection;
 };
\ No newline at end of file
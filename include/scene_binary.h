@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <file_utility.h>
+
+//Compiled scene: a header then arrays of fixed size records, every array starts on a 16 bytes boundary.
+//Strings are offsets in a table of null terminated names placed after the arrays.
+//The file is mapped and its records are read in place, the JSON scene stays the authoring format.
+struct SceneBinaryHeader
+{
+	char magic[4] = { 'S', 'C', 'N', 'B' };
+	uint32_t version = 2;
+	uint32_t modelNmb = 0;
+	uint32_t pointLightNmb = 0;
+	uint32_t spotLightNmb = 0;
+	uint32_t stringTableSize = 0;
+	uint64_t modelOffset = 0;
+	uint64_t pointLightOffset = 0;
+	uint64_t spotLightOffset = 0;
+	uint64_t stringTableOffset = 0;
+	float ambient = 0.0f;
+	uint32_t directionLightEnable = 0;
+	float directionLightDirection[3] = {};
+	float directionLightPosition[3] = {};
+	float directionLightIntensity = 0.0f;
+	uint32_t padding = 0;
+};
+
+struct SceneBinaryModel
+{
+	static constexpr uint32_t occluderFlag = 1;
+	static constexpr uint32_t noMaterial = 0xFFFFFFFF;
+
+	float position[3];
+	float angles[3];
+	float scale[3];
+	//Offset of the model path in the string table
+	uint32_t modelName;
+	//Index of a model stored before this one, -1 without parent
+	int32_t parent;
+	uint32_t flags;
+	//Offset of a PBR texture set folder replacing the model materials, noMaterial to keep them
+	uint32_t material;
+	uint32_t padding[3];
+};
+
+struct SceneBinaryPointLight
+{
+	float position[3];
+	float intensity;
+	float distance;
+	uint32_t enable;
+	uint32_t padding[2];
+};
+
+struct SceneBinarySpotLight
+{
+	float position[3];
+	float intensity;
+	float direction[3];
+	float cutOff;
+	float outerCutOff;
+	uint32_t enable;
+	uint32_t padding[2];
+};
+
+//Write the compiled version of a JSON scene
+bool ConvertSceneToBinary(const std::string& jsonPath, const std::string& outputPath);
+//Path of the compiled scene next to the JSON one, converted again when missing, older than the JSON or of another version
+//Empty when the conversion fails
+std::string CompileScene(const std::string& jsonPath);
+
+class SceneBinaryFile
+{
+public:
+	bool Open(const std::string& path);
+	void Close();
+
+	const SceneBinaryHeader& GetHeader() const { return *header; }
+	const SceneBinaryModel* GetModels() const { return models; }
+	const SceneBinaryPointLight* GetPointLights() const { return pointLights; }
+	const SceneBinarySpotLight* GetSpotLights() const { return spotLights; }
+	const char* GetString(uint32_t offset) const { return strings + offset; }
+private:
+	FileView file;
+	const SceneBinaryHeader* header = nullptr;
+	const SceneBinaryModel* models = nullptr;
+	const SceneBinaryPointLight* pointLights = nullptr;
+	const SceneBinarySpotLight* spotLights = nullptr;
+	const char* strings = nullptr;
+};
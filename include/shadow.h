@@ -0,0 +1,54 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include <graphics.h>
+#include <geometry.h>
+
+//Cascaded shadow maps for a direction light.
+//Every cascade is a layer of a depth texture array, all the layers are rendered in a single pass
+//with a geometry shader routing each triangle to the cascades its caster touches.
+class ShadowSystem
+{
+public:
+	static const int maxCascadeNmb = 4;
+
+	void Init(int shadowMapSize = 2048, int cascadeNmb = maxCascadeNmb);
+	void Destroy();
+	//Fit the cascades on the camera frustum slices, the scene bounds give the casters depth range
+	void Update(const glm::mat4& view, float fovY, float aspect, float near,
+		const glm::vec3& lightDirection, const BoundingBox& sceneBounds);
+	//Cull the casters against each cascade and render them, drawCaster sets the model matrix and draws the geometry
+	void Render(const std::vector<BoundingBox>& casterBounds, const std::function<void(size_t caster, Shader& shader)>& drawCaster);
+	//Bind the shadow map and the cascades uniforms, the shader must be bound
+	void Bind(Shader& shader) const;
+
+	bool& GetEnable() { return enable; }
+	float& GetShadowDistance() { return shadowDistance; }
+	size_t GetCasterDrawNmb() const { return casterDrawNmb; }
+	size_t GetCascadeDrawNmb() const { return cascadeDrawNmb; }
+private:
+	static const int shadowMapTextureUnit = 10;
+
+	Shader shadowShader;
+	unsigned shadowFbo = 0;
+	unsigned shadowMap = 0;
+	int shadowMapSize = 0;
+	int cascadeNmb = 0;
+
+	glm::mat4 cameraView = glm::mat4(1.0f);
+	glm::mat4 lightRotation = glm::mat4(1.0f);
+	glm::mat4 cascadeMatrices[maxCascadeNmb];
+	float cascadeSplits[maxCascadeNmb] = {};
+	//Light space area covered by each cascade, used for the culling
+	glm::vec3 cascadeCenters[maxCascadeNmb];
+	float cascadeRadius[maxCascadeNmb] = {};
+
+	std::vector<int> casterMasks;
+	size_t casterDrawNmb = 0;
+	size_t cascadeDrawNmb = 0;
+	float shadowDistance = 50.0f;
+	float splitLambda = 0.75f;
+	bool enable = true;
+};
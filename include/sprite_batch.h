@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <graphics.h>
+
+//Where a sprite image ended up in a texture array
+struct SpriteRegion
+{
+	unsigned texture = 0;
+	int page = 0;
+	//Offset and size in normalized coordinates of the page
+	glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	//Size in pixels of the packed image
+	glm::vec2 size = glm::vec2(0.0f);
+};
+
+//Packs the images of many small sprites in the pages of one GL_TEXTURE_2D_ARRAY at load time, so every sprite
+//using the atlas is drawn without texture switch. Each image is surrounded by a copy of its border pixels so the
+//bilinear filtering and the first mips do not bleed in the neighbours.
+class SpriteAtlas
+{
+public:
+	//Queue an image, returns its sprite index once the atlas is built
+	int Add(const std::string& path);
+	//Load and pack every queued image. Images larger than a page are halved until they fit.
+	bool Build(int pageSize = 2048, int padding = 4);
+	void Destroy();
+
+	const SpriteRegion& GetRegion(int sprite) const { return regions[sprite]; }
+	unsigned GetTexture() const { return texture; }
+	size_t GetSpriteNmb() const { return regions.size(); }
+	int GetPageNmb() const { return pageNmb; }
+private:
+	std::vector<std::string> paths;
+	std::vector<SpriteRegion> regions;
+	unsigned texture = 0;
+	int pageNmb = 0;
+};
+
+struct Sprite
+{
+	//Center of the quad in the batch space
+	glm::vec2 position = glm::vec2(0.0f);
+	glm::vec2 size = glm::vec2(1.0f);
+	//Radians, counter clockwise around the center
+	float rotation = 0.0f;
+	//Part of the region to show, for animation frames inside one image
+	glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	glm::vec4 tint = glm::vec4(1.0f);
+	//Lower layers are drawn first, the order inside a layer is the submission order for the same texture
+	int16_t layer = 0;
+};
+
+//Collects the sprites of a frame and draws them sorted by layer then texture array. The instances are streamed
+//into an orphaned vertex buffer, one instanced draw per run of sprites sharing a layer range and a texture,
+//so sprites of a single atlas are a single draw whatever their number.
+class SpriteBatch
+{
+public:
+	bool Init(size_t maxSpriteNmb = 131072);
+	void Destroy();
+	//viewProjection maps the batch space to the clip space, usually an orthographic projection in pixels
+	void Begin(const glm::mat4& viewProjection);
+	void Add(const SpriteRegion& region, const Sprite& sprite);
+	//Sort and draw everything added since Begin
+	void End();
+
+	size_t GetSpriteNmb() const { return spriteNmb; }
+	size_t GetDrawCallNmb() const { return drawCallNmb; }
+private:
+	struct SpriteInstance
+	{
+		glm::vec4 positionSize;
+		glm::vec4 uvRect;
+		//rotation and page
+		glm::vec2 rotationPage;
+		uint32_t tint;
+	};
+	void SortKeys();
+
+	Shader spriteShader;
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	unsigned vao = 0;
+	unsigned instanceVbo = 0;
+	size_t maxSpriteNmb = 0;
+
+	std::vector<SpriteInstance> instances;
+	//layer (16 bits) | texture slot (16 bits)
+	std::vector<uint32_t> keys;
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> tmpOrder;
+	//Texture arrays used this frame, indexed by their slot in the keys
+	std::vector<unsigned> textures;
+	size_t spriteNmb = 0;
+	size_t drawCallNmb = 0;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <graphics.h>
+
+class DynamicResolution;
+
+//Temporal anti-aliasing over the dynamic resolution frame. Each frame the projection of the drawing program is
+//shifted by a sub-pixel Halton offset, and the resolve accumulates the frames in a history at the window size,
+//so it also upsamples a frame rendered under the window size.
+//The history is reprojected with the motion vectors of the moving objects, written by the render queue from
+//their previous model matrix, and everywhere else with the camera motion rebuilt from the depth. The reprojected
+//history is clipped to the color distribution of the current neighbourhood to reject what is no longer there.
+class TemporalAntiAliasing
+{
+public:
+	static constexpr int jitterSampleNmb = 8;
+
+	void Init();
+	void Destroy();
+	//Clear the motion vectors of the frame and move to the next jitter sample, after the dynamic resolution Begin
+	void BeginFrame(const DynamicResolution& dynamicResolution);
+	//Record the camera of the frame and return the jittered projection to draw with. A frame without camera
+	//skips the anti-aliasing, e.g. a 2D program.
+	glm::mat4 JitterProjection(const glm::mat4& view, const glm::mat4& projection);
+	bool IsActive() const { return enable && cameraSet; }
+
+	//Motion vector pass over the depth of the frame, the shader takes model and previousModel
+	Shader& BeginMotionVectors();
+	void EndMotionVectors();
+
+	//Accumulate the frame in the history, the output is then read with GetOutput
+	void Resolve(const DynamicResolution& dynamicResolution, int windowWidth, int windowHeight);
+	unsigned GetOutput() const { return historyTextures[historyIndex]; }
+	glm::vec2 GetOutputUvScale() const;
+	glm::vec2 GetOutputSize() const { return glm::vec2(historyWidth, historyHeight); }
+	void UpdateUi();
+
+	bool& GetEnable() { return enable; }
+private:
+	void ResizeVelocity(int width, int height);
+	void ResizeHistory(int width, int height);
+
+	Shader motionShader;
+	Shader resolveShader;
+	unsigned emptyVao = 0;
+	unsigned motionFbo = 0;
+	unsigned velocityTexture = 0;
+	int velocityWidth = 0;
+	int velocityHeight = 0;
+	unsigned sceneDepthTexture = 0;
+	//Ping pong, the resolve reads one and writes the other
+	unsigned historyFbo = 0;
+	unsigned historyTextures[2] = {};
+	int historyIndex = 0;
+	int historyWidth = 0;
+	int historyHeight = 0;
+	int outputWidth = 0;
+	int outputHeight = 0;
+	bool historyValid = false;
+	int previousFbo = 0;
+
+	bool enable = true;
+	bool cameraSet = false;
+	int frameIndex = 0;
+	//Jitter of the frame in render pixels
+	glm::vec2 jitter = glm::vec2(0.0f);
+	glm::vec2 renderSize = glm::vec2(1.0f);
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	glm::mat4 jitteredViewProjection = glm::mat4(1.0f);
+	glm::mat4 previousViewProjection = glm::mat4(1.0f);
+	//Weight of the new frame in the history
+	float feedback = 0.1f;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <engine.h>
+#include <graphics.h>
+#include <geometry.h>
+#include <terrain_tiles.h>
+#include <foliage.h>
+#include <water.h>
+
+//Heightmap terrain rendered with CDLOD: a quadtree of nodes is selected each frame from the camera distance,
+//every selected node draws the same grid instanced and displaced by the heightmap in the vertex shader.
+//Vertices morph toward the next coarser level before the switch so the transitions do not pop.
+class Terrain
+{
+public:
+	static const int maxLodNmb = 12;
+
+	struct Node
+	{
+		//World position of the node corner and world size
+		glm::vec2 position;
+		float size;
+		int lod;
+	};
+
+	//heightmapPath must be a single channel image, 16 bits are kept
+	bool Init(const std::string& heightmapPath, const std::string& texturePath,
+		float worldSize = 512.0f, float heightScale = 60.0f, int leafNodeSize = 32);
+	//Stream the heights and albedo from a tiled terrain file instead of keeping them in memory,
+	//leafNodeSize must not be larger than the tiles
+	bool InitStreamed(const std::string& tilePath, int slotNmb = 64, int leafNodeSize = 32);
+	void Destroy();
+	void Update(const glm::vec3& cameraPosition, const glm::mat4& viewProjection);
+	//clipPlane is used when GL_CLIP_DISTANCE0 is enabled
+	void Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, const glm::vec4& clipPlane = glm::vec4(0.0f));
+
+	//Bind the heightmap, or the streamed tiles on the three next units, for sample_height in the vertex shaders.
+	//The shader must be bound, its cameraPosition uniform selects the streamed levels.
+	void BindHeights(Shader& shader, int firstTextureUnit) const;
+
+	float GetHeight(float x, float z) const;
+	//World height range over a rectangle from the node bounds, also known for a streamed terrain
+	glm::vec2 GetHeightRange(const glm::vec2& min, const glm::vec2& max) const;
+	float GetWorldSize() const { return worldSize; }
+	float& GetLodDistance() { return lodDistance; }
+	size_t GetSelectedNodeNmb() const { return selectedNodes.size(); }
+	size_t GetTriangleNmb() const { return selectedNodes.size() * grid.GetIndexNmb() / 3; }
+	int GetLodNmb() const { return lodNmb; }
+	bool IsStreamed() const { return streamed; }
+	TerrainStreamer& GetStreamer() { return streamer; }
+private:
+	//Merge the leaves height range up to the root and create the grid and shader
+	void InitNodes(int nodeNmb);
+	BoundingBox GetNodeBox(int lod, int nodeX, int nodeZ) const;
+	//Returns false when the node is out of its level range, the parent then covers its area
+	bool SelectNode(int lod, int nodeX, int nodeZ);
+	void AddNode(int lod, int nodeX, int nodeZ);
+
+	Grid grid;
+	Shader terrainShader;
+	unsigned heightmapTexture = 0;
+	unsigned albedoTexture = 0;
+	unsigned instanceVbo = 0;
+	TerrainStreamer streamer;
+	bool streamed = false;
+
+	//Samples of the heightmap in [0,1]
+	std::vector<float> heights;
+	int heightmapSize = 0;
+	float worldSize = 0.0f;
+	float heightScale = 0.0f;
+	int leafNodeSize = 0;
+	int lodNmb = 0;
+	//Height range of every node, per level from the leaves to the root
+	std::vector<std::vector<glm::vec2>> nodeHeightRanges;
+
+	float lodDistance = 2.0f;
+	float lodRanges[maxLodNmb] = {};
+	glm::vec3 selectionPosition = glm::vec3(0.0f);
+	Frustum selectionFrustum = {};
+	std::vector<Node> selectedNodes;
+};
+
+class TerrainDrawingProgram : public DrawingProgram
+{
+public:
+	void Init() override;
+	void Draw() override;
+	void Destroy() override;
+	void UpdateUi() override;
+	void ProcessInput();
+private:
+	Terrain terrain;
+	Foliage foliage;
+	Water water;
+	//Nothing is drawn from a terrain that failed to load
+	bool terrainLoaded = false;
+	bool freezeSelection = false;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#include <graphics.h>
+#include <tmd_file.h>
+
+//Tiled terrain file: a header, one entry per tile for every level from the finest to the coarsest, then the tiles.
+//A tile stores (tileInnerSize + 1)^2 16 bits heights and (albedoInnerSize + 1)^2 RGBA8 texels,
+//the edge samples are shared with the neighbour tiles so filtering does not seam.
+struct TerrainTileHeader
+{
+	char magic[4] = { 'T', 'T', 'I', 'L' };
+	uint32_t version = 1;
+	uint32_t tileInnerSize = 0;
+	uint32_t albedoInnerSize = 0;
+	//Tiles per side of the finest level, a power of two
+	uint32_t tileNmb = 0;
+	uint32_t levelNmb = 0;
+	float worldSize = 0.0f;
+	float heightScale = 0.0f;
+};
+
+struct TerrainTileEntry
+{
+	uint64_t offset = 0;
+	//Normalized height range of the tile
+	float minHeight = 0.0f;
+	float maxHeight = 0.0f;
+};
+
+//Cut a heightmap and its albedo texture into a tiled terrain file with all the levels
+bool ConvertToTerrainTiles(const std::string& heightmapPath, const std::string& albedoPath, const std::string& outputPath,
+	float worldSize, float heightScale, int tileInnerSize = 64, int albedoInnerSize = 256);
+//Same from a float heightfield, heights are multiplied by heightScale
+bool ConvertToTerrainTiles(const TmdHeightSpan& heights, const std::string& albedoPath, const std::string& outputPath,
+	float worldSize, float heightScale, int tileInnerSize = 64, int albedoInnerSize = 256);
+
+//Keeps the tiles around the camera resident in texture arrays with a fixed number of slots.
+//Tiles are read by a background thread, uploaded on the main thread and evicted in least recently used order.
+//The page table has one mip per level, a texel holds the slot of its tile plus one, zero when not resident.
+class TerrainStreamer
+{
+public:
+	bool Init(const std::string& tilePath, int slotNmb = 64);
+	void Destroy();
+	//Request the tiles around the position and upload the tiles read since the last update
+	void Update(const glm::vec3& cameraPosition);
+	//Bind the page table and tile arrays on three consecutive texture units, the shader must be bound
+	void Bind(Shader& shader, int firstTextureUnit) const;
+	//Normalized height from the finest resident tile covering the world position, the CPU side of find_tile.
+	//Returns false when no tile covers the position yet
+	bool SampleHeight(float x, float z, float& height) const;
+
+	const TerrainTileHeader& GetHeader() const { return header; }
+	const TerrainTileEntry& GetEntry(int level, int tileX, int tileZ) const;
+	int GetTileNmb(int level) const { return (int)header.tileNmb >> level; }
+	float& GetResidencyRadius() { return residencyRadius; }
+	int& GetUploadBudget() { return uploadBudget; }
+	size_t GetResidentNmb() const { return residentTiles.size(); }
+	size_t GetPendingNmb() const { return pendingTiles.size(); }
+	int GetSlotNmb() const { return slotNmb; }
+private:
+	struct TileData
+	{
+		uint32_t key;
+		std::vector<uint16_t> heights;
+		std::vector<uint8_t> albedo;
+	};
+	struct ResidentTile
+	{
+		int slot;
+		std::list<uint32_t>::iterator lruIterator;
+	};
+	static uint32_t MakeKey(int level, int tileX, int tileZ) { return (uint32_t)level << 24 | (uint32_t)tileZ << 12 | (uint32_t)tileX; }
+	void LoadingLoop();
+	bool UploadTile(const TileData& tile, const std::unordered_set<uint32_t>& desiredTiles);
+	void SetPage(uint32_t key, uint16_t value);
+	size_t GetEntryIndex(int level, int tileX, int tileZ) const;
+
+	TerrainTileHeader header;
+	std::vector<TerrainTileEntry> entries;
+	std::string tilePath;
+	int slotNmb = 0;
+	int heightTileSize = 0;
+	int albedoTileSize = 0;
+
+	unsigned pageTable = 0;
+	unsigned heightTiles = 0;
+	unsigned albedoTiles = 0;
+	std::vector<std::vector<uint16_t>> pages;
+	//CPU copy of the heights in each slot for SampleHeight
+	std::vector<std::vector<uint16_t>> slotHeights;
+
+	std::vector<int> freeSlots;
+	std::unordered_map<uint32_t, ResidentTile> residentTiles;
+	//Front is the most recently used
+	std::list<uint32_t> lruTiles;
+	std::unordered_set<uint32_t> pendingTiles;
+	std::deque<TileData> uploadQueue;
+
+	std::thread loadingThread;
+	std::mutex loadingMutex;
+	std::condition_variable loadingCondition;
+	std::deque<uint32_t> requests;
+	std::vector<TileData> loadedTiles;
+	bool running = false;
+
+	float residencyRadius = 1.5f;
+	int uploadBudget = 8;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <graphics.h>
+
+//Signed distance field text for large numbers of debug labels.
+//The glyphs of a TTF are baked once in a distance field atlas cached next to the font ("arial.ttf" -> "arial.sdf"),
+//so any label size stays sharp. Labels are laid out straight into a persistently mapped instance buffer,
+//one instance per glyph, and all of them are drawn by a single instanced draw.
+class TextRenderer
+{
+public:
+	bool Init(const std::string& fontPath = "data/font/arial.ttf", int maxGlyphNmb = 65536);
+	void Destroy();
+	//Start writing the labels of the frame
+	void Begin();
+	//Label centered over a world position, pixelHeight stays the same at any distance
+	void AddWorldText(const std::string& text, const glm::vec3& position, float pixelHeight, const glm::vec4& color = glm::vec4(1.0f));
+	//Label with its top left corner at a pixel position, y down from the top of the screen
+	void AddScreenText(const std::string& text, const glm::vec2& position, float pixelHeight, const glm::vec4& color = glm::vec4(1.0f));
+	//Draw every label of the frame on top of the current framebuffer
+	void Draw(const glm::mat4& view, const glm::mat4& projection);
+
+	//Size in pixels of the text at a pixel height, without drawing it
+	glm::vec2 Measure(const std::string& text, float pixelHeight) const;
+	size_t GetGlyphNmb() const { return glyphNmb; }
+	size_t GetDroppedGlyphNmb() const { return droppedGlyphNmb; }
+private:
+	static constexpr int regionNmb = 3;
+
+	struct Glyph
+	{
+		//Quad relative to the pen on the baseline, y down, in baked pixels
+		glm::vec2 offset;
+		glm::vec2 size;
+		glm::vec4 uvRect;
+		float advance;
+	};
+	struct GlyphInstance
+	{
+		//World position with w = 1, or pixel position with w = 0
+		glm::vec4 anchor;
+		//Pixel offset from the anchor and pixel size
+		glm::vec4 rect;
+		glm::vec4 uvRect;
+		uint32_t color;
+	};
+
+	bool LoadAtlas(const std::string& cachePath);
+	bool BakeAtlas(const std::string& fontPath, const std::string& cachePath);
+	const Glyph& GetGlyph(unsigned char character) const;
+	void AddText(const std::string& text, const glm::vec4& anchor, glm::vec2 origin, float pixelHeight, const glm::vec4& color);
+
+	Shader textShader;
+	unsigned atlasTexture = 0;
+	//Glyph of every Latin-1 character, the missing ones fall back to '?'
+	std::vector<Glyph> glyphs;
+	float bakedSize = 0.0f;
+	float lineHeight = 0.0f;
+	float distanceRange = 0.0f;
+
+	unsigned vao = 0;
+	unsigned instanceBuffer = 0;
+	GlyphInstance* mappedInstances = nullptr;
+	//GLsync of the last draw reading each region
+	void* fences[regionNmb] = {};
+	int maxGlyphNmb = 0;
+	int region = 0;
+	size_t glyphNmb = 0;
+	size_t droppedGlyphNmb = 0;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+#include <glm/glm.hpp>
+#include <graphics.h>
+
+//Makes 2D textures reachable from an index so the shaders select their material without per-draw binds.
+//With ARB_bindless_texture and NV_gpu_shader5 the index leads to a resident handle, otherwise the texture is copied in a
+//GL_TEXTURE_2D_ARRAY page shared with the textures of the same size, format and mip count.
+//Either way the index reads a uvec2 in the EngineTextureResidency SSBO, see sample_resident_texture.
+class TextureResidency
+{
+public:
+	static constexpr int maxPageNmb = 8;
+	static constexpr int pageLayerNmb = 16;
+	static constexpr unsigned ssboBinding = 6;
+
+	void Init(bool allowBindless = true);
+	void Destroy();
+	//Index of the texture, registered once. Set its sampling parameters before, a handle freezes them.
+	//Returns -1 when the texture cannot be made resident.
+	int Register(unsigned texture);
+	//Bind the SSBO and, without bindless, the pages from firstTextureUnit. The shader must be bound.
+	void Bind(Shader& shader, int firstTextureUnit = 0);
+
+	bool IsBindless() const { return bindless; }
+	size_t GetTextureNmb() const { return entries.size(); }
+	size_t GetPageNmb() const { return pages.size(); }
+private:
+	struct Page
+	{
+		unsigned texture = 0;
+		int layerNmb = 0;
+	};
+	//width, height, internal format, level count
+	using PageFormat = std::tuple<int, int, int, int>;
+
+	bool AddToPage(unsigned texture, glm::uvec2& entry);
+	void Upload();
+
+	bool bindless = false;
+	std::vector<Page> pages;
+	std::multimap<PageFormat, int> pagesByFormat;
+	std::map<unsigned, int> indices;
+	//Handle or page and layer of each texture, as the shader reads them
+	std::vector<glm::uvec2> entries;
+	std::vector<uint64_t> residentHandles;
+	unsigned ssbo = 0;
+	bool dirty = false;
+};
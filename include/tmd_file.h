@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <file_utility.h>
+
+//View on a World Machine TMDFile2 chunk, the payload points inside the mapped file.
+//Chunks are "WM", a one byte name length, the name, a 64 bits payload size and the payload,
+//a payload starting with "WM" holds child chunks.
+struct TmdChunk
+{
+	std::string_view name;
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	std::vector<TmdChunk> children;
+};
+
+//Heights in row major order, mapped straight from the file
+struct TmdHeightSpan
+{
+	const float* data = nullptr;
+	int width = 0;
+	int height = 0;
+
+	bool empty() const { return data == nullptr || width == 0 || height == 0; }
+	size_t size() const { return (size_t)width * height; }
+	float operator()(int x, int z) const { return data[(size_t)z * width + x]; }
+	const float* begin() const { return data; }
+	const float* end() const { return data + size(); }
+};
+
+//Zero copy reader of World Machine .tmd files.
+//The heightfield is looked up in a "Heightfield" chunk: width and height as 32 bits integers then the float samples.
+//Project files that were saved without their built terrain only hold the device graph and have no heights.
+class TmdFile
+{
+public:
+	bool Open(const std::string& path);
+	void Close();
+
+	//Slash separated chunk names from the root, e.g. "DEVICEWORLD/Devices"
+	const TmdChunk* FindChunk(const std::string& path) const;
+	const std::vector<TmdChunk>& GetChunks() const { return chunks; }
+	//Empty when the file holds no heightfield
+	const TmdHeightSpan& GetHeights() const { return heights; }
+private:
+	bool ParseChunks(const uint8_t* begin, const uint8_t* end, std::vector<TmdChunk>& chunks, int depth);
+	const TmdChunk* FindHeightfield(const std::vector<TmdChunk>& chunks) const;
+
+	MappedFile file;
+	std::string path;
+	std::vector<TmdChunk> chunks;
+	TmdHeightSpan heights;
+};
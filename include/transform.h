@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+//Transform hierarchy stored as arrays sorted by depth, parents always come before their children.
+//World matrices are cached, only the nodes changed since the last update and their subtrees are recomputed,
+//every depth level is updated in parallel on the job system. Static nodes cost nothing per frame.
+class TransformHierarchy
+{
+public:
+	static constexpr int noParent = -1;
+
+	//Returns a handle that stays valid when the nodes are sorted again
+	int AddNode(int parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+	void Clear();
+	//Recompute the dirty subtrees, returns the number of updated nodes
+	size_t Update();
+
+	void SetLocalPosition(int node, const glm::vec3& position);
+	void SetLocalRotation(int node, const glm::quat& rotation);
+	void SetLocalScale(int node, const glm::vec3& scale);
+	const glm::vec3& GetLocalPosition(int node) const { return localPositions[slots[node]]; }
+	const glm::quat& GetLocalRotation(int node) const { return localRotations[slots[node]]; }
+	const glm::vec3& GetLocalScale(int node) const { return localScales[slots[node]]; }
+	const glm::mat4& GetWorldMatrix(int node) const { return worldMatrices[slots[node]]; }
+	//World matrix before the last update, the same as the world matrix for a node that did not move
+	const glm::mat4& GetPreviousWorldMatrix(int node) const { return previousWorldMatrices[slots[node]]; }
+	int GetParent(int node) const { return parents[slots[node]] == noParent ? noParent : handles[parents[slots[node]]]; }
+	//True when the world matrix changed during the last update
+	bool WasUpdated(int node) const { return updated[slots[node]] != 0; }
+	size_t GetNodeNmb() const { return handles.size(); }
+	size_t GetUpdatedNmb() const { return updatedNmb; }
+private:
+	void SortByDepth();
+
+	//Per slot, in depth order
+	std::vector<int> handles;
+	//Parent slot
+	std::vector<int> parents;
+	std::vector<int> depths;
+	std::vector<glm::vec3> localPositions;
+	std::vector<glm::quat> localRotations;
+	std::vector<glm::vec3> localScales;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<glm::mat4> previousWorldMatrices;
+	//Changed and added flags
+	std::vector<uint8_t> dirty;
+	std::vector<uint8_t> updated;
+	//Handle to slot
+	std::vector<int> slots;
+	//First slot of each depth, plus the end
+	std::vector<size_t> depthStarts;
+	bool sorted = true;
+	size_t updatedNmb = 0;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <file_utility.h>
+
+//Pak archive: a header, the entries sorted by name, the names, then the files each starting on a 64 bytes boundary.
+//The files are stored in name order so mounting directories next to each other reads the archive sequentially.
+struct PakHeader
+{
+	char magic[4] = { 'P', 'A', 'K', 'F' };
+	uint32_t version = 1;
+	uint32_t entryNmb = 0;
+	uint32_t stringTableSize = 0;
+	uint64_t entryOffset = 0;
+	uint64_t stringTableOffset = 0;
+};
+
+enum class PakCompression : uint32_t
+{
+	NONE = 0
+};
+
+struct PakEntry
+{
+	uint64_t offset = 0;
+	uint64_t size = 0;
+	uint32_t nameOffset = 0;
+	uint32_t nameSize = 0;
+	PakCompression compression = PakCompression::NONE;
+	uint32_t padding = 0;
+};
+
+//Pack every file of the directories, the entry names are the paths as the loaders ask for them, e.g. "data/models/x.obj"
+//Excluded paths are left out, e.g. caches the programs write next to the loose files
+bool BuildPak(const std::vector<std::string>& directories, const std::string& outputPath,
+	const std::vector<std::string>& excludedPaths = {});
+
+//Virtual file system: loose directories and pak archives mounted under a path prefix.
+//A lookup goes through the mounts from the last one, so a pak mounted after the directories overrides them.
+//Reads can run on any thread as long as nothing is mounted at the same time.
+class FileSystem
+{
+public:
+	bool MountDirectory(const std::string& directory, const std::string& mountPoint = "");
+	bool MountPak(const std::string& pakPath, const std::string& mountPoint = "");
+	void UnmountAll();
+
+	FileView Read(const std::string& path) const;
+	bool Exists(const std::string& path) const;
+	//Files directly in the directory, from every mount that covers it, sorted and without duplicates
+	std::vector<std::string> List(const std::string& directory) const;
+	//Read on the job system
+	std::future<FileView> ReadAsync(const std::string& path) const;
+private:
+	struct Mount
+	{
+		std::string mountPoint;
+		std::string directory;
+		std::unique_ptr<MappedFile> pak;
+		const PakEntry* entries = nullptr;
+		uint32_t entryNmb = 0;
+		const char* strings = nullptr;
+	};
+	//Path relative to the mount, false when the mount does not cover the path
+	static bool GetRelativePath(const Mount& mount, std::string_view path, std::string_view& relativePath);
+	static const PakEntry* FindEntry(const Mount& mount, std::string_view relativePath);
+
+	std::vector<Mount> mounts;
+};
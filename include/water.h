@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <glm/glm.hpp>
+#include <graphics.h>
+
+//Planar water at a fixed height.
+//The reflection is the scene rendered mirrored under the plane in a reduced resolution target, clipped to what is
+//above the water and refreshed every few frames. The refraction reuses the color and depth of the main pass,
+//copied just before the surface is drawn.
+class Water
+{
+public:
+	//Draw the scene for the reflection with the given view, projection, camera position and clip plane
+	using DrawScene = std::function<void(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, const glm::vec4& clipPlane)>;
+
+	void Init(float height, const glm::vec2& min, const glm::vec2& max);
+	void Destroy();
+	//Render the reflection when it is due, restores the framebuffer and viewport
+	void UpdateReflection(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, const DrawScene& drawScene);
+	//Copy the current color and depth for the refraction then draw the surface over them
+	void Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float near, float far);
+
+	float GetHeight() const { return height; }
+	float& GetReflectionScale() { return reflectionScale; }
+	int& GetReflectionInterval() { return reflectionInterval; }
+	//Multiplies the LOD distances of the reflected scene, below 1 draws it coarser
+	float& GetReflectionLodBias() { return reflectionLodBias; }
+	//Reflections rendered by the last UpdateReflection
+	size_t GetReflectionUpdateNmb() const { return reflectionUpdateNmb; }
+private:
+	void ResizeReflection(int width, int height);
+	void ResizeRefraction(int width, int height);
+
+	Shader waterShader;
+	unsigned emptyVao = 0;
+	unsigned dudvMap = 0;
+	unsigned normalMap = 0;
+
+	unsigned reflectionFbo = 0;
+	unsigned reflectionTexture = 0;
+	unsigned reflectionDepth = 0;
+	int reflectionWidth = 0;
+	int reflectionHeight = 0;
+
+	unsigned refractionFbo = 0;
+	unsigned refractionTexture = 0;
+	unsigned refractionDepth = 0;
+	int refractionWidth = 0;
+	int refractionHeight = 0;
+
+	float height = 0.0f;
+	glm::vec2 min = glm::vec2(0.0f);
+	glm::vec2 max = glm::vec2(0.0f);
+	float reflectionScale = 0.5f;
+	int reflectionInterval = 2;
+	float reflectionLodBias = 0.5f;
+	int framesSinceReflection = 0;
+	bool reflectionValid = false;
+	size_t reflectionUpdateNmb = 0;
+	//Reflected view the texture was rendered with, drawn until the next update
+	glm::mat4 reflectionViewProjection = glm::mat4(1.0f);
+	//Part of the reflection texture covered by its viewport
+	glm::vec2 reflectionUvScale = glm::vec2(1.0f);
+};
@@ -1,3 +1,4 @@
+#include <array>
 #include <map>
 #include <vector>
 
@@ -6,6 +7,11 @@
 #include <camera.h>
 #include <model.h>
 #include <geometry.h>
+#include <occlusion.h>
+#include <render_queue.h>
+#include <render_components.h>
+#include <texture_residency.h>
+#include <text.h>
 
 #include <Remotery.h>
 #include "file_utility.h"
@@ -17,55 +23,103 @@ using json = nlohmann::json;
 #include <glm/glm.hpp>
 
 #include "imgui.h"
+#include <cstdio>
 #include <iostream>
-
-struct buildingElement {
-	Plane* plane;
-	glm::mat4 modelMatrix;
-	glm::vec4 worldPosition;
-	unsigned int texture;
-	Shader* shader;
-	float sphereRadius;
-};
+#include <limits>
 
 struct frustum {
 	glm::vec4 plansNormals[6];
 };
 
+// Per draw data of the building multi draw, read by building.vert at binding 7
+struct BuildingDraw
+{
+	glm::mat4 model;
+	glm::uvec4 texture;
+};
+
+// Everything the painting displacement depends on, the compute pass is skipped while it does not change
+using PaintingParameters = std::array<float, 8>;
+
 class ChaosSceneDrawingProgram : public DrawingProgram
 {
 public:
 	void Init() override;
 	void Draw() override;
+	void DrawOverlay() override;
 	void Destroy() override;
 	void UpdateUi() override;
 	void ProcessInput();
 	void BuildFrustum(Camera& camera);
 	bool CheckFrustum(glm::vec3 position, float size);
 private:
+	glm::mat4 CalculatePaintingMatrix(int paintingIndex);
+	void SetPaintingUniforms(int paintingIndex);
+	PaintingParameters GetPaintingParameters(int paintingIndex);
+	void UpdatePaintingDisplacement(int paintingIndex);
+	void InitOcclusion();
+	void InitBuildingBatch();
+	void UploadBuildingBatch();
+	void DrawBuildingBatch();
+	void AddBuildingElement(unsigned texture, const glm::mat4& modelMatrix);
+	float CalculateScreenSize(const BoundingBox& box, const glm::mat4& viewProjection) const;
+
 	glm::mat4 projection = {};
 	float far = 10000.0f;
 	float near = 0.1f;
 	float fov = 45.0f;
 	frustum mainCameraFrustum;
+	OcclusionCuller occlusionCuller;
+	RenderQueue renderQueue;
 
 	// Building parts
-	std::vector<buildingElement> building;
+	// One entity per plane, culled then submitted by linear scans over the component pools
+	RenderRegistry building;
 	Plane buildingPlane;
+	float buildingCullRadius = sqrt(2.0f) * 30;
 	float buildingPosition[3] = { 0,0,0 };
 	float buildingSize[3] = { 1,1,1 };
 	int buildingDimension[3] = { 10,7,18 };
 	Shader buildingShader;
+	Shader buildingDepthShader;
 	unsigned int buildingWallTexture;
 	unsigned int buildingFloorTexture;	
+	// The visible elements are one multi draw, their textures are selected in the shader
+	TextureResidency textureResidency;
+	std::vector<BuildingDraw> buildingDraws;
+	std::vector<DrawArraysIndirectCommand> buildingCommands;
+	unsigned buildingDrawIndices = 0;
+	unsigned buildingDrawSsbo = 0;
+	unsigned buildingIndirectBuffer = 0;
+	static constexpr unsigned buildingDrawBinding = 7;
+
+	// Window panes inside the building, blended in any order by the transparent pass
+	RenderRegistry windows;
+	Shader transparentShader;
+	unsigned windowTexture = 0;
 
 	// Painting part
-	Grid gridPainting;
+	ProceduralGrid gridPainting;
 	int gridPaintingSize = 250;
+	int gridPaintingLodNmb = 5;
+	// Wanted screen distance between two painting vertices, drives the painting level
+	float paintingPixelsPerVertex = 4.0f;
+	int paintingLods[4] = {};
+	BoundingBox paintingBounds[4];
 	glm::vec3 gridPaintingScale = glm::vec3(0.009375f, 0.009375f, 0.009375f);
 	float paintingSize = sqrt(2 * (gridPaintingSize * gridPaintingSize)) / gridPaintingScale[0];
 	std::vector<glm::vec3> paintingSlotPosition;
 	float paintingYPos = 5.0f;
+	int paintingOccludees[4];
+	// Each painting evaluates its waves in a compute pass, the draw only fetches the result
+	Shader paintingShader;
+	Shader paintingDepthShader;
+	Shader* paintingComputeShaders[4] = { &painting1Shader, &painting2Shader, &painting3Shader, &painting4Shader };
+	float* paintingColors[4] = { painting1Color, painting2Color, painting3Color, painting4Color };
+	unsigned paintingDisplacements[4] = {};
+	PaintingParameters paintingLastParameters[4];
+	bool paintingEvaluated[4] = {};
+	size_t paintingUpdateNmb = 0;
 
 	// Painting 1 attributs
 	Shader painting1Shader;
@@ -102,6 +156,13 @@ private:
 
 	Skybox skybox;
 
+	// Debug labels, every glyph of the frame is one instance of a single draw
+	TextRenderer labels;
+	bool elementLabels = false;
+	// Camera of the frame without the TAA jitter, the labels are drawn after the resolve
+	glm::mat4 labelView = {};
+	glm::mat4 labelProjection = {};
+
 	bool debugMod = false;
 };
 
@@ -112,7 +173,7 @@ void ChaosSceneDrawingProgram::Init()
 	auto& config = engine->GetConfiguration();
 	Camera& camera = engine->GetCamera();
 
-	gridPainting.Init(gridPaintingSize);
+	gridPainting.Init(gridPaintingSize, gridPaintingLodNmb);
 	
 	buildingWallTexture = gliCreateTexture("data/sprites/wall.dds");
 	buildingFloorTexture = gliCreateTexture("data/sprites/floor.dds");
@@ -121,35 +182,49 @@ void ChaosSceneDrawingProgram::Init()
 	glGenerateMipmap(GL_TEXTURE_2D);
 	glBindTexture(GL_TEXTURE_2D, buildingFloorTexture);
 	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	textureResidency.Init();
 
 	buildingShader.CompileSource(
 		"shaders/ChaosScene/building.vert",
 		"shaders/ChaosScene/building.frag");
 	shaders.push_back(&buildingShader);
-
-	painting1Shader.CompileSource(
-		"shaders/ChaosScene/p1.vert",
-		"shaders/ChaosScene/painting.frag"
-	);
-	shaders.push_back(&painting1Shader);
-
-	painting2Shader.CompileSource(
-		"shaders/ChaosScene/p2.vert",
-		"shaders/ChaosScene/painting.frag"
-	);
-	shaders.push_back(&painting2Shader);
-
-	painting3Shader.CompileSource(
-		"shaders/ChaosScene/p3.vert",
-		"shaders/ChaosScene/painting.frag"
-	);
-	shaders.push_back(&painting3Shader);
-
-	painting4Shader.CompileSource(
-		"shaders/ChaosScene/p4.vert",
+	buildingDepthShader.CompileSource(
+		"shaders/ChaosScene/building_depth.vert",
+		"shaders/engine/depth.frag");
+	shaders.push_back(&buildingDepthShader);
+
+	transparentShader.CompileSource(
+		"shaders/engine/model.vert",
+		"shaders/engine/transparent.frag");
+	shaders.push_back(&transparentShader);
+	windowTexture = stbCreateTexture("data/sprites/blending_transparent_window.png", true, true, true);
+
+	paintingShader.CompileSource(
+		"shaders/ChaosScene/painting.vert",
 		"shaders/ChaosScene/painting.frag"
 	);
-	shaders.push_back(&painting4Shader);
+	shaders.push_back(&paintingShader);
+	paintingDepthShader.CompileSource(
+		"shaders/ChaosScene/painting_depth.vert",
+		"shaders/engine/depth.frag");
+	paintingDepthShader.Bind();
+	paintingDepthShader.SetInt("displacement", 0);
+	shaders.push_back(&paintingDepthShader);
+
+	for (int paintingIndex = 0; paintingIndex < 4; paintingIndex++)
+	{
+		paintingComputeShaders[paintingIndex]->CompileCompute("shaders/ChaosScene/p" + std::to_string(paintingIndex + 1) + ".comp");
+
+		glGenTextures(1, &paintingDisplacements[paintingIndex]);
+		glBindTexture(GL_TEXTURE_2D, paintingDisplacements[paintingIndex]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, gridPaintingSize, gridPaintingSize);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
 
 	camera.Position.x = cameraPosition[0];
 	camera.Position.y = cameraPosition[1];
@@ -162,31 +237,16 @@ void ChaosSceneDrawingProgram::Init()
 	{
 		for (int z = 0; z < buildingDimension[2]; z++)
 		{
-			buildingElement element;
-
-			element.texture = buildingFloorTexture;
-
-			element.shader = &buildingShader;
-
-			element.plane = &buildingPlane;
-
-			glm::vec4 position = {
+			const glm::vec3 position = {
 				buildingPosition[0] + (x * buildingSize[0]),
 				buildingPosition[1],
-				buildingPosition[2] + (z * buildingSize[2]),
-				1.0f
+				buildingPosition[2] + (z * buildingSize[2])
 			};
 
-			element.modelMatrix = glm::mat4(1.0f);
-			element.modelMatrix = glm::translate(element.modelMatrix, glm::vec3(position.x, position.y, position.z));
-			element.modelMatrix = glm::rotate(element.modelMatrix, glm::radians(90.0f), glm::vec3(1, 0, 0));
-			element.modelMatrix = glm::scale(element.modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
-
-			element.worldPosition = element.modelMatrix * position;
-
-			element.sphereRadius = sqrt(buildingSize[0] * buildingSize[0] + buildingSize[1] * buildingSize[1]) * 30;
-
-			building.push_back(element);
+			glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position);
+			modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1, 0, 0));
+			modelMatrix = glm::scale(modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
+			AddBuildingElement(buildingFloorTexture, modelMatrix);
 		}
 	}
 
@@ -195,31 +255,16 @@ void ChaosSceneDrawingProgram::Init()
 	{
 		for (int z = 0; z < buildingDimension[2]; z++)
 		{
-			buildingElement element;
-
-			element.texture = buildingWallTexture;
-
-			element.shader = &buildingShader;
-
-			element.plane = &buildingPlane;
-
-			glm::vec4 position = {
+			const glm::vec3 position = {
 				buildingPosition[0] - buildingSize[0],
 				buildingPosition[1] + (y * buildingSize[1]) + buildingSize[1],
-				buildingPosition[2] + (z * buildingSize[2]),
-				1.0f
+				buildingPosition[2] + (z * buildingSize[2])
 			};
 
-			element.modelMatrix = glm::mat4(1.0f);
-			element.modelMatrix = glm::translate(element.modelMatrix, glm::vec3(position.x, position.y, position.z));
-			element.modelMatrix = glm::rotate(element.modelMatrix, glm::radians(90.0f), glm::vec3(0, 1, 0));
-			element.modelMatrix = glm::scale(element.modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
-			
-			element.worldPosition = element.modelMatrix * position;
-
-			element.sphereRadius = sqrt(buildingSize[0] * buildingSize[0] + buildingSize[1] * buildingSize[1]) * 30;
-
-			building.push_back(element);
+			glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position);
+			modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(0, 1, 0));
+			modelMatrix = glm::scale(modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
+			AddBuildingElement(buildingWallTexture, modelMatrix);
 
 			if (z % 5 == 0)
 				paintingSlotPosition.push_back(glm::vec3(position.x, paintingYPos, position.z));
@@ -231,31 +276,16 @@ void ChaosSceneDrawingProgram::Init()
 	{
 		for (int z = 0; z < buildingDimension[2]; z++)
 		{
-			buildingElement element;
-
-			element.texture = buildingWallTexture;
-
-			element.shader = &buildingShader;
-
-			element.plane = &buildingPlane;
-
-			glm::vec4 position = {
+			const glm::vec3 position = {
 				buildingPosition[0] + buildingSize[0] * buildingDimension[0],
 				buildingPosition[1] + (y* buildingSize[1]) + buildingSize[1],
-				buildingPosition[2] + (z* buildingSize[2]),
-				1.0f
+				buildingPosition[2] + (z* buildingSize[2])
 			};
 
-			element.modelMatrix = glm::mat4(1.0f);
-			element.modelMatrix = glm::translate(element.modelMatrix, glm::vec3(position.x, position.y, position.z));
-			element.modelMatrix = glm::rotate(element.modelMatrix, glm::radians(90.0f), glm::vec3(0, 1, 0));
-			element.modelMatrix = glm::scale(element.modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
-
-			element.worldPosition = element.modelMatrix * position;
-
-			element.sphereRadius = sqrt(buildingSize[0] * buildingSize[0] + buildingSize[1] * buildingSize[1]) * 30;
-
-			building.push_back(element);
+			glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position);
+			modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(0, 1, 0));
+			modelMatrix = glm::scale(modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
+			AddBuildingElement(buildingWallTexture, modelMatrix);
 
 			if (z % 5 == 0)
 				paintingSlotPosition.push_back(glm::vec3(position.x, paintingYPos, position.z));
@@ -267,30 +297,15 @@ void ChaosSceneDrawingProgram::Init()
 	{
 		for (int x = 0; x < buildingDimension[0]; x++)
 		{
-			buildingElement element;
-
-			element.texture = buildingWallTexture;
-
-			element.shader = &buildingShader;
-
-			element.plane = &buildingPlane;
-
-			glm::vec4 position = {
+			const glm::vec3 position = {
 				buildingPosition[0] + (x* buildingSize[0]),
 				buildingPosition[1] + (y* buildingSize[1]) + buildingSize[1],
-				buildingPosition[2] - buildingSize[2],
-				1.0f
+				buildingPosition[2] - buildingSize[2]
 			};
 
-			element.modelMatrix = glm::mat4(1.0f);
-			element.modelMatrix = glm::translate(element.modelMatrix, glm::vec3(position.x, position.y, position.z));
-			element.modelMatrix = glm::scale(element.modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
-
-			element.worldPosition = element.modelMatrix * position;
-
-			element.sphereRadius = sqrt(buildingSize[0] * buildingSize[0] + buildingSize[1] * buildingSize[1]) * 30;
-
-			building.push_back(element);
+			glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position);
+			modelMatrix = glm::scale(modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
+			AddBuildingElement(buildingWallTexture, modelMatrix);
 		}
 	}
 
@@ -299,30 +314,15 @@ void ChaosSceneDrawingProgram::Init()
 	{
 		for (int x = 0; x < buildingDimension[0]; x++)
 		{
-			buildingElement element;
-
-			element.texture = buildingWallTexture;
-
-			element.shader = &buildingShader;
-
-			element.plane = &buildingPlane;
-
-			glm::vec4 position = {
+			const glm::vec3 position = {
 				buildingPosition[0] + (x* buildingSize[0]),
 				buildingPosition[1] + (y* buildingSize[1]) + buildingSize[1],
-				buildingPosition[2] + buildingSize[2] * buildingDimension[2],
-				1.0f
+				buildingPosition[2] + buildingSize[2] * buildingDimension[2]
 			};
 
-			element.modelMatrix = glm::mat4(1.0f);
-			element.modelMatrix = glm::translate(element.modelMatrix, glm::vec3(position.x, position.y, position.z));
-			element.modelMatrix = glm::scale(element.modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
-
-			element.worldPosition = element.modelMatrix * position;
-			
-			element.sphereRadius = sqrt(buildingSize[0] * buildingSize[0] + buildingSize[1] * buildingSize[1]) * 30;
-
-			building.push_back(element);
+			glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position);
+			modelMatrix = glm::scale(modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
+			AddBuildingElement(buildingWallTexture, modelMatrix);
 		}
 	}
 
@@ -338,6 +338,36 @@ void ChaosSceneDrawingProgram::Init()
 
 	skybox.Init(faces);
 
+	// Overlapping rows of windows across the building
+	for (int row = 0; row < 3; row++)
+	{
+		for (int x = 0; x < 3; x++)
+		{
+			glm::mat4 modelMatrix = glm::mat4(1.0f);
+			modelMatrix = glm::translate(modelMatrix, glm::vec3(
+				buildingPosition[0] + buildingSize[0] * (2.0f + x * 3.0f + row * 0.5f),
+				buildingPosition[1] + buildingSize[1] * 2.0f,
+				buildingPosition[2] + buildingSize[2] * (11.0f + row * 1.5f)));
+			modelMatrix = glm::scale(modelMatrix, glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]));
+			const Entity entity = windows.Create();
+			windows.Add(entity, TransformComponent{ modelMatrix });
+			windows.Add(entity, MeshComponent{ buildingPlane.GetVAO(), 6, false });
+			MaterialComponent material;
+			material.shader = &transparentShader;
+			material.textures[0] = windowTexture;
+			material.samplerNames[0] = "material.texture_diffuse1";
+			material.textureNmb = 1;
+			material.transparent = true;
+			material.sortKey = GetMaterialSortKey(material);
+			windows.Add(entity, material);
+		}
+	}
+
+	InitOcclusion();
+	InitBuildingBatch();
+	renderQueue.Init();
+	labels.Init();
+
 	std::cout << paintingSlotPosition.size();
 }
 
@@ -350,151 +380,394 @@ void ChaosSceneDrawingProgram::Draw()
 	projection = glm::perspective(glm::radians(fov), (float)config.screenWidth / (float)config.screenHeight, near, far);
 
 	BuildFrustum(camera);
-
-	skybox.SetViewMatrix(camera.GetViewMatrix());
-	skybox.SetProjectionMatrix(projection);
-	skybox.Draw();
-
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_TEXTURE_2D);
+	occlusionCuller.Update(projection * camera.GetViewMatrix());
+	Engine::GetPtr()->SetFrameCounter("CPU occlusion culled", occlusionCuller.GetCulledNmb());
 
 	ProcessInput();
 
-	// building rendering
-	glm::mat4 modelMatrix = glm::mat4(1.0f);
-	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// Everything opaque goes through the queue sorted front to back, the building is a single multi draw
+	const glm::mat4 view = camera.GetViewMatrix();
+	labelView = view;
+	labelProjection = projection;
+	projection = engine->JitterProjection(view, projection);
+	glBindFramebuffer(GL_FRAMEBUFFER, engine->GetSceneFramebuffer());
+	glEnable(GL_DEPTH_TEST);
+	renderQueue.Begin(view, projection, near, far);
 
-		for (int i = 0; i < building.size(); i++)
+	buildingShader.Bind();
+	buildingShader.SetMat4("projection", projection);
+	buildingShader.SetMat4("view", view);
+	building.ParallelEach<VisibilityComponent, BoundsComponent>(engine->GetJobSystem(), 256,
+		[this](Entity, VisibilityComponent& visibility, const BoundsComponent& bounds)
+	{
+		const glm::vec3 center = (bounds.worldBounds.min + bounds.worldBounds.max) * 0.5f;
+		visibility.visible = CheckFrustum(center, buildingCullRadius) && occlusionCuller.IsVisible(bounds.cullIndex);
+	});
+	buildingDraws.clear();
+	buildingCommands.clear();
+	building.Each<VisibilityComponent, TransformComponent, MeshComponent, MaterialComponent>(
+		[this](Entity, const VisibilityComponent& visibility, const TransformComponent& transform,
+			const MeshComponent& mesh, const MaterialComponent& material)
+	{
+		if (!visibility.visible || material.residentTexture < 0)
+			return;
+		// The base instance feeds the per draw index attribute
+		buildingCommands.push_back({ mesh.elementNmb, 1, 0, (unsigned)buildingDraws.size() });
+		buildingDraws.push_back({ transform.modelMatrix, glm::uvec4((unsigned)material.residentTexture, 0, 0, 0) });
+	});
+	if (!buildingCommands.empty())
+	{
+		DrawPacket packet;
+		packet.shader = &buildingShader;
+		packet.mesh = buildingPlane.GetVAO();
+		packet.worldCenter = glm::vec3(buildingPosition[0], buildingPosition[1], buildingPosition[2]) +
+			0.5f * glm::vec3(buildingDimension[0], buildingDimension[1], buildingDimension[2]) *
+			glm::vec3(buildingSize[0], buildingSize[1], buildingSize[2]);
+		// The matrices come from the draw buffer, the depth prepass reads them with its own vertex shader
+		UploadBuildingBatch();
+		packet.draw = [this]()
 		{
-			if (!CheckFrustum(building[i].worldPosition, building[i].sphereRadius))
-				continue;
-
-			building[i].shader->Bind();
-
-			building[i].shader->SetMat4("projection", projection);
-			building[i].shader->SetMat4("view", camera.GetViewMatrix());
-			building[i].shader->SetInt("activeTexture", 0);
-			building[i].shader->SetMat4("model", building[i].modelMatrix);
+			textureResidency.Bind(buildingShader);
+			DrawBuildingBatch();
+		};
+		packet.drawGeometry = [this]() { DrawBuildingBatch(); };
+		packet.depthShader = &buildingDepthShader;
+		renderQueue.Submit(packet);
+	}
+	engine->SetFrameCounter("Building draws", buildingCommands.size());
 
+	transparentShader.Bind();
+	transparentShader.SetMat4("projection", projection);
+	transparentShader.SetMat4("view", view);
+	windows.Each<TransformComponent, MeshComponent, MaterialComponent>(
+		[this](Entity, const TransformComponent& transform, const MeshComponent& mesh, const MaterialComponent& material)
+	{
+		const glm::vec3 center = glm::vec3(transform.modelMatrix[3]);
+		if (!CheckFrustum(center, buildingCullRadius))
+			return;
+		DrawPacket packet;
+		packet.pass = RenderPass::TRANSPARENT_PASS;
+		packet.shader = material.shader;
+		packet.material = material.sortKey;
+		packet.mesh = mesh.vao;
+		packet.modelMatrix = transform.modelMatrix;
+		packet.worldCenter = center;
+		packet.draw = [&mesh, &material]()
+		{
+			BindMaterialComponent(material);
+			DrawMeshComponent(mesh);
+		};
+		renderQueue.Submit(packet);
+	});
+
+	// The paintings are displaced by their compute pass, the depth prepass fetches the same displacement
+	size_t paintingTriangleNmb = 0;
+	paintingUpdateNmb = 0;
+	paintingShader.Bind();
+	paintingShader.SetMat4("projection", projection);
+	paintingShader.SetMat4("view", view);
+	paintingShader.SetInt("displacement", 0);
+	for (int paintingIndex = 0; paintingIndex < 4; paintingIndex++)
+	{
+		if (!CheckFrustum(paintingSlotPosition[paintingIndex], paintingSize) || !occlusionCuller.IsVisible(paintingOccludees[paintingIndex]))
+			continue;
+
+		UpdatePaintingDisplacement(paintingIndex);
+
+		// Far paintings use a coarser grid over the same extent, its vertices fall between the fine ones and read the
+		// displacement texture filtered at their own position
+		const int lod = gridPainting.SelectLod(CalculateScreenSize(paintingBounds[paintingIndex], projection * view), paintingPixelsPerVertex);
+		paintingLods[paintingIndex] = lod;
+		paintingTriangleNmb += gridPainting.GetTriangleNmb(lod);
+
+		DrawPacket packet;
+		packet.shader = &paintingShader;
+		packet.material = paintingDisplacements[paintingIndex];
+		packet.mesh = gridPainting.GetVAO();
+		packet.modelMatrix = CalculatePaintingMatrix(paintingIndex);
+		packet.worldCenter = glm::vec3(packet.modelMatrix * glm::vec4(gridPaintingSize * 0.5f, 0.0f, gridPaintingSize * 0.5f, 1.0f));
+		packet.draw = [this, paintingIndex, lod]()
+		{
+			paintingShader.SetVec3("vertexColor", paintingColors[paintingIndex]);
 			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, building[i].texture);
+			glBindTexture(GL_TEXTURE_2D, paintingDisplacements[paintingIndex]);
+			gridPainting.Draw(paintingShader, lod);
+		};
+		packet.drawGeometry = [this, paintingIndex, lod]()
+		{
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, paintingDisplacements[paintingIndex]);
+			gridPainting.Draw(paintingDepthShader, lod);
+		};
+		packet.depthShader = &paintingDepthShader;
+		renderQueue.Submit(packet);
+	}
+	// Displacements written this frame are read by the vertex fetches
+	if (paintingUpdateNmb > 0)
+	{
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+	renderQueue.Flush();
+	engine->SetFrameCounter("Draw calls", renderQueue.GetDrawCallNmb());
+	engine->SetFrameCounter("Transparent draws", renderQueue.GetTransparentDrawNmb());
+	engine->SetFrameCounter("Painting triangles", paintingTriangleNmb);
+	engine->SetFrameCounter("Painting updates", paintingUpdateNmb);
+
+	// Drawn last at the far plane, only where nothing else covered the screen
+	skybox.SetViewMatrix(view);
+	skybox.SetProjectionMatrix(projection);
+	skybox.Draw();
+}
 
-			building[i].plane->Draw();
+void ChaosSceneDrawingProgram::DrawOverlay()
+{
+	labels.Begin();
+	if (elementLabels)
+	{
+		building.Each<VisibilityComponent, BoundsComponent>(
+			[this](Entity entity, const VisibilityComponent& visibility, const BoundsComponent& bounds)
+		{
+			if (visibility.visible)
+				labels.AddWorldText(std::to_string(entity), (bounds.worldBounds.min + bounds.worldBounds.max) * 0.5f, 14.0f);
+		});
+		for (int paintingIndex = 0; paintingIndex < 4; paintingIndex++)
+		{
+			char label[32];
+			snprintf(label, sizeof(label), "Painting %d\nlevel %d", paintingIndex + 1, paintingLods[paintingIndex]);
+			labels.AddWorldText(label, paintingBounds[paintingIndex].max, 20.0f, glm::vec4(1.0f, 0.9f, 0.4f, 1.0f));
 		}
 	}
+	char status[128];
+	snprintf(status, sizeof(status), "%zu building draws\n%zu transparent draws\n%zu draw calls",
+		buildingCommands.size(), renderQueue.GetTransparentDrawNmb(), renderQueue.GetDrawCallNmb());
+	labels.AddScreenText(status, glm::vec2(10.0f, 10.0f), 18.0f);
+	labels.Draw(labelView, labelProjection);
+	Engine::GetPtr()->SetFrameCounter("Text glyphs", labels.GetGlyphNmb());
+}
 
-	int paintingPosIndex = 0;
-
-	glEnable(GL_DEPTH_TEST);
-	// Painting 1 rendering
-	if(CheckFrustum(paintingSlotPosition[paintingPosIndex], paintingSize))
+void ChaosSceneDrawingProgram::SetPaintingUniforms(int paintingIndex)
+{
+	const PaintingParameters parameters = GetPaintingParameters(paintingIndex);
+	Shader& shader = *paintingComputeShaders[paintingIndex];
+	shader.SetInt("gridResolution", gridPaintingSize);
+	switch (paintingIndex)
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		painting1Shader.Bind();
-		modelMatrix = glm::mat4(1.0f);
-		modelMatrix = glm::translate(modelMatrix, paintingSlotPosition[paintingPosIndex]);
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1, 0, 0));
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(0, 0, 1));
-		modelMatrix = glm::scale(modelMatrix, gridPaintingScale);
-
-		painting1Shader.SetMat4("model", modelMatrix);
-		painting1Shader.SetMat4("projection", projection);
-		painting1Shader.SetMat4("view", camera.GetViewMatrix());
-		painting1Shader.SetVec3("vertexColor", painting1Color);
-		painting1Shader.SetFloat("speed", painting1Speed);
-		painting1Shader.SetFloat("amount", painting1Amount);
-		painting1Shader.SetFloat("height", painting1Height);
-		painting1Shader.SetFloat("timeSinceStart", engine->GetTimeSinceInit());
-
-		gridPainting.Draw();
-		
+	case 0:
+		shader.SetFloat("speed", parameters[0]);
+		shader.SetFloat("amount", parameters[1]);
+		shader.SetFloat("height", parameters[2]);
+		shader.SetFloat("timeSinceStart", parameters[3]);
+		break;
+	case 1:
+		shader.SetVec2("center", parameters[0], parameters[1]);
+		shader.SetFloat("angle", parameters[2]);
+		shader.SetFloat("speed", parameters[3]);
+		shader.SetFloat("amount", parameters[4]);
+		shader.SetFloat("height", parameters[5]);
+		shader.SetFloat("timeSinceStart", parameters[6]);
+		break;
+	case 2:
+		shader.SetVec2("center", parameters[0], parameters[1]);
+		shader.SetFloat("angle", parameters[2]);
+		shader.SetFloat("speed", parameters[3]);
+		shader.SetFloat("height", parameters[4]);
+		shader.SetFloat("timeSinceStart", parameters[5]);
+		break;
+	case 3:
+		shader.SetFloat("height", parameters[0]);
+		shader.SetFloat("amount", parameters[1]);
+		shader.SetFloat("timeSinceStart", parameters[2]);
+		break;
+	default:
+		break;
 	}
+}
 
-	paintingPosIndex++;
-
-	// Painting 2 rendering
-	if (CheckFrustum(paintingSlotPosition[paintingPosIndex], paintingSize))
+PaintingParameters ChaosSceneDrawingProgram::GetPaintingParameters(int paintingIndex)
+{
+	const float time = Engine::GetPtr()->GetTimeSinceInit();
+	switch (paintingIndex)
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		painting2Shader.Bind();
-		modelMatrix = glm::mat4(1.0f);
-		modelMatrix = glm::translate(modelMatrix, paintingSlotPosition[paintingPosIndex]);
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1, 0, 0));
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(0, 0, 1));
-		modelMatrix = glm::scale(modelMatrix, gridPaintingScale);
-
-		painting2Shader.SetMat4("model", modelMatrix);
-		painting2Shader.SetMat4("projection", projection);
-		painting2Shader.SetMat4("view", camera.GetViewMatrix());
-		painting2Shader.SetVec3("vertexColor", painting2Color);
-		painting2Shader.SetVec2("center", painting3Center[0], painting3Center[1]);
-		painting2Shader.SetFloat("angle", painting2Angle);
-		painting2Shader.SetFloat("speed", painting2Speed);
-		painting2Shader.SetFloat("amount", painting2Amount);
-		painting2Shader.SetFloat("height", painting2Height);
-		painting2Shader.SetFloat("timeSinceStart", painting2Time);
-
-		gridPainting.Draw();
+	case 0:
+		return { painting1Speed, painting1Amount, painting1Height, time };
+	case 1:
+		// Painting 2 is frozen at a fixed time, it is only evaluated again when a parameter changes
+		return { painting3Center[0], painting3Center[1], painting2Angle, painting2Speed, painting2Amount, painting2Height, painting2Time };
+	case 2:
+		return { painting3Center[0], painting3Center[1], painting3Angle, painting3Speed, painting3Height, time };
+	case 3:
+		return { painting4Height, painting4Amount, time };
+	default:
+		return {};
 	}
+}
 
-	paintingPosIndex++;
+void ChaosSceneDrawingProgram::UpdatePaintingDisplacement(int paintingIndex)
+{
+	const PaintingParameters parameters = GetPaintingParameters(paintingIndex);
+	if (paintingEvaluated[paintingIndex] && parameters == paintingLastParameters[paintingIndex])
+		return;
+	rmt_ScopedOpenGLSample(UpdatePaintingDisplacement);
+	paintingLastParameters[paintingIndex] = parameters;
+	paintingEvaluated[paintingIndex] = true;
+	paintingUpdateNmb++;
+
+	paintingComputeShaders[paintingIndex]->Bind();
+	SetPaintingUniforms(paintingIndex);
+	glBindImageTexture(0, paintingDisplacements[paintingIndex], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glDispatchCompute((gridPaintingSize + 7) / 8, (gridPaintingSize + 7) / 8, 1);
+}
+
+glm::mat4 ChaosSceneDrawingProgram::CalculatePaintingMatrix(int paintingIndex)
+{
+	glm::mat4 modelMatrix = glm::mat4(1.0f);
+	modelMatrix = glm::translate(modelMatrix, paintingSlotPosition[paintingIndex]);
+	modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1, 0, 0));
+	modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(0, 0, 1));
+	modelMatrix = glm::scale(modelMatrix, gridPaintingScale);
+	return modelMatrix;
+}
+
+void ChaosSceneDrawingProgram::InitBuildingBatch()
+{
+	// Draw index i is stored at i, a command with base instance i reads it
+	std::vector<unsigned> drawIndices(building.GetPool<TransformComponent>().GetComponents().size());
+	for (unsigned i = 0; i < drawIndices.size(); i++)
+		drawIndices[i] = i;
+	glBindVertexArray(buildingPlane.GetVAO());
+	glGenBuffers(1, &buildingDrawIndices);
+	glBindBuffer(GL_ARRAY_BUFFER, buildingDrawIndices);
+	glBufferData(GL_ARRAY_BUFFER, drawIndices.size() * sizeof(unsigned), drawIndices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(5);
+	glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(unsigned), (void*)0);
+	glVertexAttribDivisor(5, 1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &buildingDrawSsbo);
+	glGenBuffers(1, &buildingIndirectBuffer);
+}
+
+void ChaosSceneDrawingProgram::UploadBuildingBatch()
+{
+	// Once per frame, the depth prepass and the color pass draw from the same buffers
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buildingDrawSsbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, buildingDraws.size() * sizeof(BuildingDraw), buildingDraws.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buildingIndirectBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, buildingCommands.size() * sizeof(DrawArraysIndirectCommand), buildingCommands.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
 
-	// Painting 3 rendering
-	if (CheckFrustum(paintingSlotPosition[paintingPosIndex], paintingSize))
+void ChaosSceneDrawingProgram::DrawBuildingBatch()
+{
+	rmt_ScopedOpenGLSample(DrawBuildingBatch);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, buildingDrawBinding, buildingDrawSsbo);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buildingIndirectBuffer);
+	glBindVertexArray(buildingPlane.GetVAO());
+	glMultiDrawArraysIndirect(GL_TRIANGLES, nullptr, (GLsizei)buildingCommands.size(), 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ChaosSceneDrawingProgram::AddBuildingElement(unsigned texture, const glm::mat4& modelMatrix)
+{
+	const Entity entity = building.Create();
+	building.Add(entity, TransformComponent{ modelMatrix });
+	building.Add(entity, BoundsComponent());
+	building.Add(entity, MeshComponent{ buildingPlane.GetVAO(), 6, false });
+	MaterialComponent material;
+	material.shader = &buildingShader;
+	material.textures[0] = texture;
+	material.samplerNames[0] = "activeTexture";
+	material.textureNmb = 1;
+	material.sortKey = GetMaterialSortKey(material);
+	material.residentTexture = textureResidency.Register(texture);
+	building.Add(entity, material);
+	building.Add(entity, VisibilityComponent());
+}
+
+void ChaosSceneDrawingProgram::InitOcclusion()
+{
+	occlusionCuller.Init();
+
+	// Every building element is an occludee, each side of the building is a single large occluder
+	const BoundingBox planeBox = { glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f) };
+	const int sideElementNmb[5] = {
+		buildingDimension[0] * buildingDimension[2], // floor
+		buildingDimension[1] * buildingDimension[2], // right walls
+		buildingDimension[1] * buildingDimension[2], // left walls
+		buildingDimension[1] * buildingDimension[0], // back walls
+		buildingDimension[1] * buildingDimension[0]  // front walls
+	};
+	auto& elementBounds = building.GetPool<BoundsComponent>();
+	const auto& elementTransforms = building.GetPool<TransformComponent>().GetComponents();
+	int elementIndex = 0;
+	for (const int elementNmb : sideElementNmb)
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		painting3Shader.Bind();
-		modelMatrix = glm::mat4(1.0f);
-		modelMatrix = glm::translate(modelMatrix, paintingSlotPosition[paintingPosIndex]);
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1, 0, 0));
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(0, 0, 1));
-		modelMatrix = glm::scale(modelMatrix, gridPaintingScale);
-
-		painting3Shader.SetMat4("model", modelMatrix);
-		painting3Shader.SetMat4("projection", projection);
-		painting3Shader.SetMat4("view", camera.GetViewMatrix());
-		painting3Shader.SetVec3("viewPos", camera.Position);
-		painting3Shader.SetVec3("vertexColor", painting3Color);
-		
-		painting3Shader.SetVec2("center", painting3Center[0], painting3Center[1]);
-		painting3Shader.SetFloat("angle", painting3Angle);
-		painting3Shader.SetFloat("speed", painting3Speed);
-		painting3Shader.SetFloat("height", painting3Height);
-
-		painting3Shader.SetFloat("timeSinceStart", engine->GetTimeSinceInit());
-
-		gridPainting.Draw();
-	}
+		BoundingBox sideBox;
+		sideBox.min = glm::vec3(std::numeric_limits<float>::max());
+		sideBox.max = glm::vec3(-std::numeric_limits<float>::max());
+		for (int i = 0; i < elementNmb; i++, elementIndex++)
+		{
+			const BoundingBox elementBox = TransformBoundingBox(planeBox, elementTransforms[elementIndex].modelMatrix);
+			elementBounds.GetComponents()[elementIndex] = { elementBox, occlusionCuller.RegisterOccludee(elementBox) };
+			sideBox.min = glm::min(sideBox.min, elementBox.min);
+			sideBox.max = glm::max(sideBox.max, elementBox.max);
+		}
 
-	paintingPosIndex++;
+		// The side is flat along its smallest extent, build the quad covering the two others
+		const glm::vec3 extent = sideBox.max - sideBox.min;
+		int flatAxis = 0;
+		if (extent.y < extent[flatAxis])
+			flatAxis = 1;
+		if (extent.z < extent[flatAxis])
+			flatAxis = 2;
+		glm::vec3 corners[4];
+		for (int i = 0; i < 4; i++)
+		{
+			corners[i][flatAxis] = (sideBox.min[flatAxis] + sideBox.max[flatAxis]) * 0.5f;
+			corners[i][(flatAxis + 1) % 3] = i & 1 ? sideBox.max[(flatAxis + 1) % 3] : sideBox.min[(flatAxis + 1) % 3];
+			corners[i][(flatAxis + 2) % 3] = i & 2 ? sideBox.max[(flatAxis + 2) % 3] : sideBox.min[(flatAxis + 2) % 3];
+		}
+		occlusionCuller.RegisterOccluder({ corners[0], corners[1], corners[3], corners[0], corners[3], corners[2] });
+	}
 
-	// Painting 4 rendering
-	if (CheckFrustum(paintingSlotPosition[paintingPosIndex], paintingSize))
+	// Paintings are displaced along the grid local y axis
+	const float maxPaintingHeight = 10.0f;
+	const BoundingBox paintingBox = {
+		glm::vec3(0.0f, -maxPaintingHeight, 0.0f),
+		glm::vec3(gridPaintingSize - 1, maxPaintingHeight, gridPaintingSize - 1) };
+	for (int i = 0; i < 4; i++)
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		painting4Shader.Bind();
-		modelMatrix = glm::mat4(1.0f);
-		modelMatrix = glm::translate(modelMatrix, paintingSlotPosition[paintingPosIndex]);
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1, 0, 0));
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(0, 0, 1));
-		modelMatrix = glm::scale(modelMatrix, gridPaintingScale);
-
-		painting4Shader.SetMat4("model", modelMatrix);
-		painting4Shader.SetMat4("projection", projection);
-		painting4Shader.SetMat4("view", camera.GetViewMatrix());
-		painting4Shader.SetVec3("viewPos", camera.Position);
-		painting4Shader.SetVec3("vertexColor", painting4Color);
-
-		painting4Shader.SetFloat("height", painting4Height);
-		painting4Shader.SetFloat("amount", painting4Amount);
-
-		painting4Shader.SetFloat("timeSinceStart", engine->GetTimeSinceInit());
-
-		gridPainting.Draw();
+		paintingBounds[i] = TransformBoundingBox(paintingBox, CalculatePaintingMatrix(i));
+		paintingOccludees[i] = occlusionCuller.RegisterOccludee(paintingBounds[i]);
 	}
+}
 
-	paintingPosIndex++;
+float ChaosSceneDrawingProgram::CalculateScreenSize(const BoundingBox& box, const glm::mat4& viewProjection) const
+{
+	auto& config = Engine::GetPtr()->GetConfiguration();
+	glm::vec2 screenMin(std::numeric_limits<float>::max());
+	glm::vec2 screenMax(-std::numeric_limits<float>::max());
+	for (int i = 0; i < 8; i++)
+	{
+		const glm::vec4 corner(
+			i & 1 ? box.max.x : box.min.x,
+			i & 2 ? box.max.y : box.min.y,
+			i & 4 ? box.max.z : box.min.z,
+			1.0f);
+		const glm::vec4 clip = viewProjection * corner;
+		// Crossing the near plane, the box can cover the whole screen
+		if (clip.w <= near)
+			return (float)std::max(config.screenWidth, config.screenHeight);
+		const glm::vec2 ndc = glm::vec2(clip) / clip.w;
+		screenMin = glm::min(screenMin, ndc);
+		screenMax = glm::max(screenMax, ndc);
+	}
+	const glm::vec2 extent = glm::min(screenMax, glm::vec2(1.0f)) - glm::max(screenMin, glm::vec2(-1.0f));
+	return std::max(extent.x * 0.5f * config.screenWidth, extent.y * 0.5f * config.screenHeight);
 }
 
 void ChaosSceneDrawingProgram::BuildFrustum(Camera& camera)
@@ -530,10 +803,8 @@ void ChaosSceneDrawingProgram::BuildFrustum(Camera& camera)
 
 	// Normalize near plane
 	mainCameraFrustum.plansNormals[0] = 
-		mainCameraFrustum.plansNormals[0] / 
-		sqrt(pow(mainCameraFrustum.plansNormals[0].x, 2) + 
-			pow(mainCameraFrustum.plansNormals[0].y, 2) + 
-			pow(mainCameraFrustum.plansNormals[0].z, 2));
+		mainCameraFrustum.plansNormals[0] /
+		glm::length(glm::vec3(mainCameraFrustum.plansNormals[0]));
 
 	// Far plane
 	mainCameraFrustum.plansNormals[1].x = vp[0][3] - vp[0][2];
@@ -544,9 +815,7 @@ void ChaosSceneDrawingProgram::BuildFrustum(Camera& camera)
 	// Normalize far plane
 	mainCameraFrustum.plansNormals[1] =
 		mainCameraFrustum.plansNormals[1] /
-		sqrt(pow(mainCameraFrustum.plansNormals[1].x, 2) +
-			pow(mainCameraFrustum.plansNormals[1].y, 2) +
-			pow(mainCameraFrustum.plansNormals[1].z, 2));
+		glm::length(glm::vec3(mainCameraFrustum.plansNormals[1]));
 
 	// Bottom plane
 	mainCameraFrustum.plansNormals[2].x = vp[0][3] + vp[0][1];
@@ -557,9 +826,7 @@ void ChaosSceneDrawingProgram::BuildFrustum(Camera& camera)
 	// Normalize bottom plane
 	mainCameraFrustum.plansNormals[2] =
 		mainCameraFrustum.plansNormals[2] /
-		sqrt(pow(mainCameraFrustum.plansNormals[2].x, 2) +
-			pow(mainCameraFrustum.plansNormals[2].y, 2) +
-			pow(mainCameraFrustum.plansNormals[2].z, 2));
+		glm::length(glm::vec3(mainCameraFrustum.plansNormals[2]));
 
 	// Top plane
 	mainCameraFrustum.plansNormals[3].x = vp[0][3] - vp[0][1];
@@ -570,9 +837,7 @@ void ChaosSceneDrawingProgram::BuildFrustum(Camera& camera)
 	// Normalize top plane
 	mainCameraFrustum.plansNormals[3] =
 		mainCameraFrustum.plansNormals[3] /
-		sqrt(pow(mainCameraFrustum.plansNormals[3].x, 2) +
-			pow(mainCameraFrustum.plansNormals[3].y, 2) +
-			pow(mainCameraFrustum.plansNormals[3].z, 2));
+		glm::length(glm::vec3(mainCameraFrustum.plansNormals[3]));
 
 	// Left plane
 	mainCameraFrustum.plansNormals[4].x = vp[0][3] + vp[0][0];
@@ -583,9 +848,7 @@ void ChaosSceneDrawingProgram::BuildFrustum(Camera& camera)
 	// Normalize left plane
 	mainCameraFrustum.plansNormals[4] =
 		mainCameraFrustum.plansNormals[4] /
-		sqrt(pow(mainCameraFrustum.plansNormals[4].x, 2) +
-			pow(mainCameraFrustum.plansNormals[4].y, 2) +
-			pow(mainCameraFrustum.plansNormals[4].z, 2));
+		glm::length(glm::vec3(mainCameraFrustum.plansNormals[4]));
 
 	// Right plane
 	mainCameraFrustum.plansNormals[5].x = vp[0][3] - vp[0][0];
@@ -596,9 +859,7 @@ void ChaosSceneDrawingProgram::BuildFrustum(Camera& camera)
 	// Normalize right plane
 	mainCameraFrustum.plansNormals[5] =
 		mainCameraFrustum.plansNormals[5] /
-		sqrt(pow(mainCameraFrustum.plansNormals[5].x, 2) +
-			pow(mainCameraFrustum.plansNormals[5].y, 2) +
-			pow(mainCameraFrustum.plansNormals[5].z, 2));
+		glm::length(glm::vec3(mainCameraFrustum.plansNormals[5]));
 }
 
 bool ChaosSceneDrawingProgram::CheckFrustum(glm::vec3 position, float size)
@@ -618,13 +879,30 @@ bool ChaosSceneDrawingProgram::CheckFrustum(glm::vec3 position, float size)
 
 void ChaosSceneDrawingProgram::Destroy()
 {
-	
+	gridPainting.Destroy();
+	glDeleteTextures(4, paintingDisplacements);
+	textureResidency.Destroy();
+	glDeleteTextures(1, &windowTexture);
+	glDeleteBuffers(1, &buildingDrawIndices);
+	glDeleteBuffers(1, &buildingDrawSsbo);
+	glDeleteBuffers(1, &buildingIndirectBuffer);
+	renderQueue.Destroy();
+	labels.Destroy();
 }
 
 void ChaosSceneDrawingProgram::UpdateUi()
 {
 	ImGui::Separator();
 	ImGui::Checkbox("Debug mod", &debugMod);
+	ImGui::Checkbox("Occlusion culling", &occlusionCuller.GetEnable());
+	ImGui::Text("Occlusion culled: %zu / %zu", occlusionCuller.GetCulledNmb(), occlusionCuller.GetOccludeeNmb());
+	ImGui::Checkbox("Depth prepass", &renderQueue.GetDepthPrepass());
+	ImGui::Checkbox("Element labels", &elementLabels);
+	ImGui::Text("Label glyphs: %zu (%zu dropped)", labels.GetGlyphNmb(), labels.GetDroppedGlyphNmb());
+	ImGui::Text("Building textures: %zu %s", textureResidency.GetTextureNmb(),
+		textureResidency.IsBindless() ? "bindless" : "in texture arrays");
+	ImGui::SliderFloat("Painting pixels per vertex", &paintingPixelsPerVertex, 1.0f, 32.0f);
+	ImGui::Text("Painting levels: %d %d %d %d", paintingLods[0], paintingLods[1], paintingLods[2], paintingLods[3]);
 	ImGui::SliderFloat("Camera far", &far, 15.0f, 1000.0f);
 	ImGui::SliderFloat("Camera near", &near, 0.0f, 15.0f);
 	ImGui::SliderFloat("Camera fov", &fov, 0.0f, 120.0f);
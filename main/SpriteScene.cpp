@@ -0,0 +1,146 @@
+#include <random>
+#include <vector>
+
+#include <engine.h>
+#include <graphics.h>
+#include <sprite_batch.h>
+
+#include <Remotery.h>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "imgui.h"
+
+// Many sprites moving over the screen, all packed in one atlas so the whole frame stays about one draw
+class SpriteDrawingProgram : public DrawingProgram
+{
+public:
+	void Init() override;
+	void Draw() override;
+	void Destroy() override;
+	void UpdateUi() override;
+private:
+	struct MovingSprite
+	{
+		Sprite sprite;
+		glm::vec2 velocity;
+		float angularVelocity;
+		int region;
+	};
+	void Spawn(size_t spriteNmb);
+
+	SpriteAtlas atlas;
+	SpriteBatch spriteBatch;
+	std::vector<MovingSprite> sprites;
+	int spriteNmb = 100000;
+	std::mt19937 generator{ 1 };
+};
+
+void SpriteDrawingProgram::Init()
+{
+	programName = "Sprite scene";
+	const char* paths[] = {
+		"data/sprites/grass.png",
+		"data/sprites/blending_transparent_window.png",
+		"data/sprites/container2.png",
+		"data/sprites/wall.png",
+		"data/sprites/water.png",
+		"data/sprites/brickwall.jpg",
+	};
+	for (const char* path : paths)
+		atlas.Add(path);
+	atlas.Build(2048, 4);
+	spriteBatch.Init();
+	Spawn(spriteNmb);
+}
+
+void SpriteDrawingProgram::Spawn(size_t spriteNmb)
+{
+	auto& config = Engine::GetPtr()->GetConfiguration();
+	std::uniform_real_distribution<float> x(0.0f, (float)config.screenWidth);
+	std::uniform_real_distribution<float> y(0.0f, (float)config.screenHeight);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_int_distribution<int> region(0, std::max((int)atlas.GetSpriteNmb() - 1, 0));
+	std::uniform_int_distribution<int> layer(0, 3);
+	sprites.resize(spriteNmb);
+	for (auto& moving : sprites)
+	{
+		moving.region = region(generator);
+		moving.sprite.position = glm::vec2(x(generator), y(generator));
+		moving.sprite.size = glm::vec2(16.0f + 8.0f * unit(generator));
+		moving.sprite.rotation = unit(generator) * glm::pi<float>();
+		moving.sprite.layer = (int16_t)layer(generator);
+		moving.sprite.tint = glm::vec4(0.75f + 0.25f * glm::vec3(unit(generator), unit(generator), unit(generator)), 1.0f);
+		moving.velocity = glm::vec2(unit(generator), unit(generator)) * 100.0f;
+		moving.angularVelocity = unit(generator);
+	}
+}
+
+void SpriteDrawingProgram::Draw()
+{
+	Engine* engine = Engine::GetPtr();
+	auto& config = engine->GetConfiguration();
+	const float dt = engine->GetDeltaTime();
+	const glm::vec2 screenSize((float)config.screenWidth, (float)config.screenHeight);
+	if ((int)sprites.size() != spriteNmb)
+		Spawn(spriteNmb);
+
+	{
+		rmt_ScopedCPUSample(MoveSprites, 0);
+		engine->GetJobSystem().ParallelFor(sprites.size(), 4096, [this, dt, screenSize](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				MovingSprite& moving = sprites[i];
+				moving.sprite.position += moving.velocity * dt;
+				moving.sprite.rotation += moving.angularVelocity * dt;
+				// Bounce on the screen borders
+				for (int axis = 0; axis < 2; axis++)
+				{
+					if ((moving.sprite.position[axis] < 0.0f && moving.velocity[axis] < 0.0f) ||
+						(moving.sprite.position[axis] > screenSize[axis] && moving.velocity[axis] > 0.0f))
+						moving.velocity[axis] = -moving.velocity[axis];
+				}
+			}
+		});
+	}
+
+	spriteBatch.Begin(glm::ortho(0.0f, screenSize.x, 0.0f, screenSize.y));
+	{
+		rmt_ScopedCPUSample(AddSprites, 0);
+		for (const auto& moving : sprites)
+			spriteBatch.Add(atlas.GetRegion(moving.region), moving.sprite);
+	}
+	spriteBatch.End();
+	engine->SetFrameCounter("Sprites", spriteBatch.GetSpriteNmb());
+	engine->SetFrameCounter("Sprite draws", spriteBatch.GetDrawCallNmb());
+}
+
+void SpriteDrawingProgram::Destroy()
+{
+	spriteBatch.Destroy();
+	atlas.Destroy();
+}
+
+void SpriteDrawingProgram::UpdateUi()
+{
+	ImGui::Separator();
+	ImGui::SliderInt("Sprites", &spriteNmb, 0, 500000);
+	ImGui::Text("Sprite draws: %zu", spriteBatch.GetDrawCallNmb());
+	ImGui::Text("Atlas: %zu sprites on %d pages", atlas.GetSpriteNmb(), atlas.GetPageNmb());
+}
+
+int main(int argc, char** argv)
+{
+	Engine engine;
+	auto& config = engine.GetConfiguration();
+	config.screenWidth = 1280;
+	config.screenHeight = 720;
+	config.windowName = "Sprite scene";
+	engine.AddDrawingProgram(new SpriteDrawingProgram());
+
+	engine.Init();
+	engine.GameLoop();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,17 @@
+#include <engine.h>
+#include <terrain.h>
+
+int main(int argc, char** argv)
+{
+	Engine engine;
+	auto& config = engine.GetConfiguration();
+	config.screenWidth = 1280;
+	config.screenHeight = 720;
+	config.windowName = "Terrain scene";
+	engine.AddDrawingProgram(new TerrainDrawingProgram());
+
+	engine.Init();
+	engine.GameLoop();
+
+	return EXIT_SUCCESS;
+}
@@ -1,12 +1,11 @@
 
+
 layout(location = 0) out vec4 FragColor;
 
 in vec2 TexCoord;
-
-uniform sampler2D activeTexture;
+flat in uint TextureIndex;
 
 void main()
 {
-	FragColor = texture(activeTexture, TexCoord);
+	FragColor = sample_resident_texture(TextureIndex, TexCoord);
 }
-
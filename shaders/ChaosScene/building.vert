@@ -1,16 +1,31 @@
 
+
 layout (location = 0) in vec3 aPos;
 layout (location = 2) in vec2 aTexCoords;
+// Index of the draw in the multi draw, fed by the base instance of each command
+layout (location = 5) in uint aDrawIndex;
+
+struct BuildingDraw
+{
+	mat4 model;
+	uvec4 texture;
+};
+
+layout(std430, binding = 7) readonly buffer BuildingDraws
+{
+	BuildingDraw buildingDraws[];
+};
 
 out vec2 TexCoord;
+flat out uint TextureIndex;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 { 
-	vec4 position = projection * view * model * vec4(aPos.x, aPos.y, aPos.z, 1.0);
-	gl_Position = position;
+	BuildingDraw draw = buildingDraws[aDrawIndex];
+	gl_Position = projection * view * draw.model * vec4(aPos.x, aPos.y, aPos.z, 1.0);
 	TexCoord = aTexCoords;
-}  
\ No newline at end of file
+	TextureIndex = draw.texture.x;
+}
@@ -0,0 +1,22 @@
+layout (location = 0) in vec3 aPos;
+// Index of the draw in the multi draw, fed by the base instance of each command
+layout (location = 5) in uint aDrawIndex;
+
+struct BuildingDraw
+{
+	mat4 model;
+	uvec4 texture;
+};
+
+layout(std430, binding = 7) readonly buffer BuildingDraws
+{
+	BuildingDraw buildingDraws[];
+};
+
+// Depth prepass of the building multi draw, the matrices come from the same buffer as building.vert
+uniform mat4 lightSpaceMatrix;
+
+void main()
+{
+	gl_Position = lightSpaceMatrix * buildingDraws[aDrawIndex].model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,41 @@
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// xyz normal, w height of each vertex of the finest painting grid
+layout(rgba16f, binding = 0) uniform writeonly image2D displacement;
+
+uniform int gridResolution;
+uniform float timeSinceStart;
+
+// Height of the painting at a grid vertex and its derivatives along the two grid axes, defined by each painting
+float painting_height(vec2 aPos, out vec2 gradient);
+
+// Derivative of clamp(x, minValue, maxValue) relative to x
+float clamp_derivative(float x, float minValue, float maxValue)
+{
+	return x > minValue && x < maxValue ? 1.0 : 0.0;
+}
+
+// Angle of the circles of painting 2 and 3, atan of the distance to the center over the distance to the origin
+float painting_circle_angle(vec2 aPos, vec2 center, out float distanceToCenter, out vec2 distanceGradient, out vec2 angleGradient)
+{
+	distanceToCenter = distance(center, aPos);
+	float distanceToOrigin = length(aPos);
+	float ratio = distanceToCenter / distanceToOrigin;
+	// The slope is not defined on the center and on the origin themselves
+	distanceGradient = (aPos - center) / max(distanceToCenter, 1e-4);
+	vec2 ratioGradient = (distanceGradient - ratio * aPos / max(distanceToOrigin, 1e-4)) / max(distanceToOrigin, 1e-4);
+	angleGradient = ratioGradient / (1.0 + ratio * ratio);
+	return atan(ratio);
+}
+
+void main()
+{
+	ivec2 vertex = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(vertex, ivec2(gridResolution))))
+		return;
+	vec2 gradient;
+	float y = painting_height(vec2(vertex), gradient);
+	// normal of the displaced surface from the exact slope of the height function
+	vec3 normal = normalize(vec3(-gradient.x, 1.0, -gradient.y));
+	imageStore(displacement, vertex, vec4(normal, y));
+}
@@ -3,11 +3,18 @@ layout(location = 0) out vec4 FragColor;
 
 in vec4 FragPos;
 in vec3 vertexPos;
+in vec3 Normal;
 
 uniform vec3 vertexColor;
+uniform vec3 paintingLightDirection = vec3(-0.3, -1.0, -0.5);
 
 void main()
 {
-	FragColor = vec4((vertexColor.xyz * sin(clamp(vertexPos.y, 0.1, 1.0))), 1);
+	vec3 normal = normalize(Normal);
+	// the paintings are seen from both sides
+	if (!gl_FrontFacing)
+		normal = -normal;
+	float diffuse = max(dot(normal, normalize(-paintingLightDirection)), 0.0);
+	vec3 color = vertexColor.xyz * sin(clamp(vertexPos.y, 0.1, 1.0));
+	FragColor = vec4(color * (ambientIntensity + diffuse), 1);
 }
-
@@ -0,0 +1,22 @@
+out vec4 FragPos;
+out vec3 vertexPos;
+out vec3 Normal;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+// normal and height written by the painting compute pass
+uniform sampler2D displacement;
+
+void main()
+{
+	vec3 aPos = procedural_grid_position();
+	vec2 displacementSize = vec2(textureSize(displacement, 0));
+	vec4 texel = textureLod(displacement, (aPos.xz + 0.5) / displacementSize, 0.0);
+
+	vertexPos = vec3(aPos.x, texel.w, aPos.z);
+	// the painting scale is uniform, the model rotation is enough for the normal
+	Normal = mat3(model) * texel.xyz;
+	FragPos = projection * view * model * vec4(vertexPos, 1.0);
+	gl_Position = FragPos;
+}
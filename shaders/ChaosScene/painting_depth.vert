@@ -0,0 +1,13 @@
+uniform mat4 lightSpaceMatrix;
+uniform mat4 model;
+// height written by the painting compute pass, see painting.vert
+uniform sampler2D displacement;
+
+// Depth prepass of the paintings, displaced like the color pass
+void main()
+{
+	vec3 aPos = procedural_grid_position();
+	vec2 displacementSize = vec2(textureSize(displacement, 0));
+	float height = textureLod(displacement, (aPos.xz + 0.5) / displacementSize, 0.0).w;
+	gl_Position = lightSpaceMatrix * model * vec4(aPos.x, height, aPos.z, 1.0);
+}
@@ -0,0 +1,63 @@
+#version 430 core
+
+struct EngineBoundingBox
+{
+	vec4 min;
+	vec4 max;
+};
+
+vec3 box_corner(EngineBoundingBox box, int i)
+{
+	return vec3(
+		(i & 1) != 0 ? box.max.x : box.min.x,
+		(i & 2) != 0 ? box.max.y : box.min.y,
+		(i & 4) != 0 ? box.max.z : box.min.z);
+}
+
+const float enginePi = 3.14159265359;
+
+// Direction through the center of a cube map texel, uv in [0, 1] with v going down the face
+vec3 cube_direction(int face, vec2 uv)
+{
+	vec2 st = uv * 2.0 - 1.0;
+	vec3 direction;
+	if (face == 0) direction = vec3(1.0, -st.y, -st.x);
+	else if (face == 1) direction = vec3(-1.0, -st.y, st.x);
+	else if (face == 2) direction = vec3(st.x, 1.0, st.y);
+	else if (face == 3) direction = vec3(st.x, -1.0, -st.y);
+	else if (face == 4) direction = vec3(st.x, -st.y, 1.0);
+	else direction = vec3(-st.x, -st.y, -1.0);
+	return normalize(direction);
+}
+
+vec2 hammersley(uint i, uint sampleNmb)
+{
+	uint bits = i;
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return vec2(float(i) / float(sampleNmb), float(bits) * 2.3283064365386963e-10);
+}
+
+// Half vector around the normal distributed as GGX
+vec3 importance_sample_ggx(vec2 xi, vec3 normal, float roughness)
+{
+	float a = roughness * roughness;
+	float phi = 2.0 * enginePi * xi.x;
+	float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (a * a - 1.0) * xi.y));
+	float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+	vec3 halfVector = vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+	vec3 up = abs(normal.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+	vec3 tangent = normalize(cross(up, normal));
+	vec3 bitangent = cross(normal, tangent);
+	return normalize(tangent * halfVector.x + bitangent * halfVector.y + normal * halfVector.z);
+}
+
+float distribution_ggx(float NdotH, float roughness)
+{
+	float a2 = roughness * roughness * roughness * roughness;
+	float denominator = NdotH * NdotH * (a2 - 1.0) + 1.0;
+	return a2 / (enginePi * denominator * denominator);
+}
@@ -1,4 +1,6 @@
-#version 330 core
+#version 430 core
+#extension GL_ARB_bindless_texture : enable
+#extension GL_NV_gpu_shader5 : enable
 struct EngineMaterial 
 {
 	sampler2D texture_diffuse1;
@@ -110,19 +112,294 @@ float linearize(float depth, float zNear, float zFar) {
 	return (2.0 * zNear) / (zFar + zNear - depth * (zFar - zNear));
 }
 
-const int MAX_POINT_LIGHT = 128;
-const int MAX_SPOT_LIGHT = 5;
-
-uniform EnginePointLight pointLights[MAX_POINT_LIGHT];
-uniform EngineSpotLight spotLights[MAX_SPOT_LIGHT];
 uniform EngineDirectionLight directionLight;
-uniform int pointLightsNmb = 0;
-uniform int spotLightsNmb = 0;
 uniform bool directionalLightEnable = false;
 uniform float ambientIntensity = 0.2;
 
+// Clustered point and spot lights, filled by LightCluster
+const int CLUSTER_X = 16;
+const int CLUSTER_Y = 9;
+const int CLUSTER_Z = 24;
 
+layout(std430, binding = 3) readonly buffer EngineClusterLights
+{
+	// position and distance, color and intensity
+	vec4 clusterLights[];
+};
+layout(std430, binding = 8) readonly buffer EngineClusterSpotLights
+{
+	// position and cos cutOff, direction and cos outerCutOff, color and intensity
+	vec4 clusterSpotLights[];
+};
+layout(std430, binding = 4) readonly buffer EngineClusterGrid
+{
+	// offset, point light count and spot light count in the index list, the spot lights follow the point lights
+	uvec4 clusterGrid[];
+};
+layout(std430, binding = 5) readonly buffer EngineClusterIndices
+{
+	uint clusterLightIndices[];
+};
+uniform vec2 clusterScreenSize;
+uniform float clusterNear = 0.1;
+uniform float clusterFar = 100.0;
 
+int get_cluster_index(vec4 fragCoord)
+{
+	float ndcDepth = fragCoord.z * 2.0 - 1.0;
+	float viewDepth = 2.0 * clusterNear * clusterFar / (clusterFar + clusterNear - ndcDepth * (clusterFar - clusterNear));
+	int slice = int(log(viewDepth / clusterNear) / log(clusterFar / clusterNear) * CLUSTER_Z);
+	ivec2 tile = ivec2(fragCoord.xy / clusterScreenSize * vec2(CLUSTER_X, CLUSTER_Y));
+	tile = clamp(tile, ivec2(0), ivec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+	slice = clamp(slice, 0, CLUSTER_Z - 1);
+	return (slice * CLUSTER_Y + tile.y) * CLUSTER_X + tile.x;
+}
 
+EngineSpotLight get_cluster_spot_light(uint lightIndex)
+{
+	EngineSpotLight light;
+	light.position = clusterSpotLights[3 * lightIndex].xyz;
+	light.cutOff = clusterSpotLights[3 * lightIndex].w;
+	light.direction = clusterSpotLights[3 * lightIndex + 1].xyz;
+	light.outerCutOff = clusterSpotLights[3 * lightIndex + 1].w;
+	light.color = clusterSpotLights[3 * lightIndex + 2].xyz;
+	light.intensity = clusterSpotLights[3 * lightIndex + 2].w;
+	return light;
+}
 
+vec3 calculate_clustered_spot_lights(VS_OUT fs_in, EngineMaterial material, vec3 normal)
+{
+	uvec4 cluster = clusterGrid[get_cluster_index(gl_FragCoord)];
+	vec3 lightColor = vec3(0.0);
+	for(uint i = cluster.x + cluster.y; i < cluster.x + cluster.y + cluster.z; i++)
+	{
+		lightColor += calculate_spot_light(get_cluster_spot_light(clusterLightIndices[i]), fs_in, material, normal);
+	}
+	return lightColor;
+}
 
+vec3 calculate_clustered_point_lights(VS_OUT fs_in, EngineMaterial material, vec3 normal)
+{
+	uvec4 cluster = clusterGrid[get_cluster_index(gl_FragCoord)];
+	vec3 lightColor = vec3(0.0);
+	for(uint i = cluster.x; i < cluster.x + cluster.y; i++)
+	{
+		uint lightIndex = clusterLightIndices[i];
+		EnginePointLight light;
+		light.position = clusterLights[2 * lightIndex].xyz;
+		light.distance = clusterLights[2 * lightIndex].w;
+		light.color = clusterLights[2 * lightIndex + 1].xyz;
+		light.intensity = clusterLights[2 * lightIndex + 1].w;
+		lightColor += calculate_point_light(light, fs_in, material, normal);
+	}
+	return lightColor;
+}
+
+// Cascaded shadow map of the direction light, filled by ShadowSystem
+const int MAX_CASCADE = 4;
+
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 cascadeMatrices[MAX_CASCADE];
+// view depth where each cascade ends
+uniform float cascadeSplits[MAX_CASCADE];
+uniform int cascadeNmb = 0;
+uniform mat4 shadowCameraView;
+uniform float shadowBias = 0.002;
+
+float calculate_shadow(vec3 fragPos, vec3 normal, vec3 lightDirection)
+{
+	if(cascadeNmb == 0)
+		return 0.0;
+	float viewDepth = -(shadowCameraView * vec4(fragPos, 1.0)).z;
+	if(viewDepth > cascadeSplits[cascadeNmb - 1])
+		return 0.0;
+	int cascade = 0;
+	while(cascade < cascadeNmb - 1 && viewDepth > cascadeSplits[cascade])
+		cascade++;
+	vec4 lightSpace = cascadeMatrices[cascade] * vec4(fragPos, 1.0);
+	vec3 coords = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+	float bias = max(shadowBias * (1.0 - dot(normal, normalize(-lightDirection))), shadowBias * 0.1);
+	// 3x3 PCF on top of the hardware comparison
+	vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+	float shadow = 0.0;
+	for(int x = -1; x <= 1; x++)
+	{
+		for(int y = -1; y <= 1; y++)
+		{
+			shadow += 1.0 - texture(shadowMap, vec4(coords.xy + vec2(x, y) * texelSize, cascade, coords.z - bias));
+		}
+	}
+	return shadow / 9.0;
+}
+
+// Image based lighting, filled by ImageBasedLighting
+uniform bool iblEnable = false;
+// irradiance spherical harmonics, already convolved with the cosine lobe and divided by pi
+uniform vec3 iblIrradiance[9];
+uniform samplerCube iblSpecular;
+uniform sampler2D iblBrdfLut;
+uniform float iblSpecularLevelNmb = 1.0;
+
+vec3 calculate_ibl_diffuse(vec3 normal)
+{
+	vec3 n = normalize(normal);
+	return max(
+		iblIrradiance[0] * 0.282095 +
+		iblIrradiance[1] * 0.488603 * n.y +
+		iblIrradiance[2] * 0.488603 * n.z +
+		iblIrradiance[3] * 0.488603 * n.x +
+		iblIrradiance[4] * 1.092548 * n.x * n.y +
+		iblIrradiance[5] * 1.092548 * n.y * n.z +
+		iblIrradiance[6] * 0.315392 * (3.0 * n.z * n.z - 1.0) +
+		iblIrradiance[7] * 1.092548 * n.x * n.z +
+		iblIrradiance[8] * 0.546274 * (n.x * n.x - n.y * n.y), vec3(0.0));
+}
+
+// Split sum: prefiltered radiance of the reflection times the scale and bias of F0
+vec3 calculate_ibl_specular(vec3 normal, vec3 viewDir, vec3 f0, float roughness)
+{
+	float NdotV = max(dot(normal, viewDir), 0.0);
+	vec3 reflectDir = reflect(-viewDir, normal);
+	vec3 radiance = textureLod(iblSpecular, reflectDir, roughness * (iblSpecularLevelNmb - 1.0)).rgb;
+	vec2 brdf = texture(iblBrdfLut, vec2(NdotV, roughness)).rg;
+	return radiance * (f0 * brdf.x + brdf.y);
+}
+
+// Blinn-Phong exponent to the matching GGX roughness
+float shininess_to_roughness(float shininess)
+{
+	return sqrt(2.0 / (shininess + 2.0));
+}
+
+// Metallic-roughness materials, filled by BindMaterialComponent
+// ormMap packs occlusion, roughness and metallic in red, green and blue like glTF
+struct EnginePbrMaterial
+{
+	sampler2D baseColorMap;
+	sampler2D normalMap;
+	sampler2D ormMap;
+	vec4 baseColorFactor;
+	float metallicFactor;
+	float roughnessFactor;
+	float normalScale;
+	bool hasBaseColorMap;
+	bool hasNormalMap;
+	bool hasOrmMap;
+};
+
+struct EnginePbrSurface
+{
+	vec3 position;
+	vec3 normal;
+	vec3 viewDir;
+	vec3 albedo;
+	vec3 f0;
+	float metallic;
+	float roughness;
+	float occlusion;
+};
+
+// Cook-Torrance with the GGX distribution, Smith-Schlick visibility and Schlick fresnel
+vec3 calculate_pbr_light(EnginePbrSurface surface, vec3 lightDir, vec3 radiance)
+{
+	vec3 halfwayDir = normalize(lightDir + surface.viewDir);
+	float NdotL = max(dot(surface.normal, lightDir), 0.0);
+	float NdotV = max(dot(surface.normal, surface.viewDir), 1e-4);
+	float NdotH = max(dot(surface.normal, halfwayDir), 0.0);
+	float alpha = surface.roughness * surface.roughness;
+	float alpha2 = alpha * alpha;
+	float denominator = NdotH * NdotH * (alpha2 - 1.0) + 1.0;
+	float distribution = alpha2 / (3.14159265359 * denominator * denominator);
+	float k = (surface.roughness + 1.0) * (surface.roughness + 1.0) / 8.0;
+	float visibility = 1.0 / ((NdotV * (1.0 - k) + k) * (NdotL * (1.0 - k) + k) * 4.0);
+	vec3 fresnel = surface.f0 + (1.0 - surface.f0) * pow(1.0 - max(dot(halfwayDir, surface.viewDir), 0.0), 5.0);
+	vec3 diffuse = (1.0 - fresnel) * (1.0 - surface.metallic) * surface.albedo / 3.14159265359;
+	return (diffuse + fresnel * distribution * visibility) * radiance * NdotL;
+}
+
+vec3 calculate_pbr_lights(EnginePbrSurface surface)
+{
+	vec3 lightColor = vec3(0.0);
+	if(directionalLightEnable)
+	{
+		vec3 lightDir = normalize(-directionLight.direction);
+		lightColor += (1.0 - calculate_shadow(surface.position, surface.normal, directionLight.direction)) *
+			calculate_pbr_light(surface, lightDir, directionLight.color * directionLight.intensity);
+	}
+	uvec4 cluster = clusterGrid[get_cluster_index(gl_FragCoord)];
+	for(uint i = cluster.x; i < cluster.x + cluster.y; i++)
+	{
+		uint lightIndex = clusterLightIndices[i];
+		vec3 lightPosition = clusterLights[2 * lightIndex].xyz;
+		float lightDistance = clusterLights[2 * lightIndex].w;
+		float distance = length(lightPosition - surface.position);
+		if(distance > lightDistance)
+			continue;
+		float attenuation = min(lightDistance / (pointConstant + pointLinear * distance +
+			pointQuadratic * (distance * distance)), 1.0);
+		vec3 radiance = clusterLights[2 * lightIndex + 1].xyz * clusterLights[2 * lightIndex + 1].w * attenuation;
+		lightColor += calculate_pbr_light(surface, normalize(lightPosition - surface.position), radiance);
+	}
+	for(uint i = cluster.x + cluster.y; i < cluster.x + cluster.y + cluster.z; i++)
+	{
+		EngineSpotLight light = get_cluster_spot_light(clusterLightIndices[i]);
+		vec3 lightDir = normalize(light.position - surface.position);
+		float theta = dot(lightDir, normalize(-light.direction));
+		float cone = clamp((theta - light.outerCutOff) / (light.cutOff - light.outerCutOff), 0.0, 1.0);
+		lightColor += calculate_pbr_light(surface, lightDir, light.color * light.intensity * cone);
+	}
+	return lightColor;
+}
+
+vec3 calculate_pbr_ambient(EnginePbrSurface surface)
+{
+	if(!iblEnable)
+		return ambientIntensity * surface.albedo * surface.occlusion;
+	vec3 diffuse = (1.0 - surface.metallic) * surface.albedo * calculate_ibl_diffuse(surface.normal);
+	vec3 specular = calculate_ibl_specular(surface.normal, surface.viewDir, surface.f0, surface.roughness);
+	return ambientIntensity * (diffuse + specular) * surface.occlusion;
+}
+
+//Textures registered in a TextureResidency, one handle or page and layer per index
+layout(std430, binding = 6) readonly buffer EngineTextureResidency
+{
+	uvec2 residencyTextures[];
+};
+uniform bool residencyBindless;
+uniform sampler2DArray residencyPages[8];
+
+//The index may change inside a multi draw, it is not dynamically uniform. A handle built from it is only
+//valid with NV_gpu_shader5, the pages are selected with constant indices and explicit gradients instead.
+vec4 sample_resident_texture(uint index, vec2 uv)
+{
+	uvec2 entry = residencyTextures[index];
+#if defined(GL_ARB_bindless_texture) && defined(GL_NV_gpu_shader5)
+	if (residencyBindless)
+		return texture(sampler2D(entry), uv);
+#endif
+	//Taken before the switch, the derivatives are undefined in non uniform control flow
+	vec2 gradX = dFdx(uv);
+	vec2 gradY = dFdy(uv);
+	vec3 coords = vec3(uv, float(entry.y));
+	switch(entry.x)
+	{
+	case 0u: return textureGrad(residencyPages[0], coords, gradX, gradY);
+	case 1u: return textureGrad(residencyPages[1], coords, gradX, gradY);
+	case 2u: return textureGrad(residencyPages[2], coords, gradX, gradY);
+	case 3u: return textureGrad(residencyPages[3], coords, gradX, gradY);
+	case 4u: return textureGrad(residencyPages[4], coords, gradX, gradY);
+	case 5u: return textureGrad(residencyPages[5], coords, gradX, gradY);
+	case 6u: return textureGrad(residencyPages[6], coords, gradX, gradY);
+	default: return textureGrad(residencyPages[7], coords, gradX, gradY);
+	}
+}
+
+//Weighted blended order independent transparency, see WeightedBlendedOit.
+//Closer and more opaque fragments weigh more, the revealage output is the fragment alpha.
+vec4 oit_accumulation(vec4 color)
+{
+	//View depth of a perspective projection
+	float viewDepth = 1.0 / gl_FragCoord.w;
+	float weight = color.a * clamp(10.0 / (1e-5 + pow(viewDepth / 5.0, 2.0) + pow(viewDepth / 200.0, 6.0)), 1e-2, 3e3);
+	return vec4(color.rgb * color.a, color.a) * weight;
+}
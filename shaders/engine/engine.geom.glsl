@@ -0,0 +1,3 @@
+#version 430 core
+
+const int MAX_CASCADE = 4;
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 
 struct VS_OUT
 {
@@ -58,4 +58,18 @@ mat4 identity() {
 		vec4(0.0, 0.0, 1.0, 0.0),
 		vec4(0.0, 0.0, 0.0, 1.0)
 	);
-}
\ No newline at end of file
+}
+
+// Grid positions without vertex buffer, see ProceduralGrid
+uniform int gridResolution;
+uniform float gridSpacing;
+
+vec3 procedural_grid_position()
+{
+	int x = gl_VertexID / gridResolution;
+	int z = gl_VertexID - x * gridResolution;
+	return vec3(float(x), 0.0, float(z)) * gridSpacing;
+}
+
+// World space plane of gl_ClipDistance[0], only enabled by the passes that clip (see Water)
+uniform vec4 clipPlane = vec4(0.0);
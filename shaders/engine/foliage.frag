@@ -0,0 +1,15 @@
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in float Shade;
+
+uniform sampler2D foliageTexture;
+
+void main()
+{
+	vec4 color = texture(foliageTexture, TexCoords);
+	// alpha tested, foliage stays in the opaque pass
+	if(color.a < 0.5)
+		discard;
+	FragColor = vec4(color.rgb * Shade, 1.0);
+}
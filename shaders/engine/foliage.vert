@@ -0,0 +1,60 @@
+#include "terrain_heights.glsl"
+
+// world position and size, the height is added to the terrain height when foliageOnTerrain
+layout (location = 5) in vec4 aPositionSize;
+// instances fade out in rank order, see Foliage
+layout (location = 6) in float aRank;
+
+out vec2 TexCoords;
+out float Shade;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform bool foliageOnTerrain = false;
+uniform bool billboard = false;
+uniform vec2 fadeRange;
+uniform float time;
+uniform float windStrength;
+
+const vec2 quadCorners[6] = vec2[](
+	vec2(-0.5, 0.0), vec2(0.5, 0.0), vec2(0.5, 1.0),
+	vec2(-0.5, 0.0), vec2(0.5, 1.0), vec2(-0.5, 1.0));
+
+float hash(vec2 p)
+{
+	return fract(sin(dot(p, vec2(12.9898, 78.233))) * 43758.5453);
+}
+
+void main()
+{
+	vec3 root = aPositionSize.xyz;
+	if(foliageOnTerrain)
+		root.y += sample_height(root.xz);
+	float size = aPositionSize.w;
+
+	// shrink over the last part of the instance range so it does not pop
+	float distance = length(cameraPosition - root);
+	float cutOff = fadeRange.y - (fadeRange.y - fadeRange.x) * aRank;
+	size *= clamp((cutOff - distance) / (0.1 * (fadeRange.y - fadeRange.x) + 1e-3), 0.0, 1.0);
+
+	vec2 corner = quadCorners[gl_VertexID % 6];
+	vec3 right;
+	if(billboard)
+	{
+		// cylindrical billboard, stays upright
+		right = normalize(vec3(view[0][0], 0.0, view[2][0]) + vec3(1e-5, 0.0, 0.0));
+	}
+	else
+	{
+		float angle = hash(root.xz) * 3.14159265 + float(gl_VertexID / 6) * 3.14159265 / 3.0;
+		right = vec3(cos(angle), 0.0, sin(angle));
+	}
+	vec3 position = root + right * corner.x * size + vec3(0.0, corner.y * size, 0.0);
+	// only the top bends in the wind
+	float phase = time * 1.7 + hash(root.zx) * 6.2831853;
+	position.xz += corner.y * windStrength * size * vec2(sin(phase), cos(phase * 0.7));
+
+	TexCoords = vec2(corner.x + 0.5, 1.0 - corner.y);
+	Shade = mix(0.6, 1.0, corner.y);
+	gl_Position = projection * view * vec4(position, 1.0);
+}
@@ -0,0 +1,9 @@
+out vec2 TexCoords;
+
+// Full screen triangle without vertex buffer
+void main()
+{
+	vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+	TexCoords = position;
+	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
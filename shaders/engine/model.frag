@@ -20,30 +20,30 @@ void main()
     vec3 color = texture(material.texture_diffuse1, vs_out.TexCoords).rgb;
     // ambient
     vec3 ambient = ambientIntensity * color;
+	if(iblEnable)
+	{
+		vec3 viewDir = normalize(vs_out.ViewPos - vs_out.FragPos);
+		vec3 specularColor = texture(material.texture_specular1, vs_out.TexCoords).rgb;
+		ambient = ambientIntensity * (color * calculate_ibl_diffuse(normal) +
+			calculate_ibl_specular(normal, viewDir, specularColor, shininess_to_roughness(material.shininess)));
+	}
 	vec3 lightColor = vec3(0.0,0.0,0.0);
 	if(directionalLightEnable)
 	{
-		lightColor += calculate_directional_light(
+		lightColor += (1.0 - calculate_shadow(vs_out.FragPos, normal, directionLight.direction)) *
+		calculate_directional_light(
 		directionLight, 
 		vs_out, 
 		material, 
 		normal);
 	}
-	for(int i = 0; i < pointLightsNmb;i++)
-	{
-		lightColor += calculate_point_light(
-			pointLights[i], 
-			vs_out, 
-			material, 
-			normal);
-	}
-	for(int i = 0; i < spotLightsNmb;i++)
-	{
-		lightColor += calculate_spot_light(
-			spotLights[i], 
-			vs_out, 
-			material, 
-			normal);
-	}
+	lightColor += calculate_clustered_point_lights(
+		vs_out,
+		material,
+		normal);
+	lightColor += calculate_clustered_spot_lights(
+		vs_out,
+		material,
+		normal);
     FragColor = vec4(ambient + lightColor, 1.0);
 }
\ No newline at end of file
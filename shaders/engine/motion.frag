@@ -0,0 +1,10 @@
+layout(location = 0) out vec2 velocity;
+
+in vec4 CurrentPosition;
+in vec4 PreviousPosition;
+
+// Screen space motion since the previous frame in texture coordinates
+void main()
+{
+	velocity = (CurrentPosition.xy / CurrentPosition.w - PreviousPosition.xy / PreviousPosition.w) * 0.5;
+}
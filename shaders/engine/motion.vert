@@ -0,0 +1,19 @@
+layout (location = 0) in vec3 aPos;
+
+out vec4 CurrentPosition;
+out vec4 PreviousPosition;
+
+uniform mat4 model;
+uniform mat4 previousModel;
+uniform mat4 jitteredViewProjection;
+uniform mat4 viewProjection;
+uniform mat4 previousViewProjection;
+
+// Rasterized like the color pass, the motion itself is measured without the jitter
+void main()
+{
+	vec4 position = vec4(aPos, 1.0);
+	CurrentPosition = viewProjection * model * position;
+	PreviousPosition = previousViewProjection * previousModel * position;
+	gl_Position = jitteredViewProjection * model * position;
+}
@@ -0,0 +1,21 @@
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D accumulationTexture;
+uniform sampler2D revealageTexture;
+
+void main()
+{
+	float revealage = texelFetch(revealageTexture, ivec2(gl_FragCoord.xy), 0).r;
+	// Nothing transparent covers this pixel
+	if (revealage >= 1.0)
+		discard;
+	vec4 accumulation = texelFetch(accumulationTexture, ivec2(gl_FragCoord.xy), 0);
+	// Keep the sum finite when many bright surfaces overlap
+	if (isinf(max(max(abs(accumulation.r), abs(accumulation.g)), abs(accumulation.b))))
+		accumulation.rgb = vec3(accumulation.a);
+	vec3 averageColor = accumulation.rgb / max(accumulation.a, 1e-5);
+	// Blended with the revealage as the opaque image weight
+	FragColor = vec4(averageColor, revealage);
+}
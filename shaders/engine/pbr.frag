@@ -0,0 +1,35 @@
+out vec4 FragColor;
+
+in VS_OUT vs_out;
+
+uniform EnginePbrMaterial pbrMaterial;
+
+void main()
+{
+	vec4 baseColor = pbrMaterial.baseColorFactor;
+	if(pbrMaterial.hasBaseColorMap)
+		baseColor *= texture(pbrMaterial.baseColorMap, vs_out.TexCoords);
+	vec3 normal = vs_out.invTBN[2];
+	if(pbrMaterial.hasNormalMap)
+	{
+		vec3 tangentNormal = texture(pbrMaterial.normalMap, vs_out.TexCoords).rgb * 2.0 - 1.0;
+		tangentNormal.xy *= pbrMaterial.normalScale;
+		normal = vs_out.invTBN * tangentNormal;
+	}
+	vec3 orm = vec3(1.0, pbrMaterial.roughnessFactor, pbrMaterial.metallicFactor);
+	if(pbrMaterial.hasOrmMap)
+		orm *= texture(pbrMaterial.ormMap, vs_out.TexCoords).rgb;
+
+	EnginePbrSurface surface;
+	surface.position = vs_out.FragPos;
+	surface.normal = normalize(normal);
+	surface.viewDir = normalize(vs_out.ViewPos - vs_out.FragPos);
+	surface.albedo = baseColor.rgb;
+	surface.occlusion = orm.r;
+	// keep a small lobe so the highlights of mirror like surfaces do not vanish
+	surface.roughness = clamp(orm.g, 0.045, 1.0);
+	surface.metallic = clamp(orm.b, 0.0, 1.0);
+	surface.f0 = mix(vec3(0.04), surface.albedo, surface.metallic);
+
+	FragColor = vec4(calculate_pbr_ambient(surface) + calculate_pbr_lights(surface), baseColor.a);
+}
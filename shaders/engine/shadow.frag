@@ -0,0 +1,3 @@
+void main()
+{
+}
\ No newline at end of file
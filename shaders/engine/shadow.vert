@@ -0,0 +1,9 @@
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+void main()
+{
+	// the cascades projections are applied per layer in the geometry shader
+	gl_Position = model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,14 @@
+out vec4 FragColor;
+
+in vec3 TexCoords;
+in vec4 Tint;
+
+uniform sampler2DArray atlas;
+
+void main()
+{
+	vec4 color = texture(atlas, TexCoords) * Tint;
+	if(color.a <= 0.0)
+		discard;
+	FragColor = color;
+}
@@ -0,0 +1,25 @@
+// center and size in the batch space
+layout (location = 0) in vec4 aPositionSize;
+// region of the atlas page
+layout (location = 1) in vec4 aUvRect;
+// rotation in radians and atlas page
+layout (location = 2) in vec2 aRotationPage;
+layout (location = 3) in vec4 aTint;
+
+out vec3 TexCoords;
+out vec4 Tint;
+
+uniform mat4 viewProjection;
+
+// One quad per instance as a triangle strip
+void main()
+{
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	vec2 local = (corner - 0.5) * aPositionSize.zw;
+	float s = sin(aRotationPage.x);
+	float c = cos(aRotationPage.x);
+	vec2 position = aPositionSize.xy + vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+	TexCoords = vec3(aUvRect.xy + vec2(corner.x, 1.0 - corner.y) * aUvRect.zw, aRotationPage.y);
+	Tint = aTint;
+	gl_Position = viewProjection * vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,102 @@
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// frame in the bottom left corner of the scene target, at the render size
+uniform sampler2D currentColor;
+uniform sampler2D currentDepth;
+// velocity written by the moving objects, under -1.5 where the camera motion has to be rebuilt
+uniform sampler2D velocity;
+uniform sampler2D history;
+uniform vec2 renderUvScale;
+uniform vec2 renderTexelSize;
+uniform vec2 historyUvScale;
+uniform vec2 jitterUv;
+uniform mat4 inverseViewProjection;
+uniform mat4 previousViewProjection;
+uniform bool historyValid;
+uniform float feedback;
+
+vec3 rgb_to_ycocg(vec3 color)
+{
+	return vec3(
+		0.25 * color.r + 0.5 * color.g + 0.25 * color.b,
+		0.5 * color.r - 0.5 * color.b,
+		-0.25 * color.r + 0.5 * color.g - 0.25 * color.b);
+}
+
+vec3 ycocg_to_rgb(vec3 color)
+{
+	return vec3(color.x + color.y - color.z, color.x + color.z, color.x - color.y - color.z);
+}
+
+// Bright samples are weighted down so a single HDR texel does not flicker in the accumulation
+float luma_weight(vec3 color)
+{
+	return 1.0 / (1.0 + color.x);
+}
+
+void main()
+{
+	vec2 uv = TexCoords;
+	// the jitter moved the image, sampling back by the same offset gives a stable current frame
+	vec2 renderUv = (uv + jitterUv) * renderUvScale;
+	renderUv = clamp(renderUv, 0.5 * renderTexelSize, renderUvScale - 0.5 * renderTexelSize);
+
+	// neighbourhood statistics and the closest depth for the velocity, the silhouettes carry the motion
+	vec3 moment1 = vec3(0.0);
+	vec3 moment2 = vec3(0.0);
+	vec3 center = vec3(0.0);
+	float closestDepth = 1.0;
+	vec2 closestUv = renderUv;
+	for(int y = -1; y <= 1; y++)
+	{
+		for(int x = -1; x <= 1; x++)
+		{
+			vec2 sampleUv = clamp(renderUv + vec2(x, y) * renderTexelSize, vec2(0.0), renderUvScale);
+			vec3 color = rgb_to_ycocg(texture(currentColor, sampleUv).rgb);
+			moment1 += color;
+			moment2 += color * color;
+			if(x == 0 && y == 0)
+				center = color;
+			float depth = texture(currentDepth, sampleUv).r;
+			if(depth < closestDepth)
+			{
+				closestDepth = depth;
+				closestUv = sampleUv;
+			}
+		}
+	}
+	vec3 mean = moment1 / 9.0;
+	vec3 sigma = sqrt(max(moment2 / 9.0 - mean * mean, 0.0));
+	vec3 boxMin = mean - 1.25 * sigma;
+	vec3 boxMax = mean + 1.25 * sigma;
+
+	vec2 motion = texture(velocity, closestUv).xy;
+	if(motion.x < -1.5)
+	{
+		vec4 world = inverseViewProjection * vec4(uv * 2.0 - 1.0, closestDepth * 2.0 - 1.0, 1.0);
+		vec4 previous = previousViewProjection * vec4(world.xyz / world.w, 1.0);
+		motion = uv - (previous.xy / previous.w * 0.5 + 0.5);
+	}
+	vec2 previousUv = uv - motion;
+
+	if(!historyValid || any(lessThan(previousUv, vec2(0.0))) || any(greaterThan(previousUv, vec2(1.0))))
+	{
+		FragColor = vec4(ycocg_to_rgb(center), 1.0);
+		return;
+	}
+	vec3 previousColor = rgb_to_ycocg(texture(history, previousUv * historyUvScale).rgb);
+	// clip toward the box center rather than clamp, the hue of the history stays closer to the current one
+	vec3 offset = previousColor - mean;
+	vec3 extent = max(boxMax - mean, 1e-4);
+	vec3 unit = abs(offset / extent);
+	float maxUnit = max(unit.x, max(unit.y, unit.z));
+	if(maxUnit > 1.0)
+		previousColor = mean + offset / maxUnit;
+
+	float currentWeight = feedback * luma_weight(center);
+	float historyWeight = (1.0 - feedback) * luma_weight(previousColor);
+	vec3 color = (center * currentWeight + previousColor * historyWeight) / (currentWeight + historyWeight);
+	FragColor = vec4(ycocg_to_rgb(color), 1.0);
+}
@@ -0,0 +1,40 @@
+#include "terrain_heights.glsl"
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 FragPos;
+
+uniform sampler2D albedo;
+uniform vec3 terrainLightDirection = vec3(-0.5, -1.0, -0.3);
+
+// streamed albedo, the heights and the page table come from terrain_heights.glsl
+uniform sampler2DArray albedoTiles;
+uniform float albedoInnerSize;
+
+vec3 sample_albedo(vec2 worldXZ)
+{
+	if(virtualTerrain)
+	{
+		vec3 tileUv;
+		if(find_tile(worldXZ, albedoInnerSize, tileUv))
+			return texture(albedoTiles, tileUv).rgb;
+		return vec3(0.5);
+	}
+	return texture(albedo, TexCoords).rgb;
+}
+
+void main()
+{
+	// normal from the heightmap central differences
+	float spacing = worldSize / (heightmapSize - 1.0);
+	float left = sample_height(FragPos.xz - vec2(spacing, 0.0));
+	float right = sample_height(FragPos.xz + vec2(spacing, 0.0));
+	float down = sample_height(FragPos.xz - vec2(0.0, spacing));
+	float up = sample_height(FragPos.xz + vec2(0.0, spacing));
+	vec3 normal = normalize(vec3(left - right, 2.0 * spacing, down - up));
+
+	vec3 color = sample_albedo(FragPos.xz);
+	float diffuse = max(dot(normal, normalize(-terrainLightDirection)), 0.0);
+	FragColor = vec4(color * (ambientIntensity + diffuse), 1.0);
+}
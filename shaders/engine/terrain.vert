@@ -0,0 +1,37 @@
+#include "terrain_heights.glsl"
+
+layout (location = 0) in vec3 aPos;
+// node corner in world space, node size, lod level
+layout (location = 5) in vec4 aNode;
+
+out vec2 TexCoords;
+out vec3 FragPos;
+
+const int MAX_TERRAIN_LOD = 12;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float gridDim;
+// distances where each level starts and ends morphing toward the next one
+uniform vec2 morphRanges[MAX_TERRAIN_LOD];
+
+void main()
+{
+	vec2 gridPos = aPos.xz;
+	vec2 worldXZ = aNode.xy + gridPos / gridDim * aNode.z;
+	float height = sample_height(worldXZ);
+
+	vec2 morphRange = morphRanges[int(aNode.w)];
+	float distance = length(cameraPosition - vec3(worldXZ.x, height, worldXZ.y));
+	float morphK = clamp((distance - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+	// odd vertices slide onto their even neighbours, which is the coarser level grid
+	vec2 oddOffset = fract(gridPos * 0.5) * 2.0;
+	gridPos -= oddOffset * morphK;
+
+	worldXZ = aNode.xy + gridPos / gridDim * aNode.z;
+	TexCoords = terrain_uv(worldXZ);
+	height = sample_height(worldXZ);
+	FragPos = vec3(worldXZ.x, height, worldXZ.y);
+	gl_ClipDistance[0] = dot(vec4(FragPos, 1.0), clipPlane);
+	gl_Position = projection * view * vec4(FragPos, 1.0);
+}
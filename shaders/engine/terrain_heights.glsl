@@ -0,0 +1,55 @@
+// Terrain heights, set by Terrain::BindHeights. Included by the terrain and foliage shaders so the vertex
+// and fragment stages read the page table the same way.
+uniform vec3 cameraPosition;
+uniform sampler2D heightmap;
+uniform float worldSize;
+uniform float heightScale;
+uniform float heightmapSize;
+
+// streamed terrain, the page table gives the slot + 1 of each resident tile per level
+uniform bool virtualTerrain = false;
+uniform usampler2D pageTable;
+uniform sampler2DArray heightTiles;
+uniform int pageLevelNmb;
+uniform float tileInnerSize;
+uniform float residencyRadius;
+
+vec2 terrain_uv(vec2 worldXZ)
+{
+	// sample texel centers so the vertices land exactly on the heightmap samples
+	return (worldXZ / worldSize * (heightmapSize - 1.0) + 0.5) / heightmapSize;
+}
+
+// finest resident tile at the position, starting at the level the streamer keeps for this distance
+bool find_tile(vec2 worldXZ, float innerSize, out vec3 tileUv)
+{
+	float finestTileSize = worldSize / float(textureSize(pageTable, 0).x);
+	float distance = length(worldXZ - cameraPosition.xz);
+	int level = max(0, int(floor(log2(max(distance, 1e-3) / (finestTileSize * residencyRadius)))) + 1);
+	for(; level < pageLevelNmb; level++)
+	{
+		ivec2 pageSize = textureSize(pageTable, level);
+		vec2 pagePos = worldXZ / worldSize * vec2(pageSize);
+		ivec2 page = clamp(ivec2(pagePos), ivec2(0), pageSize - 1);
+		uint slot = texelFetch(pageTable, page, level).r;
+		if(slot != 0u)
+		{
+			vec2 local = clamp(pagePos - vec2(page), 0.0, 1.0);
+			tileUv = vec3((local * innerSize + 0.5) / (innerSize + 1.0), float(slot - 1u));
+			return true;
+		}
+	}
+	return false;
+}
+
+float sample_height(vec2 worldXZ)
+{
+	if(virtualTerrain)
+	{
+		vec3 tileUv;
+		if(find_tile(worldXZ, tileInnerSize, tileUv))
+			return textureLod(heightTiles, tileUv, 0.0).r * heightScale;
+		return 0.0;
+	}
+	return textureLod(heightmap, terrain_uv(worldXZ), 0.0).r * heightScale;
+}
@@ -0,0 +1,24 @@
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec4 Color;
+
+uniform sampler2D atlas;
+// baked pixels from the outline to a distance of 0, see TextRenderer
+uniform float distanceRange;
+uniform vec4 outlineColor = vec4(0.0, 0.0, 0.0, 0.8);
+// in baked pixels
+uniform float outlineWidth = 1.5;
+
+// The atlas stores 0.5 on the outline, the edge stays one screen pixel wide at any scale
+void main()
+{
+	float distance = texture(atlas, TexCoords).r - 0.5;
+	float width = max(fwidth(distance), 1e-4) * 0.7;
+	float fill = smoothstep(-width, width, distance);
+	float outline = smoothstep(-width, width, distance + outlineWidth * 128.0 / (255.0 * distanceRange));
+	vec4 color = mix(vec4(outlineColor.rgb, outlineColor.a * outline), Color, fill);
+	if(color.a <= 0.0)
+		discard;
+	FragColor = color;
+}
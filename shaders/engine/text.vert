@@ -0,0 +1,42 @@
+// world position with w = 1, or pixel position from the top left with w = 0
+layout (location = 0) in vec4 aAnchor;
+// pixel offset from the anchor and pixel size of the glyph quad
+layout (location = 1) in vec4 aRect;
+layout (location = 2) in vec4 aUvRect;
+layout (location = 3) in vec4 aColor;
+
+out vec2 TexCoords;
+out vec4 Color;
+
+uniform mat4 viewProjection;
+uniform vec2 screenSize;
+
+const vec2 quadCorners[6] = vec2[](
+	vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+	vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+// One glyph per instance, world labels keep their pixel size at any distance
+void main()
+{
+	vec2 corner = quadCorners[gl_VertexID];
+	vec2 pixelOffset = aRect.xy + corner * aRect.zw;
+	TexCoords = aUvRect.xy + corner * aUvRect.zw;
+	Color = aColor;
+	if(aAnchor.w > 0.5)
+	{
+		vec4 clip = viewProjection * vec4(aAnchor.xyz, 1.0);
+		// behind the camera
+		if(clip.w <= 0.0)
+		{
+			gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+			return;
+		}
+		clip.xy += vec2(pixelOffset.x, -pixelOffset.y) * 2.0 / screenSize * clip.w;
+		gl_Position = vec4(clip.xy / clip.w, 0.0, 1.0);
+	}
+	else
+	{
+		vec2 pixel = aAnchor.xy + pixelOffset;
+		gl_Position = vec4(pixel.x / screenSize.x * 2.0 - 1.0, 1.0 - pixel.y / screenSize.y * 2.0, 0.0, 1.0);
+	}
+}
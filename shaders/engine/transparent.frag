@@ -0,0 +1,17 @@
+layout(location = 0) out vec4 accumulation;
+layout(location = 1) out float revealage;
+
+in VS_OUT vs_out;
+
+uniform EngineMaterial material;
+uniform vec4 tintColor = vec4(1.0);
+
+// Unlit textured surface for the transparent pass, the texture alpha is the coverage
+void main()
+{
+	vec4 color = texture(material.texture_diffuse1, vs_out.TexCoords) * tintColor;
+	if (color.a <= 0.0)
+		discard;
+	accumulation = oit_accumulation(color);
+	revealage = color.a;
+}
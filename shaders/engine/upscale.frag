@@ -0,0 +1,28 @@
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// rendered frame in the bottom left corner of a larger target
+uniform sampler2D source;
+uniform vec2 uvScale;
+uniform vec2 texelSize;
+uniform float sharpness;
+
+// Bilinear upscale followed by a contrast adaptive sharpening: the neighbours are subtracted less where the
+// local contrast is already high, and the result stays inside the neighbourhood range so edges do not ring
+void main()
+{
+	vec2 uv = min(TexCoords * uvScale, uvScale - 0.5 * texelSize);
+	vec3 center = texture(source, uv).rgb;
+	vec3 up = texture(source, uv + vec2(0.0, texelSize.y)).rgb;
+	vec3 down = texture(source, uv - vec2(0.0, texelSize.y)).rgb;
+	vec3 left = texture(source, uv - vec2(texelSize.x, 0.0)).rgb;
+	vec3 right = texture(source, uv + vec2(texelSize.x, 0.0)).rgb;
+
+	vec3 minColor = min(center, min(min(up, down), min(left, right)));
+	vec3 maxColor = max(center, max(max(up, down), max(left, right)));
+	vec3 amplitude = clamp(min(minColor, 1.0 - maxColor) / max(maxColor, 1e-4), 0.0, 1.0);
+	vec3 weight = -sqrt(amplitude) * mix(0.125, 0.2, sharpness) * sharpness;
+	vec3 color = (center + (up + down + left + right) * weight) / (1.0 + 4.0 * weight);
+	FragColor = vec4(clamp(color, minColor, maxColor), 1.0);
+}
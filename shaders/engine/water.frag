@@ -0,0 +1,66 @@
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec4 ClipPos;
+
+uniform sampler2D reflectionTexture;
+uniform sampler2D refractionTexture;
+uniform sampler2D refractionDepth;
+uniform sampler2D dudvMap;
+uniform sampler2D normalMap;
+uniform mat4 reflectionViewProjection;
+// the targets are larger than the frame, only their bottom left corner is used
+uniform vec2 reflectionUvScale;
+uniform vec2 refractionUvScale;
+uniform vec3 cameraPosition;
+uniform float time;
+uniform float near;
+uniform float far;
+uniform float waveTiling = 0.05;
+uniform float waveSpeed = 0.03;
+uniform float waveStrength = 0.02;
+uniform vec3 waterColor = vec3(0.0, 0.25, 0.3);
+// depth where the water is opaque
+uniform float waterOpacityDepth = 8.0;
+uniform vec3 waterLightDirection = vec3(-0.5, -1.0, -0.3);
+
+float view_depth(float depth)
+{
+	float ndcDepth = depth * 2.0 - 1.0;
+	return 2.0 * near * far / (far + near - ndcDepth * (far - near));
+}
+
+void main()
+{
+	vec2 screenUv = (ClipPos.xy / ClipPos.w * 0.5 + 0.5) * refractionUvScale;
+	// the reflection may be a few frames old, its own projection of the surface point is used
+	vec4 reflectionClip = reflectionViewProjection * vec4(FragPos, 1.0);
+	vec2 reflectionUv = reflectionClip.xy / reflectionClip.w * 0.5 + 0.5;
+
+	// water thickness between the surface and the refracted ground
+	float groundDepth = view_depth(texture(refractionDepth, screenUv).r);
+	float thickness = max(groundDepth - view_depth(gl_FragCoord.z), 0.0);
+	float shore = clamp(thickness / 1.0, 0.0, 1.0);
+
+	// two scrolling DuDv reads, the distortion fades on the shore so the edge does not swim
+	vec2 waveUv = FragPos.xz * waveTiling;
+	vec2 distortedUv = texture(dudvMap, vec2(waveUv.x + time * waveSpeed, waveUv.y)).rg * 0.1;
+	distortedUv = waveUv + vec2(distortedUv.x, distortedUv.y + time * waveSpeed);
+	vec2 distortion = (texture(dudvMap, distortedUv).rg * 2.0 - 1.0) * waveStrength * shore;
+
+	vec3 reflection = texture(reflectionTexture, clamp(reflectionUv + distortion, 0.001, 0.999) * reflectionUvScale).rgb;
+	vec3 refraction = texture(refractionTexture, clamp(screenUv + distortion * refractionUvScale, vec2(0.001), refractionUvScale - 0.001)).rgb;
+	refraction = mix(refraction, waterColor, clamp(thickness / waterOpacityDepth, 0.0, 1.0));
+
+	vec3 normalColor = texture(normalMap, distortedUv).rgb;
+	vec3 normal = normalize(vec3(normalColor.r * 2.0 - 1.0, normalColor.b * 3.0, normalColor.g * 2.0 - 1.0));
+	vec3 viewDir = normalize(cameraPosition - FragPos);
+	float fresnel = pow(1.0 - max(dot(viewDir, normal), 0.0), 3.0);
+	vec3 color = mix(refraction, reflection, clamp(0.1 + 0.9 * fresnel, 0.0, 1.0));
+
+	vec3 halfway = normalize(normalize(-waterLightDirection) + viewDir);
+	color += vec3(pow(max(dot(normal, halfway), 0.0), 128.0)) * 0.6 * shore;
+	// the undistorted ground shows on the shore
+	vec3 shoreColor = texture(refractionTexture, screenUv).rgb;
+	FragColor = vec4(mix(shoreColor, color, shore), 1.0);
+}
@@ -0,0 +1,21 @@
+out vec3 FragPos;
+out vec4 ClipPos;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float waterHeight;
+uniform vec2 waterMin;
+uniform vec2 waterMax;
+
+const vec2 quadCorners[6] = vec2[](
+	vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+	vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+// Single quad covering the water area, without vertex buffer
+void main()
+{
+	vec2 worldXZ = mix(waterMin, waterMax, quadCorners[gl_VertexID]);
+	FragPos = vec3(worldXZ.x, waterHeight, worldXZ.y);
+	ClipPos = projection * view * vec4(FragPos, 1.0);
+	gl_Position = ClipPos;
+}
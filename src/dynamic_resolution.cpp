@@ -0,0 +1,204 @@
+#include <dynamic_resolution.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "imgui.h"
+#include <Remotery.h>
+
+namespace
+{
+//The target grows by steps so a window dragged larger does not reallocate every frame
+constexpr int targetGranularity = 128;
+constexpr int scaleCooldownFrames = 30;
+constexpr float scaleStep = 1.0f / 32.0f;
+
+int RoundUp(int size)
+{
+	return (size + targetGranularity - 1) / targetGranularity * targetGranularity;
+}
+}
+
+void DynamicResolution::Init()
+{
+	upscaleShader.CompileSource("shaders/engine/fullscreen.vert", "shaders/engine/upscale.frag");
+	glGenVertexArrays(1, &emptyVao);
+	glGenFramebuffers(1, &fbo);
+	glGenQueries(queryNmb, queries);
+}
+
+void DynamicResolution::Destroy()
+{
+	glDeleteQueries(queryNmb, queries);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteVertexArrays(1, &emptyVao);
+	glDeleteTextures(1, &colorTexture);
+	glDeleteTextures(1, &depthTexture);
+	colorTexture = 0;
+	depthTexture = 0;
+	targetWidth = 0;
+	targetHeight = 0;
+}
+
+void DynamicResolution::ResizeTarget(int width, int height)
+{
+	targetWidth = width;
+	targetHeight = height;
+	glDeleteTextures(1, &colorTexture);
+	glDeleteTextures(1, &depthTexture);
+	glGenTextures(1, &colorTexture);
+	glBindTexture(GL_TEXTURE_2D, colorTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glGenTextures(1, &depthTexture);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "[Error] Dynamic resolution: framebuffer is not complete\n";
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DynamicResolution::UpdateScale()
+{
+	//Oldest query first, a result not yet available is read on a later frame
+	for (int i = 0; i < queryNmb; i++)
+	{
+		const int index = (queryIndex + i) % queryNmb;
+		if (!queryPending[index])
+			continue;
+		GLint available = 0;
+		glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &elapsed);
+		queryPending[index] = false;
+		const float time = elapsed / 1000000.0f;
+		gpuTime = gpuTime <= 0.0f ? time : gpuTime + (time - gpuTime) * 0.1f;
+	}
+
+	if (!enable)
+	{
+		renderScale = maxScale;
+		return;
+	}
+	if (cooldown > 0)
+	{
+		cooldown--;
+		return;
+	}
+	//Only react outside of a band under the target, the cost follows the pixel count so the square of the scale
+	if (gpuTime <= 0.0f || (gpuTime < targetGpuTime && gpuTime > targetGpuTime * 0.85f))
+		return;
+	float scale = renderScale * std::sqrt(targetGpuTime * 0.925f / gpuTime);
+	scale = std::min(scale, renderScale + 0.1f);
+	scale = std::floor(scale / scaleStep) * scaleStep;
+	scale = std::clamp(scale, minScale, maxScale);
+	if (scale != renderScale)
+	{
+		renderScale = scale;
+		cooldown = scaleCooldownFrames;
+	}
+}
+
+void DynamicResolution::Begin(int windowWidth, int windowHeight)
+{
+	rmt_ScopedCPUSample(BeginDynamicResolution, 0);
+	//A minimized window has no size
+	windowWidth = std::max(windowWidth, 1);
+	windowHeight = std::max(windowHeight, 1);
+	if (windowWidth > targetWidth || windowHeight > targetHeight ||
+		RoundUp(windowWidth) < targetWidth || RoundUp(windowHeight) < targetHeight)
+	{
+		ResizeTarget(RoundUp(windowWidth), RoundUp(windowHeight));
+	}
+	UpdateScale();
+	renderWidth = std::clamp((int)std::lround(windowWidth * renderScale), 1, targetWidth);
+	renderHeight = std::clamp((int)std::lround(windowHeight * renderScale), 1, targetHeight);
+	auto& config = Engine::GetPtr()->GetConfiguration();
+	config.renderWidth = renderWidth;
+	config.renderHeight = renderHeight;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, renderWidth, renderHeight);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	//A query still in flight is not reused, this frame is then not timed
+	timedFrame = !queryPending[queryIndex];
+	if (timedFrame)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, queries[queryIndex]);
+		queryPending[queryIndex] = true;
+	}
+}
+
+void DynamicResolution::End()
+{
+	if (!timedFrame)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	queryIndex = (queryIndex + 1) % queryNmb;
+}
+
+void DynamicResolution::Present(int windowWidth, int windowHeight)
+{
+	//Nothing to sharpen at native resolution
+	Upscale(windowWidth, windowHeight, colorTexture, glm::vec2((float)renderWidth / targetWidth, (float)renderHeight / targetHeight),
+		glm::vec2(targetWidth, targetHeight), renderWidth < windowWidth ? sharpness : 0.0f);
+}
+
+void DynamicResolution::Present(int windowWidth, int windowHeight, unsigned texture, const glm::vec2& uvScale, const glm::vec2& textureSize)
+{
+	//The temporal accumulation softens the frame even at native resolution
+	Upscale(windowWidth, windowHeight, texture, uvScale, textureSize, sharpness);
+}
+
+void DynamicResolution::Upscale(int windowWidth, int windowHeight, unsigned texture, const glm::vec2& uvScale,
+	const glm::vec2& textureSize, float frameSharpness)
+{
+	rmt_ScopedCPUSample(PresentDynamicResolution, 0);
+	rmt_ScopedOpenGLSample(PresentDynamicResolution);
+	GLboolean depthTest, blend;
+	glGetBooleanv(GL_DEPTH_TEST, &depthTest);
+	glGetBooleanv(GL_BLEND, &blend);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glViewport(0, 0, windowWidth, windowHeight);
+
+	upscaleShader.Bind();
+	upscaleShader.SetInt("source", 0);
+	upscaleShader.SetVec2("uvScale", uvScale);
+	upscaleShader.SetVec2("texelSize", 1.0f / textureSize);
+	upscaleShader.SetFloat("sharpness", frameSharpness);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindVertexArray(emptyVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+	if (blend)
+		glEnable(GL_BLEND);
+}
+
+void DynamicResolution::UpdateUi()
+{
+	ImGui::Checkbox("Dynamic resolution", &enable);
+	ImGui::SliderFloat("Target GPU time", &targetGpuTime, 4.0f, 33.0f);
+	ImGui::SliderFloat("Upscale sharpness", &sharpness, 0.0f, 1.0f);
+	ImGui::Text("Render scale: %.3f (%dx%d)", renderScale, renderWidth, renderHeight);
+	ImGui::Text("Scene GPU time: %.2f ms", gpuTime);
+}
@@ -8,6 +8,7 @@
 #include <emscripten.h> 
 #endif
 #include <chrono>
+#include <fstream>
 #include "imgui.h"
 #ifdef USE_SDL2
 #include "imgui_impl_sdl.h"
@@ -57,6 +58,7 @@ Engine::~Engine()
 		delete drawingProgram;
 	}
 	drawingPrograms.clear();
+	jobSystem.Destroy();
 }
 
 void Engine::Init()
@@ -129,6 +131,16 @@ void Engine::Init()
 
 	camera = Camera(glm::vec3(0.0f, 0.0f, 0.0f), window);
 #endif
+	//Mounted before any subsystem loads its shaders or textures
+	jobSystem.Init();
+	//Packed assets are read from the archive, the loose files stay available for what is not packed
+	fileSystem.MountDirectory(".");
+	if (std::ifstream(configuration.assetsPak))
+	{
+		fileSystem.MountPak(configuration.assetsPak);
+	}
+	dynamicResolution.Init();
+	temporalAa.Init();
 	
 	for (auto drawingProgram : drawingPrograms)
 	{
@@ -168,7 +180,7 @@ void Engine::Loop()
 				std::cout << "Window Size: " << event.window.data1 << ", " << event.window.data2 << "\n";
 				Vec2f newWindowSize = Vec2f(event.window.data1, event.window.data2);
 				std::cout << "New Window Size: " << newWindowSize << "\n";
-				glViewport(0, 0, newWindowSize.x, newWindowSize.y);
+				//The viewports follow at the next frame, the scene target only grows by steps
 				configuration.screenWidth = event.window.data1;
 				configuration.screenHeight = event.window.data2;
 			}
@@ -199,7 +211,9 @@ void Engine::Loop()
 	}
 	ImGui::Render();
 	SDL_GL_MakeCurrent(window, glContext);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	//The programs draw at the render size in the offscreen target, upscaled to the window afterwards
+	dynamicResolution.Begin(configuration.screenWidth, configuration.screenHeight);
+	temporalAa.BeginFrame(dynamicResolution);
 	if(wireframeMode)
 	{
 		glPolygonMode(GL_FRONT_AND_BACK,  GL_LINE);
@@ -208,11 +222,29 @@ void Engine::Loop()
 	{
 		drawingProgram->Draw();
 	}
+	dynamicResolution.End();
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	//The TAA accumulates at the window size, it replaces the bilinear upscale
+	if (temporalAa.IsActive())
+	{
+		temporalAa.Resolve(dynamicResolution, configuration.screenWidth, configuration.screenHeight);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		dynamicResolution.Present(configuration.screenWidth, configuration.screenHeight,
+			temporalAa.GetOutput(), temporalAa.GetOutputUvScale(), temporalAa.GetOutputSize());
+	}
+	else
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		dynamicResolution.Present(configuration.screenWidth, configuration.screenHeight);
+	}
+	for (auto drawingProgram : drawingPrograms)
+	{
+		drawingProgram->DrawOverlay();
+	}
 	if (enableImGui)
 	{
 		rmt_ScopedOpenGLSample(RenderImGuiGPU);
 		rmt_ScopedCPUSample(RenderImGuiCPU, 0);
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 	}
 	SDL_GL_SwapWindow(window);
@@ -235,6 +267,8 @@ void Engine::GameLoop()
 		Loop();
 	}
 #endif
+	temporalAa.Destroy();
+	dynamicResolution.Destroy();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplSDL2_Shutdown();
 	ImGui::DestroyContext();
@@ -267,6 +301,12 @@ void Engine::UpdateUi()
 		ImGui::Begin("Debug Info");
 		ImGui::Text("OpenGL version: %d.%d", majorVersion, minorVersion);
 		ImGui::Text("FPS: %4.0f", 1.0f / GetDeltaTime());
+		for (auto& frameCounter : frameCounters)
+		{
+			ImGui::Text("%s: %zu", frameCounter.first.c_str(), frameCounter.second);
+		}
+		dynamicResolution.UpdateUi();
+		temporalAa.UpdateUi();
 		ImGui::End();
 #endif
 	}
@@ -385,4 +425,19 @@ InputManager& Engine::GetInputManager()
 Camera& Engine::GetCamera()
 {
 	return camera;
-}
\ No newline at end of file
+}
+
+JobSystem& Engine::GetJobSystem()
+{
+	return jobSystem;
+}
+
+FileSystem& Engine::GetFileSystem()
+{
+	return fileSystem;
+}
+
+void Engine::SetFrameCounter(const std::string& name, size_t value)
+{
+	frameCounters[name] = value;
+}
@@ -1,15 +1,22 @@
 #include <file_utility.h>
+#include <engine.h>
 #include <fstream>
 #include <iostream>
 #include <ostream>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 
 const std::string LoadFile(std::string path)
 {
-	std::ifstream t(path);
-	std::string str((std::istreambuf_iterator<char>(t)),
-		std::istreambuf_iterator<char>());
-	return str;
+	const FileView file = Engine::GetPtr()->GetFileSystem().Read(path);
+	return std::string(file.GetString());
 }
 
 std::string GetFilenameExtension(std::string path)
@@ -41,21 +48,97 @@ std::string GetFilenameFromPath(std::string path)
 	return filename;
 }
 
-const BinaryFile LoadBinaryFile(std::string path)
-{
-    std::ifstream shaderFile;
-    shaderFile.open(path, std::ios::binary | std::ios::ate);
-    if (shaderFile.is_open())
-    {
-        size_t size = shaderFile.tellg();
-        shaderFile.seekg(0, std::ios::beg);
-        char* bin = new char[size];
-        shaderFile.read(bin, size);
-        return {bin, size};
-    }
-    else
-    {
-        std::cerr << "Could not open \"" << path << "\"" << std::endl;
-        return {nullptr,0};
-    }
+FileView LoadBinaryFile(std::string path)
+{
+	return Engine::GetPtr()->GetFileSystem().Read(path);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+#ifdef WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::cerr << "[Error] Could not open \"" << path << "\"\n";
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	HANDLE mapping = fileSize.QuadPart == 0 ? nullptr : CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* view = mapping == nullptr ? nullptr : MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr)
+	{
+		std::cerr << "[Error] Could not map \"" << path << "\"\n";
+		if (mapping != nullptr)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = static_cast<const uint8_t*>(view);
+	size = (size_t)fileSize.QuadPart;
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		std::cerr << "[Error] Could not open \"" << path << "\"\n";
+		return false;
+	}
+	struct stat fileStat;
+	void* view = MAP_FAILED;
+	if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+	{
+		view = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	//The mapping keeps its own reference on the file
+	close(file);
+	if (view == MAP_FAILED)
+	{
+		std::cerr << "[Error] Could not map \"" << path << "\"\n";
+		return false;
+	}
+	data = static_cast<const uint8_t*>(view);
+	size = (size_t)fileStat.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data == nullptr)
+		return;
+#ifdef WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(data), size);
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t length) const
+{
+	if (data == nullptr || offset >= size)
+		return;
+	length = length < size - offset ? length : size - offset;
+#ifdef WIN32
+	WIN32_MEMORY_RANGE_ENTRY range = { const_cast<uint8_t*>(data) + offset, length };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	//madvise wants a page aligned start
+	const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	const size_t alignedOffset = offset / pageSize * pageSize;
+	madvise(const_cast<uint8_t*>(data) + alignedOffset, length + offset - alignedOffset, MADV_WILLNEED);
+#endif
 }
@@ -0,0 +1,277 @@
+#include <foliage.h>
+#include <engine.h>
+#include <terrain.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <PerlinNoise.hpp>
+#include <Remotery.h>
+#include "file_utility.h"
+#include "stb_image.h"
+
+namespace
+{
+const unsigned billboardVertexNmb = 6;
+//Three crossed quads
+const unsigned grassVertexNmb = 18;
+
+struct DensityMask
+{
+	std::vector<uint8_t> pixels;
+	int width = 0;
+	int height = 0;
+};
+
+bool LoadDensityMask(const std::string& path, DensityMask& mask)
+{
+	const FileView file = LoadBinaryFile(path);
+	int channelNmb = 0;
+	uint8_t* data = file.IsValid() ?
+		stbi_load_from_memory(file.GetData(), (int)file.GetSize(), &mask.width, &mask.height, &channelNmb, 1) : nullptr;
+	if (data == nullptr)
+	{
+		std::cerr << "[Error] Foliage: cannot load the density mask " << path << "\n";
+		return false;
+	}
+	mask.pixels.assign(data, data + (size_t)mask.width * mask.height);
+	stbi_image_free(data);
+	return true;
+}
+}
+
+FoliageSurface MakeFoliageSurface(const Terrain& terrain)
+{
+	FoliageSurface surface;
+	surface.max = glm::vec2(terrain.GetWorldSize());
+	surface.heightRange = [&terrain](const glm::vec2& min, const glm::vec2& max)
+	{
+		return terrain.GetHeightRange(min, max);
+	};
+	return surface;
+}
+
+bool Foliage::Init(const std::vector<FoliageLayer>& layerDescriptions, const FoliageSurface& surface, float chunkSize, unsigned seed)
+{
+	rmt_ScopedCPUSample(InitFoliage, 0);
+	const glm::vec2 surfaceSize = surface.max - surface.min;
+	if (surfaceSize.x <= 0.0f || surfaceSize.y <= 0.0f || chunkSize <= 0.0f)
+	{
+		std::cerr << "[Error] Foliage: empty surface\n";
+		return false;
+	}
+	if (!surface.heightRange && !surface.height)
+	{
+		std::cerr << "[Error] Foliage: the surface needs a height or a height range\n";
+		return false;
+	}
+	this->chunkSize = chunkSize;
+	chunkNmbX = (int)std::ceil(surfaceSize.x / chunkSize);
+	chunkNmbZ = (int)std::ceil(surfaceSize.y / chunkSize);
+	terrainHeights = !surface.height;
+	foliageShader.CompileSource(
+		"shaders/engine/foliage.vert",
+		"shaders/engine/foliage.frag");
+
+	instanceNmb = 0;
+	layers.resize(layerDescriptions.size());
+	for (size_t i = 0; i < layers.size(); i++)
+	{
+		Layer& layer = layers[i];
+		layer.description = layerDescriptions[i];
+		ScatterLayer(layer, surface, seed + (unsigned)i);
+		layer.texture = stbCreateTexture(layer.description.texturePath.c_str(), true, true, true);
+	}
+	return true;
+}
+
+void Foliage::ScatterLayer(Layer& layer, const FoliageSurface& surface, unsigned seed)
+{
+	rmt_ScopedCPUSample(ScatterFoliageLayer, 0);
+	const FoliageLayer& description = layer.description;
+	DensityMask mask;
+	const bool masked = !description.maskPath.empty() && LoadDensityMask(description.maskPath, mask);
+	const siv::PerlinNoise noise(seed);
+	const glm::vec2 surfaceSize = surface.max - surface.min;
+	//Jittered grid, one candidate per cell
+	const float spacing = 1.0f / std::sqrt(std::max(description.density, 1e-6f));
+	const int cellNmb = std::max(1, (int)std::ceil(chunkSize / spacing));
+	const float cellSize = chunkSize / cellNmb;
+
+	const size_t chunkNmb = (size_t)chunkNmbX * chunkNmbZ;
+	std::vector<std::vector<Instance>> chunkInstances(chunkNmb);
+	layer.chunks.assign(chunkNmb, Chunk());
+	Engine::GetPtr()->GetJobSystem().ParallelFor(chunkNmb, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t chunkIndex = begin; chunkIndex < end; chunkIndex++)
+		{
+			const glm::vec2 chunkMin = surface.min + glm::vec2(chunkIndex % chunkNmbX, chunkIndex / chunkNmbX) * chunkSize;
+			const glm::vec2 chunkMax = glm::min(chunkMin + chunkSize, surface.max);
+			std::seed_seq seedSequence{ seed, (unsigned)chunkIndex };
+			std::mt19937 random(seedSequence);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			auto& instances = chunkInstances[chunkIndex];
+			for (int cellZ = 0; cellZ < cellNmb; cellZ++)
+			{
+				for (int cellX = 0; cellX < cellNmb; cellX++)
+				{
+					const glm::vec2 position = chunkMin + (glm::vec2(cellX, cellZ) + glm::vec2(unit(random), unit(random))) * cellSize;
+					const float keep = unit(random);
+					const float size = glm::mix(description.sizeRange.x, description.sizeRange.y, unit(random));
+					if (position.x >= chunkMax.x || position.y >= chunkMax.y)
+						continue;
+					float density = (float)noise.octaveNoise0_1(
+						position.x * description.noiseFrequency, position.y * description.noiseFrequency, description.noiseOctaves);
+					density = glm::clamp((density - description.noiseThreshold) / (1.0f - description.noiseThreshold), 0.0f, 1.0f);
+					if (masked)
+					{
+						const glm::vec2 uv = (position - surface.min) / surfaceSize;
+						const int x = std::min((int)(uv.x * mask.width), mask.width - 1);
+						const int y = std::min((int)(uv.y * mask.height), mask.height - 1);
+						density *= mask.pixels[(size_t)y * mask.width + x] / 255.0f;
+					}
+					if (keep >= density)
+						continue;
+					const float height = surface.height ? surface.height(position.x, position.y) : 0.0f;
+					instances.push_back({ glm::vec4(position.x, height, position.y, size), 0.0f });
+				}
+			}
+			//Any prefix of the shuffled instances covers the whole chunk, the far chunks draw a prefix
+			std::shuffle(instances.begin(), instances.end(), random);
+			for (size_t i = 0; i < instances.size(); i++)
+			{
+				instances[i].rank = (i + 0.5f) / instances.size();
+			}
+
+			Chunk& chunk = layer.chunks[chunkIndex];
+			chunk.count = (unsigned)instances.size();
+			glm::vec2 heightRange(0.0f);
+			if (surface.heightRange)
+			{
+				heightRange = surface.heightRange(chunkMin, chunkMax);
+			}
+			else if (!instances.empty())
+			{
+				heightRange = glm::vec2(std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+				for (auto& instance : instances)
+				{
+					heightRange = glm::vec2(std::min(heightRange.x, instance.positionSize.y), std::max(heightRange.y, instance.positionSize.y));
+				}
+			}
+			chunk.box.min = glm::vec3(chunkMin.x, heightRange.x, chunkMin.y);
+			chunk.box.max = glm::vec3(chunkMax.x, heightRange.y + description.sizeRange.y, chunkMax.y);
+		}
+	});
+
+	std::vector<Instance> instances;
+	for (size_t chunkIndex = 0; chunkIndex < chunkNmb; chunkIndex++)
+	{
+		layer.chunks[chunkIndex].first = (unsigned)instances.size();
+		instances.insert(instances.end(), chunkInstances[chunkIndex].begin(), chunkInstances[chunkIndex].end());
+	}
+	instanceNmb += instances.size();
+	layer.commands.resize(chunkNmb);
+
+	glGenVertexArrays(1, &layer.vao);
+	glGenBuffers(1, &layer.instanceVbo);
+	glGenBuffers(1, &layer.indirectBuffer);
+	glBindVertexArray(layer.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, layer.instanceVbo);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), instances.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(5);
+	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, positionSize));
+	glVertexAttribDivisor(5, 1);
+	glEnableVertexAttribArray(6);
+	glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, rank));
+	glVertexAttribDivisor(6, 1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Foliage::Destroy()
+{
+	for (auto& layer : layers)
+	{
+		glDeleteTextures(1, &layer.texture);
+		glDeleteVertexArrays(1, &layer.vao);
+		glDeleteBuffers(1, &layer.instanceVbo);
+		glDeleteBuffers(1, &layer.indirectBuffer);
+	}
+	layers.clear();
+	instanceNmb = 0;
+}
+
+void Foliage::Update(const glm::vec3& cameraPosition, const glm::mat4& viewProjection)
+{
+	rmt_ScopedCPUSample(UpdateFoliage, 0);
+	const Frustum frustum = ExtractFrustum(viewProjection);
+	const size_t chunkNmb = (size_t)chunkNmbX * chunkNmbZ;
+	Engine::GetPtr()->GetJobSystem().ParallelFor(layers.size() * chunkNmb, 256, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			Layer& layer = layers[i / chunkNmb];
+			const Chunk& chunk = layer.chunks[i % chunkNmb];
+			const FoliageLayer& description = layer.description;
+			DrawArraysIndirectCommand& command = layer.commands[i % chunkNmb];
+			command = { description.billboard ? billboardVertexNmb : grassVertexNmb, 0, 0, chunk.first };
+			if (chunk.count == 0 || !IsInFrustum(frustum, chunk.box))
+				continue;
+			//Instances ranked over the fade range of the closest point are gone in the whole chunk
+			const float distance = glm::length(glm::clamp(cameraPosition, chunk.box.min, chunk.box.max) - cameraPosition);
+			const float drawnRatio = glm::clamp((description.fadeEnd - distance) / (description.fadeEnd - description.fadeStart), 0.0f, 1.0f);
+			command.instanceCount = (unsigned)std::ceil(chunk.count * drawnRatio);
+		}
+	});
+
+	visibleChunkNmb = 0;
+	drawnInstanceNmb = 0;
+	for (auto& layer : layers)
+	{
+		layer.commandNmb = 0;
+		for (auto& command : layer.commands)
+		{
+			if (command.instanceCount == 0)
+				continue;
+			drawnInstanceNmb += command.instanceCount;
+			layer.commands[layer.commandNmb++] = command;
+		}
+		visibleChunkNmb += layer.commandNmb;
+	}
+}
+
+void Foliage::Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, const Terrain* terrain)
+{
+	rmt_ScopedOpenGLSample(DrawFoliage);
+	foliageShader.Bind();
+	foliageShader.SetMat4("view", view);
+	foliageShader.SetMat4("projection", projection);
+	foliageShader.SetVec3("cameraPosition", cameraPosition);
+	foliageShader.SetFloat("time", Engine::GetPtr()->GetTimeSinceInit());
+	foliageShader.SetFloat("windStrength", windStrength);
+	foliageShader.SetBool("foliageOnTerrain", terrainHeights && terrain != nullptr);
+	foliageShader.SetInt("foliageTexture", 0);
+	if (terrainHeights && terrain != nullptr)
+	{
+		terrain->BindHeights(foliageShader, 1);
+	}
+	for (auto& layer : layers)
+	{
+		if (layer.commandNmb == 0)
+			continue;
+		const FoliageLayer& description = layer.description;
+		foliageShader.SetBool("billboard", description.billboard);
+		foliageShader.SetVec2("fadeRange", description.fadeStart, description.fadeEnd);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, layer.texture);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, layer.indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, layer.commandNmb * sizeof(DrawArraysIndirectCommand), layer.commands.data(), GL_STREAM_DRAW);
+		glBindVertexArray(layer.vao);
+		glMultiDrawArraysIndirect(GL_TRIANGLES, nullptr, (GLsizei)layer.commandNmb, 0);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -2,7 +2,62 @@
 #include <graphics.h>
 #include <geometry.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <cstring>
 #include <iostream>
+#include <limits>
+
+BoundingBox TransformBoundingBox(const BoundingBox& box, const glm::mat4& transform)
+{
+	BoundingBox result;
+	result.min = glm::vec3(std::numeric_limits<float>::max());
+	result.max = glm::vec3(-std::numeric_limits<float>::max());
+	for (int i = 0; i < 8; i++)
+	{
+		const glm::vec3 corner(
+			i & 1 ? box.max.x : box.min.x,
+			i & 2 ? box.max.y : box.min.y,
+			i & 4 ? box.max.z : box.min.z);
+		const glm::vec3 worldCorner = glm::vec3(transform * glm::vec4(corner, 1.0f));
+		result.min = glm::min(result.min, worldCorner);
+		result.max = glm::max(result.max, worldCorner);
+	}
+	return result;
+}
+
+Frustum ExtractFrustum(const glm::mat4& viewProjection)
+{
+	Frustum frustum;
+	const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	frustum.planes[0] = row3 + row0;
+	frustum.planes[1] = row3 - row0;
+	frustum.planes[2] = row3 + row1;
+	frustum.planes[3] = row3 - row1;
+	frustum.planes[4] = row3 + row2;
+	frustum.planes[5] = row3 - row2;
+	for (auto& plane : frustum.planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+	return frustum;
+}
+
+bool IsInFrustum(const Frustum& frustum, const BoundingBox& box)
+{
+	for (auto& plane : frustum.planes)
+	{
+		//Corner the farthest along the plane normal
+		const glm::vec3 positive(
+			plane.x > 0.0f ? box.max.x : box.min.x,
+			plane.y > 0.0f ? box.max.y : box.min.y,
+			plane.z > 0.0f ? box.max.z : box.min.z);
+		if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+			return false;
+	}
+	return true;
+}
 
 void Plane::Init()
 {
@@ -308,10 +363,52 @@ void Sphere::Draw()
     glBindVertexArray(0);
 }
 
+namespace
+{
+//Two triangles per cell, vertex index is x * size + z, written as 16 bits when the vertices allow it
+size_t AppendGridIndices(int size, std::vector<uint8_t>& buffer, unsigned& indexType)
+{
+	const bool shortIndices = size * size <= 65536;
+	indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	const size_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+	const size_t indexNmb = (size_t)(size - 1) * (size - 1) * 6;
+	const size_t start = buffer.size();
+	buffer.resize(start + indexNmb * indexSize);
+	uint8_t* cursor = buffer.data() + start;
+	auto write = [&cursor, shortIndices](uint32_t index)
+	{
+		if (shortIndices)
+		{
+			const uint16_t shortIndex = (uint16_t)index;
+			memcpy(cursor, &shortIndex, sizeof(shortIndex));
+			cursor += sizeof(shortIndex);
+		}
+		else
+		{
+			memcpy(cursor, &index, sizeof(index));
+			cursor += sizeof(index);
+		}
+	};
+	for (int x = 0; x < size - 1; x++)
+	{
+		for (int z = 0; z < size - 1; z++)
+		{
+			const uint32_t offset = x * size + z;
+			write(offset + 0);
+			write(offset + size);
+			write(offset + 1);
+			write(offset + 1);
+			write(offset + size);
+			write(offset + size + 1);
+		}
+	}
+	return indexNmb;
+}
+}
+
 void Grid::Init(int size)
 {
 	vertices.resize(size * size);
-	indices.resize(size * size * 6);
 
 	for (int x = 0; x < size; x++)
 	{
@@ -321,22 +418,8 @@ void Grid::Init(int size)
 		}
 	}
 
-	int index = 0;
-
-	for (int x = 0; x < size - 1; x++)
-	{
-		for (int z = 0; z < size - 1; z++)
-		{
-			int offset = x * size + z;
-			indices[index] = (short)(offset + 0);
-			indices[index + 1] = (short)(offset + size);
-			indices[index + 2] = (short)(offset + 1);
-			indices[index + 3] = (short)(offset + 1);
-			indices[index + 4] = (short)(offset + size);
-			indices[index + 5] = (short)(offset + size + 1);
-			index += 6;
-		}
-	}
+	std::vector<uint8_t> indices;
+	indexNmb = AppendGridIndices(size, indices, indexType);
 
 	glGenVertexArrays(1, &gridVAO);
 	glGenBuffers(1, &gridVBO);
@@ -347,20 +430,78 @@ void Grid::Init(int size)
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridEBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(short), &indices[0], GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), GL_STATIC_DRAW);
 
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_FALSE, 5 * sizeof(float), (void*)(5 * sizeof(float)));
+	glBindVertexArray(0);
 }
 
 void Grid::Draw()
 {
 	glBindVertexArray(gridVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+	glDrawElements(GL_TRIANGLES, indexNmb, indexType, (void*)0);
+	glBindVertexArray(0);
+}
+
+void Grid::DrawInstanced(int instanceNmb)
+{
+	glBindVertexArray(gridVAO);
+	glDrawElementsInstanced(GL_TRIANGLES, indexNmb, indexType, (void*)0, instanceNmb);
+	glBindVertexArray(0);
+}
+
+void ProceduralGrid::Init(int size, int lodNmb)
+{
+	extent = (float)(size - 1);
+	this->lodNmb = 0;
+	std::vector<uint8_t> indices;
+	for (int lod = 0; lod < lodNmb && lod < maxLodNmb; lod++)
+	{
+		const int resolution = ((size - 1) >> lod) + 1;
+		if (resolution < 2)
+			break;
+		Level& level = levels[lod];
+		level.resolution = resolution;
+		//Offsets must stay aligned on the index size
+		indices.resize((indices.size() + 3) & ~(size_t)3);
+		level.indexOffset = indices.size();
+		level.indexNmb = AppendGridIndices(resolution, indices, level.indexType);
+		this->lodNmb++;
+	}
+
+	//Core profile still needs a vertex array, it only holds the index buffer
+	glGenVertexArrays(1, &gridVAO);
+	glGenBuffers(1, &gridEBO);
+	glBindVertexArray(gridVAO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridEBO);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, (void*)0);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), GL_STATIC_DRAW);
 	glBindVertexArray(0);
 }
+
+void ProceduralGrid::Destroy()
+{
+	glDeleteBuffers(1, &gridEBO);
+	glDeleteVertexArrays(1, &gridVAO);
+}
+
+void ProceduralGrid::Draw(Shader& shader, int lod) const
+{
+	const Level& level = levels[lod];
+	shader.SetInt("gridResolution", level.resolution);
+	shader.SetFloat("gridSpacing", extent / (level.resolution - 1));
+	glBindVertexArray(gridVAO);
+	glDrawElements(GL_TRIANGLES, level.indexNmb, level.indexType, (void*)level.indexOffset);
+	glBindVertexArray(0);
+}
+
+int ProceduralGrid::SelectLod(float screenSize, float pixelsPerVertex) const
+{
+	const float wantedResolution = screenSize / pixelsPerVertex;
+	for (int lod = lodNmb - 1; lod > 0; lod--)
+	{
+		if (levels[lod].resolution >= wantedResolution)
+			return lod;
+	}
+	return 0;
+}
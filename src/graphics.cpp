@@ -72,6 +72,79 @@ void Shader::CompileSource(std::string vertexShaderPath, std::string fragmentSha
 	glDeleteShader(fragmentShader);
 }
 
+void Shader::CompileSource(std::string vertexShaderPath, std::string geometryShaderPath, std::string fragmentShaderPath)
+{
+	const std::string paths[3] = { vertexShaderPath, geometryShaderPath, fragmentShaderPath };
+	const GLenum types[3] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+	const char* typeNames[3] = { "VERTEX", "GEOMETRY", "FRAGMENT" };
+	unsigned int shaders[3];
+	int  success;
+	char infoLog[512];
+	for (int i = 0; i < 3; i++)
+	{
+		shaders[i] = glCreateShader(types[i]);
+		const auto shaderProgramSource = LoadFile(paths[i]);
+		const char* shaderChar = shaderProgramSource.c_str();
+		glShaderSource(shaders[i], 1, &shaderChar, NULL);
+		glCompileShader(shaders[i]);
+		//Check success status of shader compilation 
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shaders[i], 512, NULL, infoLog);
+			std::cerr << "ERROR::SHADER::" << typeNames[i] << "::COMPILATION_FAILED\n" << paths[i] << std::endl << infoLog << std::endl;
+			return;
+		}
+	}
+
+	shaderProgram = glCreateProgram();
+	for (auto shader : shaders)
+		glAttachShader(shaderProgram, shader);
+	glLinkProgram(shaderProgram);
+	//Check if shader program was linked correctly
+	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+	if (!success) {
+		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+		std::cerr << "ERROR::SHADER::PROGRAM::LINK_FAILED\n" << vertexShaderPath << std::endl << geometryShaderPath << std::endl << fragmentShaderPath << std::endl << infoLog << std::endl;
+		return;
+	}
+
+	for (auto shader : shaders)
+		glDeleteShader(shader);
+}
+
+void Shader::CompileCompute(std::string computeShaderPath)
+{
+	const unsigned int computeShader = glCreateShader(GL_COMPUTE_SHADER);
+	const auto computeShaderProgram = LoadFile(computeShaderPath);
+	const char* computeShaderChar = computeShaderProgram.c_str();
+
+	glShaderSource(computeShader, 1, &computeShaderChar, NULL);
+	glCompileShader(computeShader);
+	//Check success status of shader compilation 
+	int  success;
+	char infoLog[512];
+	glGetShaderiv(computeShader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(computeShader, 512, NULL, infoLog);
+		std::cerr << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << computeShaderPath << std::endl << infoLog << std::endl;
+		return;
+	}
+
+	shaderProgram = glCreateProgram();
+	glAttachShader(shaderProgram, computeShader);
+	glLinkProgram(shaderProgram);
+	//Check if shader program was linked correctly
+	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+	if (!success) {
+		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+		std::cerr << "ERROR::SHADER::PROGRAM::LINK_FAILED\n" << computeShaderPath << std::endl << infoLog << std::endl;
+		return;
+	}
+
+	glDeleteShader(computeShader);
+}
 
 void Shader::CompileSpirV(std::string vertexShaderPath, std::string fragmentShaderPath)
 {
@@ -79,13 +152,12 @@ void Shader::CompileSpirV(std::string vertexShaderPath, std::string fragmentShad
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
     const auto vertexShaderProgram = LoadBinaryFile(vertexShaderPath);
     // Apply the vertex shader SPIR-V to the shader object.
-    glShaderBinary(1, &vertexShader, GL_SHADER_BINARY_FORMAT_SPIR_V, vertexShaderProgram.bin, vertexShaderProgram.size);
+    glShaderBinary(1, &vertexShader, GL_SHADER_BINARY_FORMAT_SPIR_V, vertexShaderProgram.GetData(), (GLsizei)vertexShaderProgram.GetSize());
 
     // Specialize the vertex shader.
     //std::string vsEntrypoint = ...; // Get VS entry point name
     glSpecializeShader(vertexShader, "main", 0, nullptr, nullptr);
 
-	delete[] vertexShaderProgram.bin;
     ///Check success status of shader compilation
     int  success;
     char infoLog[512];
@@ -101,15 +173,13 @@ void Shader::CompileSpirV(std::string vertexShaderPath, std::string fragmentShad
     GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
     const auto fragmentShaderProgram = LoadBinaryFile(fragmentShaderPath);
     // Apply the fragment shader SPIR-V to the shader object.
-    glShaderBinary(1, &fragmentShader, GL_SHADER_BINARY_FORMAT_SPIR_V, fragmentShaderProgram.bin, fragmentShaderProgram.size);
+    glShaderBinary(1, &fragmentShader, GL_SHADER_BINARY_FORMAT_SPIR_V, fragmentShaderProgram.GetData(), (GLsizei)fragmentShaderProgram.GetSize());
 
     // Specialize the fragment shader.
     //std::string vsEntrypoint = ...; // Get VS entry point name
     glSpecializeShader(fragmentShader, "main", 0, nullptr, nullptr);
 
     ///Check success status of shader compilation
-
-	delete[] fragmentShaderProgram.bin;
     glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
     if (!success)
     {
@@ -231,7 +301,10 @@ void Shader::SetBindingFunction(std::function<void()> bindingFunction)
 unsigned gliCreateTexture(char const* filename)
 {
 #ifndef USE_EMSCRIPTEN
-	gli::texture Texture = gli::load(filename);
+	const FileView file = LoadBinaryFile(filename);
+	if (!file.IsValid())
+		return 0;
+	gli::texture Texture = gli::load(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
 	if (Texture.empty())
 		return 0;
 
@@ -263,7 +336,7 @@ unsigned gliCreateTexture(char const* filename)
 	case gli::TARGET_CUBE:
 		glTexStorage2D(
 			Target, static_cast<GLint>(Texture.levels()), Format.Internal,
-			Extent.x, Texture.target() == gli::TARGET_2D ? Extent.y : FaceTotal);
+			Extent.x, Texture.target() == gli::TARGET_1D_ARRAY ? FaceTotal : Extent.y);
 		break;
 	case gli::TARGET_2D_ARRAY:
 	case gli::TARGET_3D:
@@ -356,19 +429,25 @@ unsigned stbCreateTexture(const char* filename, bool smooth, bool mipMaps, bool
 	int width, height, nrChannels;
 
 	int reqComponents = 0;
+	//glTF exports name their JPEG files .jpeg
+	if (extension == ".jpeg")
+		extension = ".jpg";
 	if (extension == ".jpg" || extension == ".tga" || extension == ".hdr")
 		reqComponents = 3;
 	else if (extension == ".png")
 		reqComponents = 4;
 
+	const FileView file = LoadBinaryFile(filename);
+	if (!file.IsValid())
+		return 0;
 	void *data = nullptr;
 	if(extension == ".hdr")
 	{
-		data = stbi_loadf(filename, &width, &height, &reqComponents, 0);
+		data = stbi_loadf_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, &reqComponents, 0);
 	}
 	else 
 	{
-		data = stbi_load(filename, &width, &height, &nrChannels, reqComponents);
+		data = stbi_load_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, &nrChannels, reqComponents);
 	}
 	if (data == nullptr)
 	{
@@ -420,12 +499,16 @@ unsigned LoadCubemap(std::vector<std::string>& faces)
 	int width, height, nrChannels;
 	for (unsigned int i = 0; i < faces.size(); i++)
 	{
-		unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		std::string extension = GetFilenameExtension(faces[i]);
+		const FileView file = LoadBinaryFile(faces[i]);
+		const bool hdr = GetFilenameExtension(faces[i]) == ".hdr";
+		//HDR faces keep their float range instead of being clamped to 8 bits
+		void *data = !file.IsValid() ? nullptr : hdr ?
+			(void*)stbi_loadf_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, &nrChannels, 3) :
+			(void*)stbi_load_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, &nrChannels, 3);
 		if (data)
 		{
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-				0, extension == ".hdr"?GL_RGB16F:GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
+				0, hdr ? GL_RGB16F : GL_RGB, width, height, 0, GL_RGB, hdr ? GL_FLOAT : GL_UNSIGNED_BYTE, data
 			);
 			stbi_image_free(data);
 		}
@@ -0,0 +1,294 @@
+#include <hiz.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <iostream>
+#include <Remotery.h>
+
+void HiZCuller::Init()
+{
+	copyShader.CompileCompute("shaders/engine/hiz_copy.comp");
+	downsampleShader.CompileCompute("shaders/engine/hiz_downsample.comp");
+	cullShader.CompileCompute("shaders/engine/hiz_cull.comp");
+
+	glGenFramebuffers(1, &depthFbo);
+	glGenBuffers(1, &boxesSsbo);
+	glGenBuffers(1, &lateBoxBuffer);
+	glGenBuffers(1, &lateCommandBuffer);
+	//Bound by the first pass before any late draw, empty buffers cannot be bound
+	for (unsigned buffer : { lateBoxBuffer, lateCommandBuffer })
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(IndirectCommand), nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void HiZCuller::Destroy()
+{
+	DiscardReadback();
+	ResizeReadback(0);
+	glDeleteFramebuffers(1, &depthFbo);
+	glDeleteTextures(1, &depthTexture);
+	glDeleteTextures(1, &hiZTexture);
+	glDeleteBuffers(1, &boxesSsbo);
+	glDeleteBuffers(1, &lateBoxBuffer);
+	glDeleteBuffers(1, &lateCommandBuffer);
+	depthTexture = 0;
+	hiZTexture = 0;
+	pyramidValid = false;
+}
+
+void HiZCuller::SetBoxes(const std::vector<BoundingBox>& worldBoxes)
+{
+	std::vector<glm::vec4> boxData;
+	boxData.reserve(worldBoxes.size() * 2);
+	for (auto& box : worldBoxes)
+	{
+		boxData.emplace_back(box.min, 1.0f);
+		boxData.emplace_back(box.max, 1.0f);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, boxesSsbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, boxData.size() * sizeof(glm::vec4), boxData.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	//Moved boxes keep their index, only a new count invalidates the results in flight
+	if (worldBoxes.size() == boxNmb)
+		return;
+	DiscardReadback();
+	boxNmb = worldBoxes.size();
+	visibility.assign(boxNmb, 1);
+	culledNmb = 0;
+	lateBoxes.clear();
+	lateCommands.clear();
+	if (boxNmb > boxCapacity)
+		ResizeReadback(boxNmb);
+}
+
+void HiZCuller::ResizeReadback(size_t boxCapacity)
+{
+	for (int i = 0; i < readbackNmb; i++)
+	{
+		if (mappedVisibility[i] != nullptr)
+		{
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibilitySsbos[i]);
+			glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+			mappedVisibility[i] = nullptr;
+		}
+	}
+	glDeleteBuffers(readbackNmb, visibilitySsbos);
+	std::fill(std::begin(visibilitySsbos), std::end(visibilitySsbos), 0u);
+	this->boxCapacity = boxCapacity;
+	if (boxCapacity == 0)
+		return;
+
+	const GLbitfield mapFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr bufferSize = (GLsizeiptr)(boxCapacity * sizeof(unsigned));
+	glGenBuffers(readbackNmb, visibilitySsbos);
+	for (int i = 0; i < readbackNmb; i++)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibilitySsbos[i]);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, bufferSize, nullptr, mapFlags);
+		mappedVisibility[i] = (const unsigned*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, bufferSize, mapFlags);
+		if (mappedVisibility[i] == nullptr)
+		{
+			std::cerr << "[Error] Hi-Z: cannot map the visibility buffer\n";
+		}
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void HiZCuller::DiscardReadback()
+{
+	for (auto& fence : fences)
+	{
+		if (fence != nullptr)
+			glDeleteSync((GLsync)fence);
+		fence = nullptr;
+	}
+	writeIndex = 0;
+	readIndex = 0;
+}
+
+void HiZCuller::ResizeTargets(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	levelNmb = 1 + (int)std::floor(std::log2((float)std::max(width, height)));
+
+	glDeleteTextures(1, &depthTexture);
+	glGenTextures(1, &depthTexture);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, depthFbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+	glDeleteTextures(1, &hiZTexture);
+	glGenTextures(1, &hiZTexture);
+	glBindTexture(GL_TEXTURE_2D, hiZTexture);
+	glTexStorage2D(GL_TEXTURE_2D, levelNmb, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	pyramidValid = false;
+}
+
+void HiZCuller::BuildPyramid(const glm::mat4& viewProjection)
+{
+	rmt_ScopedOpenGLSample(BuildHiZPyramid);
+	if (!enable)
+	{
+		pyramidValid = false;
+		return;
+	}
+	Engine* engine = Engine::GetPtr();
+	auto& config = engine->GetConfiguration();
+	auto& dynamicResolution = engine->GetDynamicResolution();
+	GLint currentFbo = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &currentFbo);
+	//Same allocation as the scene target, the frame only covers its bottom left corner
+	if (dynamicResolution.GetTargetWidth() != width || dynamicResolution.GetTargetHeight() != height)
+	{
+		ResizeTargets(dynamicResolution.GetTargetWidth(), dynamicResolution.GetTargetHeight());
+	}
+	renderWidth = (int)config.renderWidth;
+	renderHeight = (int)config.renderHeight;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, currentFbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFbo);
+	glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, currentFbo);
+
+	copyShader.Bind();
+	copyShader.SetInt("depthTexture", 0);
+	glUniform2i(glGetUniformLocation(copyShader.GetProgram(), "size"), width, height);
+	glUniform2i(glGetUniformLocation(copyShader.GetProgram(), "renderSize"), renderWidth, renderHeight);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glBindImageTexture(0, hiZTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+
+	downsampleShader.Bind();
+	int previousWidth = width;
+	int previousHeight = height;
+	for (int level = 1; level < levelNmb; level++)
+	{
+		const int levelWidth = std::max(1, previousWidth / 2);
+		const int levelHeight = std::max(1, previousHeight / 2);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		glUniform2i(glGetUniformLocation(downsampleShader.GetProgram(), "previousSize"), previousWidth, previousHeight);
+		glUniform2i(glGetUniformLocation(downsampleShader.GetProgram(), "currentSize"), levelWidth, levelHeight);
+		glBindImageTexture(0, hiZTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(1, hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+		previousWidth = levelWidth;
+		previousHeight = levelHeight;
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	pyramidValid = true;
+	pyramidViewProjection = viewProjection;
+}
+
+void HiZCuller::ReadBack()
+{
+	rmt_ScopedCPUSample(HiZReadBack, 0);
+	frameIndex++;
+	if (!enable)
+	{
+		DiscardReadback();
+		std::fill(visibility.begin(), visibility.end(), 1u);
+		culledNmb = 0;
+		latency = 0;
+		return;
+	}
+	//Oldest first, stop at the first result still in flight
+	bool updated = false;
+	while (fences[readIndex] != nullptr)
+	{
+		const GLsync fence = (GLsync)fences[readIndex];
+		const GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(fence);
+		fences[readIndex] = nullptr;
+		if (mappedVisibility[readIndex] != nullptr)
+		{
+			std::copy(mappedVisibility[readIndex], mappedVisibility[readIndex] + boxNmb, visibility.begin());
+			latency = frameIndex - slotFrames[readIndex];
+			updated = true;
+		}
+		readIndex = (readIndex + 1) % readbackNmb;
+	}
+	if (updated)
+		culledNmb = std::count(visibility.begin(), visibility.end(), 0u);
+}
+
+void HiZCuller::CullFirstPass()
+{
+	rmt_ScopedOpenGLSample(HiZFirstPass);
+	lateBoxes.clear();
+	lateCommands.clear();
+	ReadBack();
+	if (!enable || !pyramidValid || boxNmb == 0)
+		return;
+	//Every slot still in flight, skip this frame rather than wait for the GPU
+	if (fences[writeIndex] != nullptr)
+		return;
+	Cull(false, visibilitySsbos[writeIndex], boxNmb);
+	//Makes the writes visible through the persistent mapping once the fence is signaled
+	glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+	fences[writeIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slotFrames[writeIndex] = frameIndex;
+	writeIndex = (writeIndex + 1) % readbackNmb;
+}
+
+size_t HiZCuller::AddLateDraw(size_t index, unsigned elementNmb)
+{
+	IndirectCommand command;
+	command.count = elementNmb;
+	//Drawn as is when there is no pyramid to test it against
+	command.instanceCount = 1;
+	lateBoxes.push_back((unsigned)index);
+	lateCommands.push_back(command);
+	return (lateCommands.size() - 1) * sizeof(IndirectCommand);
+}
+
+void HiZCuller::CullSecondPass()
+{
+	rmt_ScopedOpenGLSample(HiZSecondPass);
+	if (lateCommands.empty())
+		return;
+	//Orphaned each frame, the draws of the previous frame may still read the old storage
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lateBoxBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, lateBoxes.size() * sizeof(unsigned), lateBoxes.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lateCommandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, lateCommands.size() * sizeof(IndirectCommand), lateCommands.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	if (!enable || !pyramidValid)
+		return;
+	//The second pass writes nothing here, any buffer fills the visibility binding
+	Cull(true, visibilitySsbos[0], lateCommands.size());
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+void HiZCuller::Cull(bool secondPass, unsigned visibilityBuffer, size_t invocationNmb)
+{
+	cullShader.Bind();
+	cullShader.SetInt("hiZ", 0);
+	cullShader.SetInt("hiZLevelNmb", levelNmb);
+	cullShader.SetInt("invocationNmb", (int)invocationNmb);
+	cullShader.SetBool("secondPass", secondPass);
+	cullShader.SetMat4("viewProjection", pyramidViewProjection);
+	glUniform2i(glGetUniformLocation(cullShader.GetProgram(), "hiZSize"), width, height);
+	cullShader.SetVec2("uvScale", (float)renderWidth / width, (float)renderHeight / height);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, hiZTexture);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, boxesSsbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibilityBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lateBoxBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, lateCommandBuffer);
+	glDispatchCompute((GLuint)(invocationNmb + 63) / 64, 1, 1);
+}
@@ -0,0 +1,380 @@
+#include <ibl.h>
+#include <engine.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <gli/gli.hpp>
+#include <Remotery.h>
+#include "file_utility.h"
+#include "stb_image.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IBL_SIMD 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+const float pi = 3.14159265359f;
+const int brdfLutSize = 256;
+const int prefilterSampleNmb = 1024;
+const int brdfSampleNmb = 1024;
+//Smallest face of the specular chain, the last level is roughness one
+const int specularMinSize = 8;
+//Cosine lobe convolution divided by pi for each band
+const float bandWeights[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+
+int GetLevelNmb(int size, int minSize)
+{
+	int levelNmb = 1;
+	while ((size >> levelNmb) >= minSize)
+		levelNmb++;
+	return levelNmb;
+}
+
+std::string GetCacheBase(const std::string& path)
+{
+	const size_t extension = path.find_last_of('.');
+	return extension == std::string::npos ? path : path.substr(0, extension);
+}
+
+std::string GetDirectory(const std::string& path)
+{
+	const size_t folder = path.find_last_of('/');
+	return folder == std::string::npos ? "." : path.substr(0, folder);
+}
+
+void SetCubeSampling(unsigned cubemap, int levelNmb)
+{
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levelNmb - 1);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+void SetLutSampling(unsigned lut)
+{
+	glBindTexture(GL_TEXTURE_2D, lut);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool SaveCubemap(unsigned cubemap, int size, int levelNmb, const std::string& path)
+{
+	gli::texture_cube texture(gli::FORMAT_RGBA16_SFLOAT_PACK16, gli::extent2d(size, size), levelNmb);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+	for (int face = 0; face < 6; face++)
+	{
+		for (int level = 0; level < levelNmb; level++)
+		{
+			glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGBA, GL_HALF_FLOAT, texture[face][level].data());
+		}
+	}
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	return gli::save_dds(texture, path);
+}
+}
+
+bool ImageBasedLighting::Init(const std::string& equirectPath, int environmentSize, int specularSize)
+{
+	rmt_ScopedCPUSample(InitImageBasedLighting, 0);
+	const std::string cacheBase = GetCacheBase(equirectPath);
+	environmentCachePath = cacheBase + "_environment.dds";
+	specularCachePath = cacheBase + "_specular.dds";
+	irradianceCachePath = cacheBase + "_irradiance.dds";
+	//The LUT does not depend on the environment
+	brdfCachePath = GetDirectory(equirectPath) + "/brdf_lut.dds";
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	if (LoadCache())
+		return true;
+	if (!Compute(equirectPath, environmentSize, specularSize))
+		return false;
+	SaveCache();
+	return true;
+}
+
+void ImageBasedLighting::Destroy()
+{
+	const unsigned textures[3] = { environmentMap, specularMap, brdfLut };
+	glDeleteTextures(3, textures);
+	environmentMap = 0;
+	specularMap = 0;
+	brdfLut = 0;
+}
+
+void ImageBasedLighting::Bind(Shader& shader, int firstTextureUnit) const
+{
+	shader.SetBool("iblEnable", specularMap != 0);
+	if (specularMap == 0)
+		return;
+	for (int i = 0; i < irradianceCoefficientNmb; i++)
+	{
+		shader.SetVec3("iblIrradiance[" + std::to_string(i) + "]", irradiance[i]);
+	}
+	shader.SetFloat("iblSpecularLevelNmb", (float)specularLevelNmb);
+	shader.SetInt("iblSpecular", firstTextureUnit);
+	shader.SetInt("iblBrdfLut", firstTextureUnit + 1);
+	glActiveTexture(GL_TEXTURE0 + firstTextureUnit);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, specularMap);
+	glActiveTexture(GL_TEXTURE0 + firstTextureUnit + 1);
+	glBindTexture(GL_TEXTURE_2D, brdfLut);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+std::array<glm::vec3, ImageBasedLighting::irradianceCoefficientNmb> ImageBasedLighting::ProjectIrradiance(const float* rgb, int width, int height)
+{
+	rmt_ScopedCPUSample(ProjectIrradiance, 0);
+	//Azimuth only depends on the column
+	std::vector<float> cosPhis(width);
+	std::vector<float> sinPhis(width);
+	for (int x = 0; x < width; x++)
+	{
+		const float phi = 2.0f * pi * ((x + 0.5f) / width - 0.5f);
+		cosPhis[x] = std::cos(phi);
+		sinPhis[x] = std::sin(phi);
+	}
+	//One partial sum per row, reduced in order so the result does not depend on the threads
+	std::vector<glm::vec4> rowSums((size_t)height * irradianceCoefficientNmb);
+	Engine::GetPtr()->GetJobSystem().ParallelFor(height, 16, [&](size_t begin, size_t end)
+	{
+		for (size_t y = begin; y < end; y++)
+		{
+			const float theta = pi * (y + 0.5f) / height;
+			const float sinTheta = std::sin(theta);
+			const float cosTheta = std::cos(theta);
+			//Solid angle of a texel
+			const float weight = (2.0f * pi / width) * (pi / height) * sinTheta;
+			const float* row = rgb + y * width * 3;
+#ifdef IBL_SIMD
+			__m128 sums[irradianceCoefficientNmb];
+			for (auto& sum : sums)
+				sum = _mm_setzero_ps();
+			for (int x = 0; x < width; x++)
+			{
+				const float dx = sinTheta * cosPhis[x];
+				const float dy = cosTheta;
+				const float dz = sinTheta * sinPhis[x];
+				const __m128 color = _mm_mul_ps(_mm_set_ps(0.0f, row[x * 3 + 2], row[x * 3 + 1], row[x * 3]), _mm_set1_ps(weight));
+				sums[0] = _mm_add_ps(sums[0], _mm_mul_ps(color, _mm_set1_ps(0.282095f)));
+				sums[1] = _mm_add_ps(sums[1], _mm_mul_ps(color, _mm_set1_ps(0.488603f * dy)));
+				sums[2] = _mm_add_ps(sums[2], _mm_mul_ps(color, _mm_set1_ps(0.488603f * dz)));
+				sums[3] = _mm_add_ps(sums[3], _mm_mul_ps(color, _mm_set1_ps(0.488603f * dx)));
+				sums[4] = _mm_add_ps(sums[4], _mm_mul_ps(color, _mm_set1_ps(1.092548f * dx * dy)));
+				sums[5] = _mm_add_ps(sums[5], _mm_mul_ps(color, _mm_set1_ps(1.092548f * dy * dz)));
+				sums[6] = _mm_add_ps(sums[6], _mm_mul_ps(color, _mm_set1_ps(0.315392f * (3.0f * dz * dz - 1.0f))));
+				sums[7] = _mm_add_ps(sums[7], _mm_mul_ps(color, _mm_set1_ps(1.092548f * dx * dz)));
+				sums[8] = _mm_add_ps(sums[8], _mm_mul_ps(color, _mm_set1_ps(0.546274f * (dx * dx - dy * dy))));
+			}
+			for (int i = 0; i < irradianceCoefficientNmb; i++)
+			{
+				_mm_storeu_ps(&rowSums[y * irradianceCoefficientNmb + i].x, sums[i]);
+			}
+#else
+			glm::vec4* sums = &rowSums[y * irradianceCoefficientNmb];
+			for (int x = 0; x < width; x++)
+			{
+				const float dx = sinTheta * cosPhis[x];
+				const float dy = cosTheta;
+				const float dz = sinTheta * sinPhis[x];
+				const glm::vec4 color = glm::vec4(row[x * 3], row[x * 3 + 1], row[x * 3 + 2], 0.0f) * weight;
+				sums[0] += color * 0.282095f;
+				sums[1] += color * (0.488603f * dy);
+				sums[2] += color * (0.488603f * dz);
+				sums[3] += color * (0.488603f * dx);
+				sums[4] += color * (1.092548f * dx * dy);
+				sums[5] += color * (1.092548f * dy * dz);
+				sums[6] += color * (0.315392f * (3.0f * dz * dz - 1.0f));
+				sums[7] += color * (1.092548f * dx * dz);
+				sums[8] += color * (0.546274f * (dx * dx - dy * dy));
+			}
+#endif
+		}
+	});
+	std::array<glm::vec3, irradianceCoefficientNmb> coefficients = {};
+	for (int y = 0; y < height; y++)
+	{
+		for (int i = 0; i < irradianceCoefficientNmb; i++)
+		{
+			coefficients[i] += glm::vec3(rowSums[(size_t)y * irradianceCoefficientNmb + i]);
+		}
+	}
+	for (int i = 0; i < irradianceCoefficientNmb; i++)
+	{
+		coefficients[i] *= bandWeights[i == 0 ? 0 : i < 4 ? 1 : 2];
+	}
+	return coefficients;
+}
+
+bool ImageBasedLighting::LoadCache()
+{
+	FileSystem& fileSystem = Engine::GetPtr()->GetFileSystem();
+	if (!fileSystem.Exists(environmentCachePath) || !fileSystem.Exists(specularCachePath) ||
+		!fileSystem.Exists(irradianceCachePath) || !fileSystem.Exists(brdfCachePath))
+	{
+		return false;
+	}
+	const FileView irradianceFile = LoadBinaryFile(irradianceCachePath);
+	const gli::texture irradianceTexture = gli::load(reinterpret_cast<const char*>(irradianceFile.GetData()), irradianceFile.GetSize());
+	if (irradianceTexture.empty() || irradianceTexture.format() != gli::FORMAT_RGBA32_SFLOAT_PACK32 ||
+		irradianceTexture.extent().x != irradianceCoefficientNmb)
+	{
+		std::cerr << "[Error] IBL: " << irradianceCachePath << " is not an irradiance cache\n";
+		return false;
+	}
+	const glm::vec4* coefficients = irradianceTexture.data<glm::vec4>();
+	for (int i = 0; i < irradianceCoefficientNmb; i++)
+	{
+		irradiance[i] = glm::vec3(coefficients[i]);
+	}
+
+	environmentMap = gliCreateTexture(environmentCachePath.c_str());
+	specularMap = gliCreateTexture(specularCachePath.c_str());
+	brdfLut = gliCreateTexture(brdfCachePath.c_str());
+	if (environmentMap == 0 || specularMap == 0 || brdfLut == 0)
+	{
+		Destroy();
+		return false;
+	}
+	int environmentSize = 0;
+	int specularSize = 0;
+	glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMap);
+	glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &environmentSize);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, specularMap);
+	glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &specularSize);
+	specularLevelNmb = GetLevelNmb(specularSize, specularMinSize);
+	SetCubeSampling(environmentMap, GetLevelNmb(environmentSize, 1));
+	SetCubeSampling(specularMap, specularLevelNmb);
+	SetLutSampling(brdfLut);
+	return true;
+}
+
+bool ImageBasedLighting::Compute(const std::string& equirectPath, int environmentSize, int specularSize)
+{
+	rmt_ScopedCPUSample(ComputeImageBasedLighting, 0);
+	rmt_ScopedOpenGLSample(ComputeImageBasedLightingGPU);
+	const FileView file = LoadBinaryFile(equirectPath);
+	int width = 0;
+	int height = 0;
+	int channelNmb = 0;
+	float* equirectData = file.IsValid() ?
+		stbi_loadf_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, &channelNmb, 3) : nullptr;
+	if (equirectData == nullptr)
+	{
+		std::cerr << "[Error] IBL: cannot load " << equirectPath << "\n";
+		return false;
+	}
+	irradiance = ProjectIrradiance(equirectData, width, height);
+
+	unsigned equirect;
+	glGenTextures(1, &equirect);
+	glBindTexture(GL_TEXTURE_2D, equirect);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGB, GL_FLOAT, equirectData);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	stbi_image_free(equirectData);
+
+	//Environment cube with its full mip chain, the prefilter reads the mips matching its sample footprint
+	const int environmentLevelNmb = GetLevelNmb(environmentSize, 1);
+	glGenTextures(1, &environmentMap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMap);
+	glTexStorage2D(GL_TEXTURE_CUBE_MAP, environmentLevelNmb, GL_RGBA16F, environmentSize, environmentSize);
+	Shader equirectShader;
+	equirectShader.CompileCompute("shaders/engine/ibl_equirect.comp");
+	equirectShader.Bind();
+	equirectShader.SetInt("equirect", 0);
+	equirectShader.SetInt("faceSize", environmentSize);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, equirect);
+	glBindImageTexture(0, environmentMap, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glDispatchCompute((environmentSize + 7) / 8, (environmentSize + 7) / 8, 6);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glDeleteTextures(1, &equirect);
+	glDeleteProgram(equirectShader.GetProgram());
+	glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMap);
+	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	SetCubeSampling(environmentMap, environmentLevelNmb);
+
+	specularLevelNmb = GetLevelNmb(specularSize, specularMinSize);
+	glGenTextures(1, &specularMap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, specularMap);
+	glTexStorage2D(GL_TEXTURE_CUBE_MAP, specularLevelNmb, GL_RGBA16F, specularSize, specularSize);
+	Shader prefilterShader;
+	prefilterShader.CompileCompute("shaders/engine/ibl_prefilter.comp");
+	prefilterShader.Bind();
+	prefilterShader.SetInt("environment", 0);
+	prefilterShader.SetFloat("environmentSize", (float)environmentSize);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMap);
+	for (int level = 0; level < specularLevelNmb; level++)
+	{
+		const int faceSize = specularSize >> level;
+		const float roughness = specularLevelNmb == 1 ? 0.0f : (float)level / (specularLevelNmb - 1);
+		prefilterShader.SetInt("faceSize", faceSize);
+		prefilterShader.SetFloat("roughness", roughness);
+		//A mirror only needs the reflected direction
+		prefilterShader.SetInt("sampleNmb", level == 0 ? 1 : prefilterSampleNmb);
+		glBindImageTexture(0, specularMap, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+		glDispatchCompute((faceSize + 7) / 8, (faceSize + 7) / 8, 6);
+	}
+	glDeleteProgram(prefilterShader.GetProgram());
+	SetCubeSampling(specularMap, specularLevelNmb);
+
+	glGenTextures(1, &brdfLut);
+	glBindTexture(GL_TEXTURE_2D, brdfLut);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG16F, brdfLutSize, brdfLutSize);
+	Shader brdfShader;
+	brdfShader.CompileCompute("shaders/engine/ibl_brdf.comp");
+	brdfShader.Bind();
+	brdfShader.SetInt("lutSize", brdfLutSize);
+	brdfShader.SetInt("sampleNmb", brdfSampleNmb);
+	glBindImageTexture(0, brdfLut, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+	glDispatchCompute((brdfLutSize + 7) / 8, (brdfLutSize + 7) / 8, 1);
+	glDeleteProgram(brdfShader.GetProgram());
+	SetLutSampling(brdfLut);
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return true;
+}
+
+void ImageBasedLighting::SaveCache() const
+{
+	rmt_ScopedCPUSample(SaveImageBasedLighting, 0);
+	int environmentSize = 0;
+	int specularSize = 0;
+	glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMap);
+	glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &environmentSize);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, specularMap);
+	glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &specularSize);
+	bool saved = SaveCubemap(environmentMap, environmentSize, GetLevelNmb(environmentSize, 1), environmentCachePath);
+	saved = SaveCubemap(specularMap, specularSize, specularLevelNmb, specularCachePath) && saved;
+
+	gli::texture2d lut(gli::FORMAT_RG16_SFLOAT_PACK16, gli::extent2d(brdfLutSize, brdfLutSize), 1);
+	glBindTexture(GL_TEXTURE_2D, brdfLut);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_HALF_FLOAT, lut.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+	saved = gli::save_dds(lut, brdfCachePath) && saved;
+
+	gli::texture2d coefficients(gli::FORMAT_RGBA32_SFLOAT_PACK32, gli::extent2d(irradianceCoefficientNmb, 1), 1);
+	for (int i = 0; i < irradianceCoefficientNmb; i++)
+	{
+		coefficients.store(gli::extent2d(i, 0), 0, glm::vec4(irradiance[i], 0.0f));
+	}
+	saved = gli::save_dds(coefficients, irradianceCachePath) && saved;
+	if (!saved)
+	{
+		std::cerr << "[Error] IBL: cannot write the cache next to " << environmentCachePath << "\n";
+	}
+}
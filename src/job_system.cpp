@@ -0,0 +1,45 @@
+#include <job_system.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+void JobSystem::Init(int threadNmb)
+{
+	if (threadNmb < 0)
+	{
+		threadNmb = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	}
+	pool.resize(threadNmb);
+}
+
+void JobSystem::Destroy()
+{
+	pool.stop(true);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& job)
+{
+	if (count == 0)
+		return;
+	grainSize = std::max<size_t>(grainSize, 1);
+	const size_t maxChunkNmb = (size_t)pool.size() + 1;
+	const size_t chunkNmb = std::min(maxChunkNmb, (count + grainSize - 1) / grainSize);
+	if (chunkNmb <= 1)
+	{
+		job(0, count);
+		return;
+	}
+	const size_t chunkSize = (count + chunkNmb - 1) / chunkNmb;
+	std::vector<std::future<void>> futures;
+	futures.reserve(chunkNmb - 1);
+	for (size_t begin = chunkSize; begin < count; begin += chunkSize)
+	{
+		const size_t end = std::min(count, begin + chunkSize);
+		futures.push_back(pool.push([&job, begin, end](int) { job(begin, end); }));
+	}
+	job(0, std::min(count, chunkSize));
+	for (auto& future : futures)
+	{
+		future.wait();
+	}
+}
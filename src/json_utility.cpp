@@ -23,10 +23,12 @@ SOFTWARE.
 */
 
 #include <json_utility.h>
+#include <file_utility.h>
 
 #include <fstream>
 #include <string>
 #include <iostream>
+#include <cstring>
 
 
 bool IsJsonValueNumeric(const json::value_type & jsonValue)
@@ -56,8 +58,8 @@ bool CheckJsonNumber(const json& jsonObject, std::string parameterName)
 
 std::unique_ptr<json> LoadJson(std::string jsonPath)
 {
-	std::ifstream jsonFile(jsonPath.c_str());
-	if (jsonFile.peek() == std::ifstream::traits_type::eof())
+	const FileView jsonFile = LoadBinaryFile(jsonPath);
+	if (jsonFile.GetSize() == 0)
 	{
 		{
 			std::cerr << "[JSON ERROR] EMPTY JSON FILE at: " << jsonPath << "\n";
@@ -67,7 +69,7 @@ std::unique_ptr<json> LoadJson(std::string jsonPath)
 	std::unique_ptr<json> jsonContent = std::make_unique<json>();
 	try
 	{
-		jsonFile >> *jsonContent;
+		*jsonContent = json::parse(jsonFile.GetData(), jsonFile.GetData() + jsonFile.GetSize());
 	}
 	catch (json::parse_error& e)
 	{
@@ -88,3 +90,102 @@ glm::vec3 ConvertVec3FromJson(const json& vec3Json)
     return vector3;
 }
 
+
+bool JsonSaxReader::Parse(const std::string& jsonPath)
+{
+	const FileView file = LoadBinaryFile(jsonPath);
+	if (!file.IsValid())
+		return false;
+	path = jsonPath;
+	frames.clear();
+	failed = false;
+	//Through the interface, the event functions are private to the derived readers
+	nlohmann::json_sax<json>* sax = this;
+	const char* data = reinterpret_cast<const char*>(file.GetData());
+	return json::sax_parse(nlohmann::detail::input_adapter(data, file.GetSize()), sax) && !failed;
+}
+
+bool JsonSaxReader::Matches(std::initializer_list<const char*> pattern) const
+{
+	if (pattern.size() != frames.size())
+		return false;
+	size_t depth = 0;
+	for (const char* element : pattern)
+	{
+		const Frame& frame = frames[depth++];
+		if (frame.array ? std::strcmp(element, "[]") != 0 : frame.key != element)
+			return false;
+	}
+	return true;
+}
+
+std::string JsonSaxReader::GetPathString() const
+{
+	std::string pathString;
+	for (auto& frame : frames)
+	{
+		if (frame.array)
+			pathString += "[" + std::to_string(frame.index) + "]";
+		else
+			pathString += (pathString.empty() ? "" : ".") + frame.key;
+	}
+	return pathString;
+}
+
+bool JsonSaxReader::Fail(const std::string& message)
+{
+	std::cerr << "[Error] JSON: " << path << " at " << GetPathString() << ": " << message << "\n";
+	failed = true;
+	return false;
+}
+
+bool JsonSaxReader::EndValue()
+{
+	if (!frames.empty() && frames.back().array)
+		frames.back().index++;
+	return true;
+}
+
+bool JsonSaxReader::start_object(std::size_t)
+{
+	if (!OnStartObject())
+		return false;
+	frames.push_back(Frame());
+	return true;
+}
+
+bool JsonSaxReader::key(string_t& value)
+{
+	frames.back().key = value;
+	return true;
+}
+
+bool JsonSaxReader::end_object()
+{
+	frames.pop_back();
+	return OnEndObject() && EndValue();
+}
+
+bool JsonSaxReader::start_array(std::size_t)
+{
+	if (!OnStartArray())
+		return false;
+	Frame frame;
+	frame.array = true;
+	frames.push_back(frame);
+	return true;
+}
+
+bool JsonSaxReader::end_array()
+{
+	frames.pop_back();
+	return EndValue();
+}
+
+bool JsonSaxReader::parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& exception)
+{
+	//The parser message holds the line and column of the error
+	std::cerr << "[Error] JSON: " << path << ": " << exception.what() << "\n";
+	failed = true;
+	return false;
+}
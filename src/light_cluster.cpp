@@ -0,0 +1,189 @@
+#include <light_cluster.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <cmath>
+#include <Remotery.h>
+
+namespace
+{
+const unsigned clusterLightsBinding = 3;
+const unsigned clusterGridBinding = 4;
+const unsigned clusterIndicesBinding = 5;
+const unsigned clusterSpotLightsBinding = 8;
+}
+
+void LightCluster::Init()
+{
+	glGenBuffers(1, &lightsSsbo);
+	glGenBuffers(1, &spotLightsSsbo);
+	glGenBuffers(1, &gridSsbo);
+	glGenBuffers(1, &indicesSsbo);
+	clusterLights.resize(clusterNmb);
+	grid.resize(clusterNmb);
+}
+
+void LightCluster::Destroy()
+{
+	glDeleteBuffers(1, &lightsSsbo);
+	glDeleteBuffers(1, &spotLightsSsbo);
+	glDeleteBuffers(1, &gridSsbo);
+	glDeleteBuffers(1, &indicesSsbo);
+}
+
+void LightCluster::AddLightBounds(const glm::vec3& viewMin, const glm::vec3& viewMax)
+{
+	lightMinX.push_back(viewMin.x);
+	lightMaxX.push_back(viewMax.x);
+	lightMinY.push_back(viewMin.y);
+	lightMaxY.push_back(viewMax.y);
+	//The view looks down -z
+	lightMinDepth.push_back(-viewMax.z);
+	lightMaxDepth.push_back(-viewMin.z);
+}
+
+void LightCluster::Update(const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights,
+	const glm::mat4& view, const glm::mat4& projection, float near, float far)
+{
+	rmt_ScopedCPUSample(LightClusterAssignment, 0);
+	this->near = near;
+	this->far = far;
+	projectionScale = glm::vec2(projection[0][0], projection[1][1]);
+
+	lightMinX.clear();
+	lightMaxX.clear();
+	lightMinY.clear();
+	lightMaxY.clear();
+	lightMinDepth.clear();
+	lightMaxDepth.clear();
+	lightData.clear();
+	spotLightData.clear();
+	for (auto& pointLight : pointLights)
+	{
+		if (!pointLight.enable)
+			continue;
+		const glm::vec3 viewPosition = glm::vec3(view * glm::vec4(pointLight.position, 1.0f));
+		AddLightBounds(viewPosition - pointLight.distance, viewPosition + pointLight.distance);
+		lightData.emplace_back(pointLight.position, pointLight.distance);
+		lightData.emplace_back(pointLight.color, pointLight.intensity);
+	}
+	pointLightNmb = lightMinX.size();
+	//Longest distance from the camera to a point of the frustum, a cone that long from its apex reaches all of it
+	const float frustumReach = far * std::sqrt(1.0f + 1.0f / (projectionScale.x * projectionScale.x) + 1.0f / (projectionScale.y * projectionScale.y));
+	for (auto& spotLight : spotLights)
+	{
+		if (!spotLight.enable)
+			continue;
+		//The cut offs are in degrees, like in SpotLight::Bind
+		const float cosCutOff = std::cos(glm::radians(spotLight.cutOff));
+		const float cosOuterCutOff = std::cos(glm::radians(spotLight.outerCutOff));
+		const glm::vec3 apex = glm::vec3(view * glm::vec4(spotLight.position, 1.0f));
+		const float length = glm::length(apex) + frustumReach;
+		if (cosOuterCutOff <= 0.0f)
+		{
+			//Wider than a half space, only the sphere around the apex bounds it
+			AddLightBounds(apex - length, apex + length);
+		}
+		else
+		{
+			//Box of the apex and of the disc closing the cone
+			const glm::vec3 direction = glm::normalize(glm::mat3(view) * spotLight.direction);
+			const glm::vec3 capCenter = apex + direction * length;
+			const float capRadius = length * std::sqrt(1.0f - cosOuterCutOff * cosOuterCutOff) / cosOuterCutOff;
+			const glm::vec3 capExtent = capRadius * glm::sqrt(glm::max(glm::vec3(1.0f) - direction * direction, glm::vec3(0.0f)));
+			AddLightBounds(glm::min(apex, capCenter - capExtent), glm::max(apex, capCenter + capExtent));
+		}
+		spotLightData.emplace_back(spotLight.position, cosCutOff);
+		spotLightData.emplace_back(glm::normalize(spotLight.direction), cosOuterCutOff);
+		spotLightData.emplace_back(spotLight.color, spotLight.intensity);
+	}
+
+	//Each slice owns its clusters, no synchronization needed
+	Engine::GetPtr()->GetJobSystem().ParallelFor(clusterZ, 1, [this](size_t begin, size_t end)
+	{
+		for (size_t slice = begin; slice < end; slice++)
+			AssignSlice((int)slice);
+	});
+
+	lightIndices.clear();
+	for (int cluster = 0; cluster < clusterNmb; cluster++)
+	{
+		//The lights are assigned in order, the point lights of a cluster come first
+		const auto& lights = clusterLights[cluster];
+		const size_t clusterPointLightNmb = std::lower_bound(lights.begin(), lights.end(), (uint32_t)pointLightNmb) - lights.begin();
+		grid[cluster] = glm::uvec4(lightIndices.size(), clusterPointLightNmb, lights.size() - clusterPointLightNmb, 0);
+		for (const uint32_t light : lights)
+			lightIndices.push_back(light < pointLightNmb ? light : light - (uint32_t)pointLightNmb);
+	}
+	//Empty buffers cannot be bound
+	if (lightData.empty())
+		lightData.emplace_back(0.0f);
+	if (spotLightData.empty())
+		spotLightData.emplace_back(0.0f);
+	if (lightIndices.empty())
+		lightIndices.push_back(0);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightsSsbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, lightData.size() * sizeof(glm::vec4), lightData.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, spotLightsSsbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, spotLightData.size() * sizeof(glm::vec4), spotLightData.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridSsbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, grid.size() * sizeof(glm::uvec4), grid.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, indicesSsbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, lightIndices.size() * sizeof(uint32_t), lightIndices.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void LightCluster::AssignSlice(int slice)
+{
+	const float depthRatio = far / near;
+	const float sliceNear = near * std::pow(depthRatio, (float)slice / clusterZ);
+	const float sliceFar = near * std::pow(depthRatio, (float)(slice + 1) / clusterZ);
+	const int sliceOffset = slice * clusterX * clusterY;
+	for (int cluster = 0; cluster < clusterX * clusterY; cluster++)
+		clusterLights[sliceOffset + cluster].clear();
+
+	const size_t lightNmb = lightMinX.size();
+	for (size_t light = 0; light < lightNmb; light++)
+	{
+		if (lightMaxDepth[light] < sliceNear || lightMinDepth[light] > sliceFar)
+			continue;
+		//Conservative screen bounds of the light box clipped to the slice depth range
+		const float minDepth = std::max(sliceNear, lightMinDepth[light]);
+		const float maxDepth = std::min(sliceFar, lightMaxDepth[light]);
+		const float minX = lightMinX[light];
+		const float maxX = lightMaxX[light];
+		const float minY = lightMinY[light];
+		const float maxY = lightMaxY[light];
+		const float ndcMinX = projectionScale.x * minX / (minX < 0.0f ? minDepth : maxDepth);
+		const float ndcMaxX = projectionScale.x * maxX / (maxX > 0.0f ? minDepth : maxDepth);
+		const float ndcMinY = projectionScale.y * minY / (minY < 0.0f ? minDepth : maxDepth);
+		const float ndcMaxY = projectionScale.y * maxY / (maxY > 0.0f ? minDepth : maxDepth);
+		if (ndcMaxX < -1.0f || ndcMinX > 1.0f || ndcMaxY < -1.0f || ndcMinY > 1.0f)
+			continue;
+
+		const int tileMinX = glm::clamp((int)std::floor((ndcMinX * 0.5f + 0.5f) * clusterX), 0, clusterX - 1);
+		const int tileMaxX = glm::clamp((int)std::floor((ndcMaxX * 0.5f + 0.5f) * clusterX), 0, clusterX - 1);
+		const int tileMinY = glm::clamp((int)std::floor((ndcMinY * 0.5f + 0.5f) * clusterY), 0, clusterY - 1);
+		const int tileMaxY = glm::clamp((int)std::floor((ndcMaxY * 0.5f + 0.5f) * clusterY), 0, clusterY - 1);
+		for (int y = tileMinY; y <= tileMaxY; y++)
+		{
+			for (int x = tileMinX; x <= tileMaxX; x++)
+			{
+				clusterLights[sliceOffset + y * clusterX + x].push_back((uint32_t)light);
+			}
+		}
+	}
+}
+
+void LightCluster::Bind(Shader& shader) const
+{
+	auto& config = Engine::GetPtr()->GetConfiguration();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, clusterLightsBinding, lightsSsbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, clusterSpotLightsBinding, spotLightsSsbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, clusterGridBinding, gridSsbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, clusterIndicesBinding, indicesSsbo);
+	shader.SetVec2("clusterScreenSize", (float)config.renderWidth, (float)config.renderHeight);
+	shader.SetFloat("clusterNear", near);
+	shader.SetFloat("clusterFar", far);
+}
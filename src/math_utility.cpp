@@ -1,8 +1,15 @@
 #include <cstdlib>
 #include <math_utility.h>
+#include <glm/common.hpp>
 
 int RandomRange(const int start, const int end)
 {
 	const int random = rand();
 	return (random % (abs(start) + abs(end))) + start;
 }
+
+uint32_t PackColor(const glm::vec4& color)
+{
+	const glm::uvec4 bytes = glm::uvec4(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+	return bytes.r | bytes.g << 8 | bytes.b << 16 | bytes.a << 24;
+}
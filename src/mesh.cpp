@@ -37,6 +37,13 @@ void Mesh::Draw(Shader shader)
 	glBindVertexArray(0);
 }
 
+void Mesh::DrawGeometry()
+{
+	glBindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	glBindVertexArray(0);
+}
+
 void Mesh::setupMesh()
 {
 	glGenVertexArrays(1, &VAO);
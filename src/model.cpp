@@ -1,7 +1,63 @@
 #include <model.h>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "file_utility.h"
 #include <glm/glm.hpp>
+#include <limits>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <assimp/pbrmaterial.h>
+
+namespace
+{
+//Assimp reads the model and the files it references (materials, buffers) through the engine file system
+class FileViewStream : public Assimp::IOStream
+{
+public:
+	explicit FileViewStream(FileView&& file) : file(std::move(file)) {}
+
+	size_t Read(void* buffer, size_t size, size_t count) override
+	{
+		if (size == 0)
+			return 0;
+		count = std::min(count, (file.GetSize() - position) / size);
+		std::memcpy(buffer, file.GetData() + position, size * count);
+		position += size * count;
+		return count;
+	}
+	size_t Write(const void*, size_t, size_t) override { return 0; }
+	aiReturn Seek(size_t offset, aiOrigin origin) override
+	{
+		const size_t base = origin == aiOrigin_SET ? 0 : origin == aiOrigin_CUR ? position : file.GetSize();
+		if (base + offset > file.GetSize())
+			return aiReturn_FAILURE;
+		position = base + offset;
+		return aiReturn_SUCCESS;
+	}
+	size_t Tell() const override { return position; }
+	size_t FileSize() const override { return file.GetSize(); }
+	void Flush() override {}
+private:
+	FileView file;
+	size_t position = 0;
+};
+
+class FileSystemIOSystem : public Assimp::IOSystem
+{
+public:
+	bool Exists(const char* path) const override { return Engine::GetPtr()->GetFileSystem().Exists(path); }
+	char getOsSeparator() const override { return '/'; }
+	Assimp::IOStream* Open(const char* path, const char* mode) override
+	{
+		if (std::strchr(mode, 'w') != nullptr || std::strchr(mode, 'a') != nullptr)
+			return nullptr;
+		FileView file = LoadBinaryFile(path);
+		return file.IsValid() ? new FileViewStream(std::move(file)) : nullptr;
+	}
+	void Close(Assimp::IOStream* stream) override { delete stream; }
+};
+}
 
 void Model::Draw(Shader& shader)
 {
@@ -12,7 +68,13 @@ void Model::Draw(Shader& shader)
 void Model::loadModel(std::string path, bool generateSphere)
 {
 	Assimp::Importer import;
-	const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+	import.SetIOHandler(new FileSystemIOSystem());
+	unsigned int flags = aiProcess_Triangulate | aiProcess_FlipUVs;
+	const std::string extension = GetFilenameExtension(path);
+	//glTF places its meshes with the node transforms and may leave the normals out
+	if (extension == ".gltf" || extension == ".glb")
+		flags |= aiProcess_PreTransformVertices | aiProcess_GenSmoothNormals;
+	const aiScene *scene = import.ReadFile(path, flags);
 
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 	{
@@ -22,6 +84,16 @@ void Model::loadModel(std::string path, bool generateSphere)
 	directory = path.substr(0, path.find_last_of('/'));
 
 	processNode(scene->mRootNode, scene);
+	bounds.min = glm::vec3(std::numeric_limits<float>::max());
+	bounds.max = glm::vec3(-std::numeric_limits<float>::max());
+	for (auto& mesh : meshes)
+	{
+		for (auto& vert : mesh.vertices)
+		{
+			bounds.min = glm::min(bounds.min, vert.Position);
+			bounds.max = glm::max(bounds.max, vert.Position);
+		}
+	}
 	if(generateSphere)
 	{
 		unsigned vertNmb = 0;
@@ -160,6 +232,22 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
 	}
 	// process materials
 	aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+	PbrFactors pbrFactors;
+	if (loadPbrFactors(material, pbrFactors))
+	{
+		// glTF: base color, normal map and the occlusion, roughness and metallic packed in one map
+		std::vector<Texture> baseColorMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", 1);
+		textures.insert(textures.end(), baseColorMaps.begin(), baseColorMaps.end());
+		std::vector<Texture> pbrNormalMaps = loadMaterialTextures(material, aiTextureType_NORMALS, "texture_normal", 1);
+		textures.insert(textures.end(), pbrNormalMaps.begin(), pbrNormalMaps.end());
+		const Texture ormMap = loadOrmTexture(material);
+		if (ormMap.id != 0)
+			textures.push_back(ormMap);
+		Mesh pbrMesh(vertices, indices, textures);
+		pbrMesh.pbr = true;
+		pbrMesh.pbrFactors = pbrFactors;
+		return pbrMesh;
+	}
 	// we assume a convention for sampler names in the shaders. Each diffuse texture should be named
 	// as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
 	// Same applies to other texture as the following list summarizes:
@@ -173,21 +261,23 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
 	// 2. specular maps
 	std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
 	textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-	// 3. normal maps
-	std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+	// 3. normal maps, OBJ map_bump is imported as a height texture so it is only the fallback
+	const bool hasNormals = material->GetTextureCount(aiTextureType_NORMALS) > 0;
+	std::vector<Texture> normalMaps = loadMaterialTextures(material, hasNormals ? aiTextureType_NORMALS : aiTextureType_HEIGHT, "texture_normal");
 	textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-	// 4. height maps
-	std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+	// 4. height maps, the height texture is taken when it is not already the normal map
+	const bool hasHeight = hasNormals && material->GetTextureCount(aiTextureType_HEIGHT) > 0;
+	std::vector<Texture> heightMaps = loadMaterialTextures(material, hasHeight ? aiTextureType_HEIGHT : aiTextureType_DISPLACEMENT, "texture_height");
 	textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 	// return a mesh object created from the extracted mesh data
 	return Mesh(vertices, indices, textures);
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName, unsigned int maxCount)
 {
 	std::vector<Texture> textures;
-	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+	for (unsigned int i = 0; i < std::min(mat->GetTextureCount(type), maxCount); i++)
 	{
 		aiString str;
 		mat->GetTexture(type, i, &str);
@@ -219,3 +309,43 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
 	return textures;
 }
 
+
+bool Model::loadPbrFactors(aiMaterial* mat, PbrFactors& factors)
+{
+	aiColor4D baseColor;
+	if (mat->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_BASE_COLOR_FACTOR, baseColor) != AI_SUCCESS)
+		return false;
+	factors.baseColor = glm::vec4(baseColor.r, baseColor.g, baseColor.b, baseColor.a);
+	mat->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLIC_FACTOR, factors.metallic);
+	mat->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_ROUGHNESS_FACTOR, factors.roughness);
+	mat->Get(AI_MATKEY_GLTF_TEXTURE_SCALE(aiTextureType_NORMALS, 0), factors.normalScale);
+	return true;
+}
+
+Texture Model::loadOrmTexture(aiMaterial* mat)
+{
+	aiString metallicRoughness;
+	aiString occlusion;
+	const bool hasMetallicRoughness = mat->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, &metallicRoughness) == AI_SUCCESS;
+	const bool hasOcclusion = mat->GetTexture(aiTextureType_LIGHTMAP, 0, &occlusion) == AI_SUCCESS;
+	Texture texture = {};
+	if (!hasMetallicRoughness && !hasOcclusion)
+		return texture;
+	texture.type = "texture_orm";
+	texture.path = std::string(occlusion.C_Str()) + "|" + metallicRoughness.C_Str();
+	for (auto& loadedTexture : textures_loaded)
+	{
+		if (loadedTexture.path == texture.path)
+			return loadedTexture;
+	}
+	//glTF already stores roughness and metallic in green and blue, the occlusion is merged in red at cook time
+	const std::string metallicRoughnessPath = hasMetallicRoughness ? directory + "/" + GetFilenameFromPath(metallicRoughness.C_Str()) : "";
+	const std::string occlusionPath = hasOcclusion ? directory + "/" + GetFilenameFromPath(occlusion.C_Str()) : "";
+	const std::string sourcePath = hasMetallicRoughness ? metallicRoughnessPath : occlusionPath;
+	const std::string ormPath = sourcePath.substr(0, sourcePath.find_last_of('.')) + "_ORM.dds";
+	if (!CookOrmTexture({ occlusionPath, 0 }, { metallicRoughnessPath, 1 }, { metallicRoughnessPath, 2 }, ormPath))
+		return Texture();
+	texture.id = CreateOrmTexture(ormPath);
+	textures_loaded.push_back(texture);
+	return texture;
+}
@@ -0,0 +1,342 @@
+#include <occlusion.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <Remotery.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SIMD 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+const float depthBias = 1e-5f;
+const float edgeTolerance = 1e-3f;
+
+//Clip a clip space polygon against the near plane (z + w >= 0)
+int ClipNear(const glm::vec4* input, int inputNmb, glm::vec4* output)
+{
+	int outputNmb = 0;
+	for (int i = 0; i < inputNmb; i++)
+	{
+		const glm::vec4& current = input[i];
+		const glm::vec4& next = input[(i + 1) % inputNmb];
+		const float currentDistance = current.z + current.w;
+		const float nextDistance = next.z + next.w;
+		if (currentDistance >= 0.0f)
+			output[outputNmb++] = current;
+		if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+		{
+			const float t = currentDistance / (currentDistance - nextDistance);
+			output[outputNmb++] = current + (next - current) * t;
+		}
+	}
+	return outputNmb;
+}
+
+//Converting a float out of the int range is undefined, the projection of a vertex close to w = 0 goes far beyond it.
+//A NaN ends on minValue.
+int ClampToInt(float value, int minValue, int maxValue)
+{
+	return value > (float)minValue ? (value < (float)maxValue ? (int)value : maxValue) : minValue;
+}
+}
+
+void OcclusionCuller::Init(int width, int height)
+{
+	//Tiles and blocks need whole pixels, round the resolution up
+	this->width = (width + tileWidth - 1) / tileWidth * tileWidth;
+	this->height = (height + tileHeight - 1) / tileHeight * tileHeight;
+	tilesX = this->width / tileWidth;
+	tilesY = this->height / tileHeight;
+	blocksX = this->width / blockSize;
+	blocksY = this->height / blockSize;
+	depthBuffer.assign(this->width * this->height, 1.0f);
+	blockMaxDepth.assign(blocksX * blocksY, 1.0f);
+	tileBins.assign(tilesX * tilesY, std::vector<int>());
+}
+
+int OcclusionCuller::RegisterOccluder(const std::vector<glm::vec3>& triangles)
+{
+	occluderTriangles.insert(occluderTriangles.end(), triangles.begin(), triangles.end() - triangles.size() % 3);
+	return occluderNmb++;
+}
+
+int OcclusionCuller::RegisterOccludee(const BoundingBox& worldBox)
+{
+	occludeeBoxes.push_back(worldBox);
+	visibility.push_back(1);
+	return (int)occludeeBoxes.size() - 1;
+}
+
+void OcclusionCuller::SetOccludeeBox(int occludee, const BoundingBox& worldBox)
+{
+	occludeeBoxes[occludee] = worldBox;
+}
+
+void OcclusionCuller::Clear()
+{
+	occluderTriangles.clear();
+	occludeeBoxes.clear();
+	visibility.clear();
+	occluderNmb = 0;
+	culledNmb = 0;
+	//A new scene must not be tested against the depth of the previous one
+	screenTriangles.clear();
+	for (auto& bin : tileBins)
+	{
+		bin.clear();
+	}
+	std::fill(depthBuffer.begin(), depthBuffer.end(), 1.0f);
+	std::fill(blockMaxDepth.begin(), blockMaxDepth.end(), 1.0f);
+}
+
+void OcclusionCuller::Update(const glm::mat4& viewProjection)
+{
+	rmt_ScopedCPUSample(OcclusionCullingCPU, 0);
+	if (!enable)
+	{
+		culledNmb = 0;
+		return;
+	}
+	auto& jobSystem = Engine::GetPtr()->GetJobSystem();
+
+	SetupTriangles(viewProjection);
+	jobSystem.ParallelFor(tileBins.size(), 1, [this](size_t begin, size_t end)
+	{
+		for (size_t tile = begin; tile < end; tile++)
+		{
+			RasterizeTile((int)tile);
+		}
+	});
+	jobSystem.ParallelFor(occludeeBoxes.size(), 64, [this, &viewProjection](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			visibility[i] = TestOccludee(occludeeBoxes[i], viewProjection) ? 1 : 0;
+		}
+	});
+	culledNmb = std::count(visibility.begin(), visibility.end(), 0);
+}
+
+void OcclusionCuller::SetupTriangles(const glm::mat4& viewProjection)
+{
+	screenTriangles.clear();
+	for (auto& bin : tileBins)
+	{
+		bin.clear();
+	}
+	const glm::vec2 screenSize((float)width, (float)height);
+	for (size_t i = 0; i + 2 < occluderTriangles.size(); i += 3)
+	{
+		glm::vec4 clipVertices[3];
+		for (int k = 0; k < 3; k++)
+		{
+			clipVertices[k] = viewProjection * glm::vec4(occluderTriangles[i + k], 1.0f);
+		}
+		glm::vec4 polygon[4];
+		const int polygonNmb = ClipNear(clipVertices, 3, polygon);
+		for (int k = 1; k + 1 < polygonNmb; k++)
+		{
+			ScreenTriangle triangle;
+			const glm::vec4* fan[3] = { &polygon[0], &polygon[k], &polygon[k + 1] };
+			glm::vec2 minPos(screenSize);
+			glm::vec2 maxPos(0.0f);
+			for (int v = 0; v < 3; v++)
+			{
+				const glm::vec3 ndc = glm::vec3(*fan[v]) / fan[v]->w;
+				triangle.vertices[v] = glm::vec3(
+					(ndc.x * 0.5f + 0.5f) * screenSize.x,
+					(ndc.y * 0.5f + 0.5f) * screenSize.y,
+					ndc.z * 0.5f + 0.5f);
+				minPos = glm::min(minPos, glm::vec2(triangle.vertices[v]));
+				maxPos = glm::max(maxPos, glm::vec2(triangle.vertices[v]));
+			}
+			if (maxPos.x < 0.0f || maxPos.y < 0.0f || minPos.x >= screenSize.x || minPos.y >= screenSize.y)
+				continue;
+			const int index = (int)screenTriangles.size();
+			screenTriangles.push_back(triangle);
+			const int minTileX = ClampToInt(minPos.x, 0, width - 1) / tileWidth;
+			const int minTileY = ClampToInt(minPos.y, 0, height - 1) / tileHeight;
+			const int maxTileX = ClampToInt(maxPos.x, 0, width - 1) / tileWidth;
+			const int maxTileY = ClampToInt(maxPos.y, 0, height - 1) / tileHeight;
+			for (int y = minTileY; y <= maxTileY; y++)
+			{
+				for (int x = minTileX; x <= maxTileX; x++)
+				{
+					tileBins[y * tilesX + x].push_back(index);
+				}
+			}
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTile(int tileIndex)
+{
+	const int tileX = (tileIndex % tilesX) * tileWidth;
+	const int tileY = (tileIndex / tilesX) * tileHeight;
+	for (int y = tileY; y < tileY + tileHeight; y++)
+	{
+		std::fill_n(&depthBuffer[y * width + tileX], tileWidth, 1.0f);
+	}
+	for (const int triangleIndex : tileBins[tileIndex])
+	{
+		RasterizeTriangle(screenTriangles[triangleIndex], tileX, tileY, tileX + tileWidth, tileY + tileHeight);
+	}
+	//Build the hierarchy level of the blocks covered by this tile
+	for (int by = tileY / blockSize; by < (tileY + tileHeight) / blockSize; by++)
+	{
+		for (int bx = tileX / blockSize; bx < (tileX + tileWidth) / blockSize; bx++)
+		{
+			float maxDepth = 0.0f;
+			for (int y = by * blockSize; y < (by + 1) * blockSize; y++)
+			{
+				const float* row = &depthBuffer[y * width + bx * blockSize];
+				maxDepth = std::max(maxDepth, *std::max_element(row, row + blockSize));
+			}
+			blockMaxDepth[by * blocksX + bx] = maxDepth;
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTriangle(const ScreenTriangle& triangle, int minX, int minY, int maxX, int maxY)
+{
+	glm::vec3 v0 = triangle.vertices[0];
+	glm::vec3 v1 = triangle.vertices[1];
+	glm::vec3 v2 = triangle.vertices[2];
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (std::abs(area) < 1e-6f)
+		return;
+	//Occluders are two sided, always rasterize counter clockwise
+	if (area < 0.0f)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+	minX = ClampToInt(std::floor(std::min({ v0.x, v1.x, v2.x })), minX, maxX);
+	minY = ClampToInt(std::floor(std::min({ v0.y, v1.y, v2.y })), minY, maxY);
+	maxX = ClampToInt(std::ceil(std::max({ v0.x, v1.x, v2.x })), minX, maxX);
+	maxY = ClampToInt(std::ceil(std::max({ v0.y, v1.y, v2.y })), minY, maxY);
+	if (minX >= maxX || minY >= maxY)
+		return;
+
+	//Edge functions E(p) = a * p.x + b * p.y + c, positive inside the triangle
+	const glm::vec3* edges[3][2] = { { &v1, &v2 }, { &v2, &v0 }, { &v0, &v1 } };
+	float a[3], b[3], c[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec3& start = *edges[i][0];
+		const glm::vec3& end = *edges[i][1];
+		a[i] = start.y - end.y;
+		b[i] = end.x - start.x;
+		c[i] = (end.y - start.y) * start.x - (end.x - start.x) * start.y;
+		//Small tolerance so pixel centers lying on a shared edge are not left uncovered by both triangles
+		c[i] += edgeTolerance * (std::abs(a[i]) + std::abs(b[i]));
+	}
+	//Depth plane from the barycentric weights of v1 and v2
+	const float depthA = (a[1] * (v1.z - v0.z) + a[2] * (v2.z - v0.z)) / area;
+	const float depthB = (b[1] * (v1.z - v0.z) + b[2] * (v2.z - v0.z)) / area;
+	const float depthC = v0.z + (c[1] * (v1.z - v0.z) + c[2] * (v2.z - v0.z)) / area;
+
+	//Start on a multiple of 4 so the rows are processed 4 pixels at a time
+	const int startX = minX & ~3;
+	for (int y = minY; y < maxY; y++)
+	{
+		const float py = (float)y + 0.5f;
+		float* row = &depthBuffer[y * width];
+#ifdef OCCLUSION_SIMD
+		const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 minXs = _mm_set1_ps((float)minX);
+		const __m128 maxXs = _mm_set1_ps((float)maxX);
+		for (int x = startX; x < maxX; x += 4)
+		{
+			const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+			__m128 mask = _mm_and_ps(_mm_cmpge_ps(px, minXs), _mm_cmplt_ps(px, maxXs));
+			for (int i = 0; i < 3; i++)
+			{
+				const __m128 edge = _mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(a[i]), px),
+					_mm_set1_ps(b[i] * py + c[i]));
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(edge, zero));
+			}
+			if (_mm_movemask_ps(mask) == 0)
+				continue;
+			const __m128 depth = _mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(depthA), px),
+				_mm_set1_ps(depthB * py + depthC));
+			const __m128 previousDepth = _mm_loadu_ps(row + x);
+			const __m128 closestDepth = _mm_min_ps(previousDepth, depth);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, closestDepth), _mm_andnot_ps(mask, previousDepth)));
+		}
+#else
+		for (int x = minX; x < maxX; x++)
+		{
+			const float px = (float)x + 0.5f;
+			if (a[0] * px + b[0] * py + c[0] < 0.0f ||
+				a[1] * px + b[1] * py + c[1] < 0.0f ||
+				a[2] * px + b[2] * py + c[2] < 0.0f)
+				continue;
+			row[x] = std::min(row[x], depthA * px + depthB * py + depthC);
+		}
+#endif
+	}
+}
+
+bool OcclusionCuller::TestOccludee(const BoundingBox& box, const glm::mat4& viewProjection) const
+{
+	glm::vec2 minPos(std::numeric_limits<float>::max());
+	glm::vec2 maxPos(-std::numeric_limits<float>::max());
+	float minDepth = 1.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		const glm::vec4 corner(
+			i & 1 ? box.max.x : box.min.x,
+			i & 2 ? box.max.y : box.min.y,
+			i & 4 ? box.max.z : box.min.z,
+			1.0f);
+		const glm::vec4 clipCorner = viewProjection * corner;
+		//Crossing the near plane, the box is too close to be rejected
+		if (clipCorner.z + clipCorner.w < 0.0f)
+			return true;
+		const glm::vec3 ndc = glm::vec3(clipCorner) / clipCorner.w;
+		minPos = glm::min(minPos, glm::vec2(ndc));
+		maxPos = glm::max(maxPos, glm::vec2(ndc));
+		minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+	}
+	//Outside of the screen is the frustum culling job, not the occlusion one
+	if (maxPos.x < -1.0f || maxPos.y < -1.0f || minPos.x > 1.0f || minPos.y > 1.0f)
+		return true;
+	const int minX = ClampToInt(std::floor((minPos.x * 0.5f + 0.5f) * width), 0, width);
+	const int minY = ClampToInt(std::floor((minPos.y * 0.5f + 0.5f) * height), 0, height);
+	const int maxX = ClampToInt(std::ceil((maxPos.x * 0.5f + 0.5f) * width), 0, width);
+	const int maxY = ClampToInt(std::ceil((maxPos.y * 0.5f + 0.5f) * height), 0, height);
+	if (minX >= maxX || minY >= maxY)
+		return true;
+	minDepth -= depthBias;
+
+	for (int by = minY / blockSize; by * blockSize < maxY; by++)
+	{
+		for (int bx = minX / blockSize; bx * blockSize < maxX; bx++)
+		{
+			if (minDepth > blockMaxDepth[by * blocksX + bx])
+				continue;
+			//The block may hide the box, check the pixels that the box actually covers
+			const int startX = std::max(minX, bx * blockSize);
+			const int endX = std::min(maxX, (bx + 1) * blockSize);
+			for (int y = std::max(minY, by * blockSize); y < std::min(maxY, (by + 1) * blockSize); y++)
+			{
+				const float* row = &depthBuffer[y * width];
+				for (int x = startX; x < endX; x++)
+				{
+					if (minDepth <= row[x])
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
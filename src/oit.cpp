@@ -0,0 +1,124 @@
+#include <oit.h>
+#include <engine.h>
+
+#include <iostream>
+#include <Remotery.h>
+
+void WeightedBlendedOit::Init()
+{
+	compositeShader.CompileSource(
+		"shaders/engine/fullscreen.vert",
+		"shaders/engine/oit_composite.frag");
+	glGenVertexArrays(1, &emptyVao);
+	glGenFramebuffers(1, &fbo);
+}
+
+void WeightedBlendedOit::Destroy()
+{
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteVertexArrays(1, &emptyVao);
+	glDeleteTextures(1, &accumulationTexture);
+	glDeleteTextures(1, &revealageTexture);
+	glDeleteTextures(1, &depthTexture);
+	accumulationTexture = 0;
+	revealageTexture = 0;
+	depthTexture = 0;
+	width = 0;
+	height = 0;
+}
+
+void WeightedBlendedOit::ResizeTargets(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	const unsigned formats[3] = { GL_RGBA16F, GL_R16F, GL_DEPTH24_STENCIL8 };
+	unsigned* textures[3] = { &accumulationTexture, &revealageTexture, &depthTexture };
+	for (int i = 0; i < 3; i++)
+	{
+		glDeleteTextures(1, textures[i]);
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_2D, *textures[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulationTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealageTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "[Error] OIT: framebuffer is not complete\n";
+	}
+}
+
+void WeightedBlendedOit::Begin()
+{
+	rmt_ScopedOpenGLSample(BeginTransparency);
+	Engine* engine = Engine::GetPtr();
+	auto& config = engine->GetConfiguration();
+	auto& dynamicResolution = engine->GetDynamicResolution();
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFbo);
+	glGetBooleanv(GL_DEPTH_TEST, &previousDepthTest);
+	glGetBooleanv(GL_DEPTH_WRITEMASK, &previousDepthMask);
+	glGetBooleanv(GL_BLEND, &previousBlend);
+	glGetIntegerv(GL_BLEND_SRC_RGB, &previousBlendFunc[0]);
+	glGetIntegerv(GL_BLEND_DST_RGB, &previousBlendFunc[1]);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &previousBlendFunc[2]);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &previousBlendFunc[3]);
+	//Same allocation as the scene target, a new render scale only changes the copied rectangle
+	if (dynamicResolution.GetTargetWidth() != width || dynamicResolution.GetTargetHeight() != height)
+	{
+		ResizeTargets(dynamicResolution.GetTargetWidth(), dynamicResolution.GetTargetHeight());
+	}
+
+	//The opaque depth rejects the hidden transparent fragments
+	const int renderWidth = (int)config.renderWidth;
+	const int renderHeight = (int)config.renderHeight;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+	glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	const float accumulationClear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const float revealageClear[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, accumulationClear);
+	glClearBufferfv(GL_COLOR, 1, revealageClear);
+
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFunci(0, GL_ONE, GL_ONE);
+	glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+}
+
+void WeightedBlendedOit::End()
+{
+	rmt_ScopedOpenGLSample(CompositeTransparency);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+	glDisable(GL_DEPTH_TEST);
+	glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+	compositeShader.Bind();
+	compositeShader.SetInt("accumulationTexture", 0);
+	compositeShader.SetInt("revealageTexture", 1);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, revealageTexture);
+	glBindVertexArray(emptyVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
+
+	//Back to the state the opaque passes left in Begin
+	glBlendFuncSeparate(previousBlendFunc[0], previousBlendFunc[1], previousBlendFunc[2], previousBlendFunc[3]);
+	glDepthMask(previousDepthMask);
+	if (previousDepthTest)
+		glEnable(GL_DEPTH_TEST);
+	if (!previousBlend)
+		glDisable(GL_BLEND);
+}
@@ -0,0 +1,243 @@
+#include <pbr_material.h>
+#include <engine.h>
+#include <graphics.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <initializer_list>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <gli/gli.hpp>
+#include <Remotery.h>
+#include "file_utility.h"
+#include "stb_image.h"
+
+namespace
+{
+struct ChannelImage
+{
+	std::vector<uint8_t> pixels;
+	int width = 0;
+	int height = 0;
+};
+
+bool LoadChannel(const OrmSource& source, ChannelImage& image)
+{
+	if (source.path.empty())
+		return false;
+	const FileView file = LoadBinaryFile(source.path);
+	int channelNmb = 0;
+	uint8_t* data = file.IsValid() ?
+		stbi_load_from_memory(file.GetData(), (int)file.GetSize(), &image.width, &image.height, &channelNmb, 0) : nullptr;
+	if (data == nullptr)
+	{
+		std::cerr << "[Error] ORM: cannot load " << source.path << "\n";
+		return false;
+	}
+	const int channel = std::min(source.channel, channelNmb - 1);
+	image.pixels.resize((size_t)image.width * image.height);
+	for (size_t i = 0; i < image.pixels.size(); i++)
+	{
+		image.pixels[i] = data[i * channelNmb + channel];
+	}
+	stbi_image_free(data);
+	return true;
+}
+
+//True when the output is missing or a loose source changed after it
+bool IsOutdated(const std::string& outputPath, const OrmSource* sources[3])
+{
+	std::error_code error;
+	const auto outputTime = std::filesystem::last_write_time(outputPath, error);
+	//Without a loose file the cooked map can still come from a pak
+	if (error)
+		return !Engine::GetPtr()->GetFileSystem().Exists(outputPath);
+	for (int i = 0; i < 3; i++)
+	{
+		if (sources[i]->path.empty())
+			continue;
+		const auto sourceTime = std::filesystem::last_write_time(sources[i]->path, error);
+		if (!error && sourceTime > outputTime)
+			return true;
+	}
+	return false;
+}
+
+//Folder name of a texture set, its cooked ORM map is named after it
+std::string GetTextureSetName(const std::string& directory)
+{
+	const std::filesystem::path path(directory);
+	return path.filename().empty() ? path.parent_path().filename().string() : path.filename().string();
+}
+
+bool EndsWith(std::string_view name, std::string_view end)
+{
+	if (name.size() < end.size())
+		return false;
+	return std::equal(end.rbegin(), end.rend(), name.rbegin(), [](char a, char b)
+	{
+		return std::tolower((unsigned char)a) == std::tolower((unsigned char)b);
+	});
+}
+
+//First image of the listing whose name ends with "_<suffix>", in the order of the suffixes. The sets are not named
+//after their folder (Metal/Metal12_col.jpg) and mix the case of the suffixes, so any case matches.
+std::string FindTexture(const std::vector<std::string>& files, std::initializer_list<const char*> suffixes)
+{
+	static const char* const extensions[] = { ".jpg", ".jpeg", ".png", ".tga" };
+	for (const char* suffix : suffixes)
+	{
+		const std::string end = std::string("_") + suffix;
+		for (auto& file : files)
+		{
+			const std::filesystem::path path(file);
+			const std::string extension = path.extension().string();
+			const bool image = std::any_of(std::begin(extensions), std::end(extensions), [&extension](const char* imageExtension)
+			{
+				return extension.size() == std::strlen(imageExtension) && EndsWith(extension, imageExtension);
+			});
+			if (image && EndsWith(path.stem().string(), end))
+				return file;
+		}
+	}
+	return std::string();
+}
+}
+
+bool CookOrmTexture(const OrmSource& occlusion, const OrmSource& roughness, const OrmSource& metallic, const std::string& outputPath)
+{
+	const OrmSource* sources[3] = { &occlusion, &roughness, &metallic };
+	if (!IsOutdated(outputPath, sources))
+		return true;
+	rmt_ScopedCPUSample(CookOrmTexture, 0);
+	const uint8_t neutralValues[3] = { 255, 255, 0 };
+	ChannelImage images[3];
+	bool loaded[3];
+	int width = 0;
+	int height = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		loaded[i] = LoadChannel(*sources[i], images[i]);
+		if (!loaded[i] && !sources[i]->path.empty())
+			return false;
+		//The packed map takes the size of the largest source
+		width = std::max(width, images[i].width);
+		height = std::max(height, images[i].height);
+	}
+	if (width == 0 || height == 0)
+	{
+		std::cerr << "[Error] ORM: no source for " << outputPath << "\n";
+		return false;
+	}
+
+	gli::texture2d texture(gli::FORMAT_RGBA8_UNORM_PACK8, gli::extent2d(width, height));
+	glm::u8vec4* pixels = texture.data<glm::u8vec4>(0, 0, 0);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			glm::u8vec4& pixel = pixels[(size_t)y * width + x];
+			pixel.a = 255;
+			for (int i = 0; i < 3; i++)
+			{
+				const ChannelImage& image = images[i];
+				pixel[i] = !loaded[i] ? neutralValues[i] :
+					image.pixels[(size_t)(y * image.height / height) * image.width + x * image.width / width];
+			}
+		}
+	}
+	//Box filtered mips, an odd size keeps the last row or column out of the average
+	for (size_t level = 1; level < texture.levels(); level++)
+	{
+		const gli::extent2d sourceExtent = texture.extent(level - 1);
+		const gli::extent2d extent = texture.extent(level);
+		const glm::u8vec4* source = texture.data<glm::u8vec4>(0, 0, level - 1);
+		glm::u8vec4* destination = texture.data<glm::u8vec4>(0, 0, level);
+		for (int y = 0; y < extent.y; y++)
+		{
+			for (int x = 0; x < extent.x; x++)
+			{
+				const int x0 = std::min(x * 2, sourceExtent.x - 1);
+				const int x1 = std::min(x * 2 + 1, sourceExtent.x - 1);
+				const int y0 = std::min(y * 2, sourceExtent.y - 1);
+				const int y1 = std::min(y * 2 + 1, sourceExtent.y - 1);
+				const glm::uvec4 sum = glm::uvec4(source[y0 * sourceExtent.x + x0]) + glm::uvec4(source[y0 * sourceExtent.x + x1]) +
+					glm::uvec4(source[y1 * sourceExtent.x + x0]) + glm::uvec4(source[y1 * sourceExtent.x + x1]);
+				destination[y * extent.x + x] = glm::u8vec4((sum + 2u) / 4u);
+			}
+		}
+	}
+	if (!gli::save_dds(texture, outputPath))
+	{
+		std::cerr << "[Error] ORM: cannot write " << outputPath << "\n";
+		return false;
+	}
+	return true;
+}
+
+PbrTextureSet FindPbrTextureSet(const std::string& directory)
+{
+	return FindPbrTextureSet(directory, Engine::GetPtr()->GetFileSystem());
+}
+
+PbrTextureSet FindPbrTextureSet(const std::string& directory, const FileSystem& fileSystem)
+{
+	const std::vector<std::string> files = fileSystem.List(directory);
+	if (files.empty())
+	{
+		std::cerr << "[Error] Texture set: no file in " << directory << "\n";
+	}
+	PbrTextureSet textureSet;
+	textureSet.color = FindTexture(files, { "COLOR", "col", "baseColor", "albedo" });
+	textureSet.normal = FindTexture(files, { "NORM", "nrm", "normal" });
+	textureSet.occlusion = FindTexture(files, { "OCC", "AO" });
+	textureSet.roughness = FindTexture(files, { "ROUGH", "rgh" });
+	textureSet.metallic = FindTexture(files, { "met", "metallic" });
+	textureSet.height = FindTexture(files, { "DISP", "height" });
+	return textureSet;
+}
+
+std::string GetOrmTexturePath(const std::string& directory)
+{
+	const std::filesystem::path path(directory);
+	return (path / (GetTextureSetName(directory) + "_ORM.dds")).generic_string();
+}
+
+unsigned CreateOrmTexture(const std::string& path)
+{
+	const unsigned texture = gliCreateTexture(path.c_str());
+	if (texture == 0)
+		return 0;
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture;
+}
+
+PbrTextures LoadPbrTextureSet(const std::string& directory)
+{
+	rmt_ScopedCPUSample(LoadPbrTextureSet, 0);
+	const PbrTextureSet textureSet = FindPbrTextureSet(directory);
+	PbrTextures textures;
+	if (!textureSet.color.empty())
+		textures.baseColor = stbCreateTexture(textureSet.color.c_str());
+	if (!textureSet.normal.empty())
+		textures.normal = stbCreateTexture(textureSet.normal.c_str());
+	const std::string ormPath = GetOrmTexturePath(directory);
+	if (!textureSet.occlusion.empty() || !textureSet.roughness.empty() || !textureSet.metallic.empty())
+	{
+		if (CookOrmTexture({ textureSet.occlusion }, { textureSet.roughness }, { textureSet.metallic }, ormPath))
+			textures.orm = CreateOrmTexture(ormPath);
+	}
+	else if (Engine::GetPtr()->GetFileSystem().Exists(ormPath))
+	{
+		//Only the cooked map was shipped, e.g. in a pak
+		textures.orm = CreateOrmTexture(ormPath);
+	}
+	return textures;
+}
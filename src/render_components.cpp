@@ -0,0 +1,163 @@
+#include <render_components.h>
+#include <engine.h>
+
+#include <cstring>
+#include <map>
+
+namespace
+{
+const char* const diffuseSamplers[] = { "material.texture_diffuse1", "material.texture_diffuse2", "material.texture_diffuse3", "material.texture_diffuse4" };
+const char* const specularSamplers[] = { "material.texture_specular1", "material.texture_specular2", "material.texture_specular3", "material.texture_specular4" };
+const char* const baseColorSampler = "pbrMaterial.baseColorMap";
+const char* const normalSampler = "pbrMaterial.normalMap";
+const char* const ormSampler = "pbrMaterial.ormMap";
+
+uint32_t GetFloatBits(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+}
+
+MeshComponent MakeMeshComponent(Mesh& mesh)
+{
+	MeshComponent component;
+	component.vao = mesh.GetVAO();
+	component.elementNmb = (unsigned)mesh.indices.size();
+	component.indexed = true;
+	return component;
+}
+
+MaterialComponent MakeMaterialComponent(Shader& shader, const std::vector<Texture>& textures)
+{
+	MaterialComponent material;
+	material.shader = &shader;
+	int diffuseNmb = 0;
+	int specularNmb = 0;
+	for (auto& texture : textures)
+	{
+		if (material.textureNmb == MaterialComponent::maxTextureNmb)
+			break;
+		const char* samplerName = nullptr;
+		if (texture.type == "texture_diffuse")
+			samplerName = diffuseSamplers[diffuseNmb++];
+		else if (texture.type == "texture_specular")
+			samplerName = specularSamplers[specularNmb++];
+		else if (texture.type == "texture_normal")
+			samplerName = "material.texture_normal";
+		else if (texture.type == "texture_height")
+			samplerName = "material.texture_height";
+		if (samplerName == nullptr)
+			continue;
+		material.textures[material.textureNmb] = texture.id;
+		material.samplerNames[material.textureNmb] = samplerName;
+		material.textureNmb++;
+	}
+	material.sortKey = GetMaterialSortKey(material);
+	return material;
+}
+
+MaterialComponent MakePbrMaterialComponent(Shader& shader, const std::vector<Texture>& textures, const PbrFactors& factors)
+{
+	MaterialComponent material;
+	material.shader = &shader;
+	material.pbr = true;
+	material.pbrFactors = factors;
+	for (auto& texture : textures)
+	{
+		const char* samplerName = nullptr;
+		if (texture.type == "texture_diffuse")
+			samplerName = baseColorSampler;
+		else if (texture.type == "texture_normal")
+			samplerName = normalSampler;
+		else if (texture.type == "texture_orm")
+			samplerName = ormSampler;
+		bool alreadyBound = false;
+		for (int i = 0; i < material.textureNmb; i++)
+			alreadyBound |= material.samplerNames[i] == samplerName;
+		if (samplerName == nullptr || alreadyBound)
+			continue;
+		material.textures[material.textureNmb] = texture.id;
+		material.samplerNames[material.textureNmb] = samplerName;
+		material.textureNmb++;
+	}
+	material.sortKey = GetMaterialSortKey(material);
+	return material;
+}
+
+unsigned GetMaterialSortKey(const MaterialComponent& material)
+{
+	//Components are created on the main thread at load time, the identifiers are handed out in order
+	static std::map<std::vector<uint32_t>, unsigned> sortKeys;
+	std::vector<uint32_t> content = { (uint32_t)material.shader->GetProgram(), (uint32_t)material.pbr };
+	for (int i = 0; i < material.textureNmb; i++)
+	{
+		content.push_back(material.textures[i]);
+	}
+	if (material.pbr)
+	{
+		const PbrFactors& factors = material.pbrFactors;
+		for (int i = 0; i < 4; i++)
+			content.push_back(GetFloatBits(factors.baseColor[i]));
+		content.push_back(GetFloatBits(factors.metallic));
+		content.push_back(GetFloatBits(factors.roughness));
+		content.push_back(GetFloatBits(factors.normalScale));
+	}
+	return sortKeys.emplace(std::move(content), (unsigned)sortKeys.size() + 1).first->second;
+}
+
+void DrawMeshComponent(const MeshComponent& mesh)
+{
+	glBindVertexArray(mesh.vao);
+	if (mesh.indexed)
+		glDrawElements(GL_TRIANGLES, mesh.elementNmb, GL_UNSIGNED_INT, 0);
+	else
+		glDrawArrays(GL_TRIANGLES, 0, mesh.elementNmb);
+	glBindVertexArray(0);
+}
+
+void DrawMeshComponentIndirect(const MeshComponent& mesh, unsigned indirectBuffer, size_t commandOffset)
+{
+	glBindVertexArray(mesh.vao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+	if (mesh.indexed)
+		glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)commandOffset);
+	else
+		glDrawArraysIndirect(GL_TRIANGLES, (void*)commandOffset);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+void BindMaterialComponent(const MaterialComponent& material)
+{
+	if (material.pbr)
+	{
+		const PbrFactors& factors = material.pbrFactors;
+		bool hasMaps[3] = {};
+		for (int i = 0; i < material.textureNmb; i++)
+		{
+			hasMaps[0] |= material.samplerNames[i] == baseColorSampler;
+			hasMaps[1] |= material.samplerNames[i] == normalSampler;
+			hasMaps[2] |= material.samplerNames[i] == ormSampler;
+		}
+		material.shader->SetVec4("pbrMaterial.baseColorFactor", factors.baseColor);
+		material.shader->SetFloat("pbrMaterial.metallicFactor", factors.metallic);
+		material.shader->SetFloat("pbrMaterial.roughnessFactor", factors.roughness);
+		material.shader->SetFloat("pbrMaterial.normalScale", factors.normalScale);
+		material.shader->SetBool("pbrMaterial.hasBaseColorMap", hasMaps[0]);
+		material.shader->SetBool("pbrMaterial.hasNormalMap", hasMaps[1]);
+		material.shader->SetBool("pbrMaterial.hasOrmMap", hasMaps[2]);
+	}
+	else
+	{
+		material.shader->SetFloat("material.shininess", 32);
+	}
+	for (int i = 0; i < material.textureNmb; i++)
+	{
+		material.shader->SetInt(material.samplerNames[i], i);
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, material.textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
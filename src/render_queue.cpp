@@ -0,0 +1,191 @@
+#include <render_queue.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <cmath>
+#include <Remotery.h>
+
+void RenderQueue::Init()
+{
+	depthShader.CompileSource(
+		"shaders/engine/depth.vert",
+		"shaders/engine/depth.frag");
+	oit.Init();
+}
+
+void RenderQueue::Destroy()
+{
+	packets.clear();
+	oit.Destroy();
+}
+
+void RenderQueue::Begin(const glm::mat4& view, const glm::mat4& projection, float near, float far)
+{
+	this->view = view;
+	this->projection = projection;
+	near = std::max(near, 1e-3f);
+	far = std::max(far, near * 2.0f);
+	logNear = std::log(near);
+	logRange = std::log(far) - logNear;
+	packets.clear();
+}
+
+void RenderQueue::Submit(const DrawPacket& packet)
+{
+	packets.push_back(packet);
+}
+
+uint64_t RenderQueue::ComputeKey(RenderPass pass, uint16_t depthBucket, unsigned program, unsigned material, unsigned mesh)
+{
+	return (uint64_t(pass) & 0xFu) << 60 |
+		uint64_t(depthBucket) << 44 |
+		(uint64_t(program) & 0xFFFu) << 32 |
+		(uint64_t(material) & 0xFFFFu) << 16 |
+		(uint64_t(mesh) & 0xFFFFu);
+}
+
+uint16_t RenderQueue::ComputeDepthBucket(const glm::vec3& worldCenter) const
+{
+	//Logarithmic buckets keep the resolution where the overdraw happens, close to the camera
+	const float viewDepth = std::max(-(view * glm::vec4(worldCenter, 1.0f)).z, 1e-4f);
+	const float normalizedDepth = glm::clamp((std::log(viewDepth) - logNear) / logRange, 0.0f, 1.0f);
+	return (uint16_t)(normalizedDepth * 65535.0f);
+}
+
+void RenderQueue::SortKeys()
+{
+	const size_t packetNmb = packets.size();
+	order.resize(packetNmb);
+	tmpOrder.resize(packetNmb);
+	for (uint32_t i = 0; i < packetNmb; i++)
+		order[i] = i;
+
+	//LSD radix sort on bytes, a byte identical for every key is skipped
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[256] = {};
+		for (auto key : keys)
+			histogram[(key >> shift) & 0xFF]++;
+		if (histogram[(keys[0] >> shift) & 0xFF] == packetNmb)
+			continue;
+		size_t offset = 0;
+		for (auto& count : histogram)
+		{
+			const size_t tmp = count;
+			count = offset;
+			offset += tmp;
+		}
+		for (auto index : order)
+			tmpOrder[histogram[(keys[index] >> shift) & 0xFF]++] = index;
+		std::swap(order, tmpOrder);
+	}
+}
+
+void RenderQueue::Flush()
+{
+	rmt_ScopedCPUSample(FlushRenderQueue, 0);
+	drawCallNmb = 0;
+	programSwitchNmb = 0;
+	transparentDrawNmb = 0;
+	motionDrawNmb = 0;
+	if (packets.empty())
+		return;
+
+	keys.resize(packets.size());
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		const auto& packet = packets[i];
+		const bool transparent = packet.pass == RenderPass::TRANSPARENT_PASS;
+		keys[i] = ComputeKey(
+			packet.pass,
+			transparent ? 0 : ComputeDepthBucket(packet.worldCenter),
+			packet.shader->GetProgram(),
+			packet.material,
+			packet.mesh);
+	}
+	SortKeys();
+
+	glEnable(GL_DEPTH_TEST);
+	if (depthPrepass)
+	{
+		rmt_ScopedOpenGLSample(DepthPrepass);
+		Shader* currentDepthShader = nullptr;
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		//The prepass depth is pushed back slightly so the color pass passes with LEQUAL despite
+		//the different vertex shaders
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(1.0f, 1.0f);
+		for (auto index : order)
+		{
+			const auto& packet = packets[index];
+			if (packet.pass != RenderPass::OPAQUE_PASS || !packet.drawGeometry)
+				continue;
+			Shader* packetDepthShader = packet.depthShader != nullptr ? packet.depthShader : &depthShader;
+			if (packetDepthShader != currentDepthShader)
+			{
+				currentDepthShader = packetDepthShader;
+				currentDepthShader->Bind();
+				currentDepthShader->SetMat4("lightSpaceMatrix", projection * view);
+			}
+			currentDepthShader->SetMat4("model", packet.modelMatrix);
+			packet.drawGeometry();
+			drawCallNmb++;
+		}
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthFunc(GL_LEQUAL);
+	}
+
+	//The transparent draws come last in the sorted order
+	Shader* currentShader = nullptr;
+	for (auto index : order)
+	{
+		const auto& packet = packets[index];
+		if (packet.pass == RenderPass::TRANSPARENT_PASS && transparentDrawNmb++ == 0)
+		{
+			oit.Begin();
+		}
+		if (packet.shader != currentShader)
+		{
+			currentShader = packet.shader;
+			currentShader->Bind();
+			programSwitchNmb++;
+		}
+		currentShader->SetMat4("model", packet.modelMatrix);
+		packet.draw();
+		drawCallNmb++;
+	}
+	if (transparentDrawNmb > 0)
+	{
+		oit.End();
+	}
+	glDepthFunc(GL_LESS);
+	DrawMotionVectors();
+	packets.clear();
+}
+
+void RenderQueue::DrawMotionVectors()
+{
+	auto& temporalAa = Engine::GetPtr()->GetTemporalAa();
+	if (!temporalAa.IsActive())
+		return;
+	Shader* motionShader = nullptr;
+	for (const auto& packet : packets)
+	{
+		//Only what moved needs its own vectors, the TAA rebuilds the camera motion of the rest from the depth.
+		//motion.vert places the vertices with the model matrix, the packets with their own depth program are left out.
+		if (packet.previousModelMatrix == nullptr || *packet.previousModelMatrix == packet.modelMatrix ||
+			packet.pass != RenderPass::OPAQUE_PASS || !packet.drawGeometry || packet.depthShader != nullptr)
+			continue;
+		if (motionShader == nullptr)
+			motionShader = &temporalAa.BeginMotionVectors();
+		motionShader->SetMat4("model", packet.modelMatrix);
+		motionShader->SetMat4("previousModel", *packet.previousModelMatrix);
+		packet.drawGeometry();
+		motionDrawNmb++;
+	}
+	if (motionShader != nullptr)
+	{
+		temporalAa.EndMotionVectors();
+	}
+}
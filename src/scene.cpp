@@ -1,26 +1,36 @@
 #include <scene.h>
 
+#include <algorithm>
 #include "file_utility.h"
 #include <Remotery.h>
-#include <glm/gtc/quaternion.inl>
-#include <glm/detail/type_quat.hpp>
-#include <json_utility.h>
+#include <scene_binary.h>
+#include <glm/gtc/type_ptr.hpp>
+#include "imgui.h"
+#include <iostream>
 
 
 
-void Scene::Init()
+bool Scene::Init(Shader& materialShader, Shader& pbrShader)
 {
-    const auto sceneJsonPtr = LoadJson(jsonPath);
-    const auto& sceneJson = *sceneJsonPtr;
-	modelNmb = sceneJson["models"].size();
+	rmt_ScopedCPUSample(SceneInit, 0);
+	//The JSON scene is compiled once, then the records are read straight from the mapped file
+	const std::string binaryPath = GetFilenameExtension(jsonPath) == ".scene" ? jsonPath : CompileScene(jsonPath);
+	SceneBinaryFile sceneFile;
+	if (binaryPath.empty() || !sceneFile.Open(binaryPath))
+	{
+		std::cerr << "[Error] Scene: cannot load " << jsonPath << "\n";
+		return false;
+	}
+	const SceneBinaryHeader& header = sceneFile.GetHeader();
+	const SceneBinaryModel* sceneModels = sceneFile.GetModels();
+	modelNmb = header.modelNmb;
 	models.resize(modelNmb);
-	positions.resize(modelNmb);
-	scales.resize(modelNmb);
-	rotations.resize(modelNmb);
-	int i = 0;
-	for (auto& model : sceneJson["models"])
+	modelNodes.resize(modelNmb);
+	transforms.Clear();
+	for (size_t i = 0; i < modelNmb; i++)
 	{
-		const std::string modelName = model["model"];
+		const SceneBinaryModel& model = sceneModels[i];
+		const std::string modelName = sceneFile.GetString(model.modelName);
 		if (modelMap.find(modelName) == modelMap.end())
 		{
 			//Load model
@@ -28,69 +38,149 @@ void Scene::Init()
 			modelMap[modelName].Init(modelName.c_str());
 		}
 		models[i] = &modelMap[modelName];
-		positions[i] = ConvertVec3FromJson(model["position"]);
-		scales[i] = ConvertVec3FromJson(model["scale"]);
-		rotations[i] = ConvertVec3FromJson(model["angles"]);
-		i++;
-	}
-	json lightsJson = sceneJson["lights"];
-	ambient = lightsJson["ambient"];
-	for(auto& pointLightJson : lightsJson["point_lights"])
-	{
-		PointLight pointLight;
-		pointLight.position = ConvertVec3FromJson(pointLightJson["position"]);
-		pointLight.intensity = pointLightJson["intensity"];
-		pointLight.enable = pointLightJson["enable"];
-		pointLight.distance = pointLightJson["distance"];
-		pointLights.push_back(pointLight);
-	}
-	for (auto& spotLightJson : lightsJson["spot_lights"])
-	{
-		SpotLight spotLight;
-		spotLight.position = ConvertVec3FromJson(spotLightJson["position"]);
-		spotLight.direction = ConvertVec3FromJson(spotLightJson["direction"]);
-		spotLight.cutOff = spotLightJson["cutOff"];
-		spotLight.outerCutOff = spotLightJson["outerCutOff"];
-		spotLight.intensity = spotLightJson["intensity"];
-		spotLights.push_back(spotLight);
-	}
-	{
-		json directionLightJson = lightsJson["direction_light"];
-		DirectionLight directionLight;
-		directionLight.enable = directionLightJson["enable"];
-		if (directionLight.enable)
+		modelNodes[i] = transforms.AddNode(
+			model.parent < 0 ? TransformHierarchy::noParent : modelNodes[model.parent],
+			glm::make_vec3(model.position),
+			glm::quat(glm::make_vec3(model.angles)),
+			glm::make_vec3(model.scale));
+	}
+	transforms.Update();
+	occlusionCuller.Clear();
+	occlusionCuller.Init();
+	worldBounds.resize(modelNmb);
+	for (size_t modelIndex = 0; modelIndex < modelNmb; modelIndex++)
+	{
+		const glm::mat4& modelMatrix = GetModelMatrix(modelIndex);
+		worldBounds[modelIndex] = TransformBoundingBox(models[modelIndex]->bounds, modelMatrix);
+		RegisterOccludee(worldBounds[modelIndex]);
+		if (sceneModels[modelIndex].flags & SceneBinaryModel::occluderFlag)
+		{
+			std::vector<glm::vec3> triangles;
+			for (auto& mesh : models[modelIndex]->meshes)
+			{
+				for (auto index : mesh.indices)
+				{
+					triangles.push_back(glm::vec3(modelMatrix * glm::vec4(mesh.vertices[index].Position, 1.0f)));
+				}
+			}
+			RegisterOccluder(triangles);
+		}
+	}
+	UpdateSceneBounds();
+
+	registry.Clear();
+	for (size_t modelIndex = 0; modelIndex < modelNmb; modelIndex++)
+	{
+		std::vector<Texture> textureSet;
+		if (sceneModels[modelIndex].material != SceneBinaryModel::noMaterial)
+		{
+			const std::string directory = sceneFile.GetString(sceneModels[modelIndex].material);
+			if (textureSets.find(directory) == textureSets.end())
+				textureSets[directory] = LoadPbrTextureSet(directory);
+			const PbrTextures& textures = textureSets[directory];
+			textureSet.push_back({ textures.baseColor, "texture_diffuse", directory });
+			textureSet.push_back({ textures.normal, "texture_normal", directory });
+			textureSet.push_back({ textures.orm, "texture_orm", directory });
+			textureSet.erase(std::remove_if(textureSet.begin(), textureSet.end(), [](const Texture& texture) { return texture.id == 0; }), textureSet.end());
+		}
+		for (auto& mesh : models[modelIndex]->meshes)
 		{
-			directionLight.direction = ConvertVec3FromJson(directionLightJson["direction"]);
-			directionLight.intensity = directionLightJson["intensity"];
-			directionLight.position = ConvertVec3FromJson(directionLightJson["position"]);
+			const Entity entity = registry.Create();
+			registry.Add(entity, TransformComponent{ GetModelMatrix(modelIndex), modelNodes[modelIndex] });
+			registry.Add(entity, BoundsComponent{ worldBounds[modelIndex], (int)modelIndex });
+			registry.Add(entity, MakeMeshComponent(mesh));
+			if (sceneModels[modelIndex].material != SceneBinaryModel::noMaterial)
+				registry.Add(entity, MakePbrMaterialComponent(pbrShader, textureSet, PbrFactors()));
+			else if (mesh.pbr)
+				registry.Add(entity, MakePbrMaterialComponent(pbrShader, mesh.textures, mesh.pbrFactors));
+			else
+				registry.Add(entity, MakeMaterialComponent(materialShader, mesh.textures));
+			registry.Add(entity, VisibilityComponent());
 		}
-		this->directionLight = directionLight;
+	}
 
+	ambient = header.ambient;
+	pointLights.resize(header.pointLightNmb);
+	for (uint32_t i = 0; i < header.pointLightNmb; i++)
+	{
+		const SceneBinaryPointLight& pointLightRecord = sceneFile.GetPointLights()[i];
+		PointLight& pointLight = pointLights[i];
+		pointLight.position = glm::make_vec3(pointLightRecord.position);
+		pointLight.intensity = pointLightRecord.intensity;
+		pointLight.enable = pointLightRecord.enable != 0;
+		pointLight.distance = pointLightRecord.distance;
+	}
+	spotLights.resize(header.spotLightNmb);
+	for (uint32_t i = 0; i < header.spotLightNmb; i++)
+	{
+		const SceneBinarySpotLight& spotLightRecord = sceneFile.GetSpotLights()[i];
+		SpotLight& spotLight = spotLights[i];
+		spotLight.position = glm::make_vec3(spotLightRecord.position);
+		spotLight.direction = glm::make_vec3(spotLightRecord.direction);
+		spotLight.cutOff = spotLightRecord.cutOff;
+		spotLight.outerCutOff = spotLightRecord.outerCutOff;
+		spotLight.intensity = spotLightRecord.intensity;
+		spotLight.enable = spotLightRecord.enable != 0;
+	}
+	directionLight = DirectionLight();
+	directionLight.enable = header.directionLightEnable != 0;
+	if (directionLight.enable)
+	{
+		directionLight.direction = glm::make_vec3(header.directionLightDirection);
+		directionLight.intensity = header.directionLightIntensity;
+		directionLight.position = glm::make_vec3(header.directionLightPosition);
 	}
+	return true;
 }
 
-void Scene::BindLights(Shader& shader)
+bool Scene::Update()
 {
-	int i = 0;
-	for(auto& pointLight : pointLights)
+	if (transforms.Update() == 0)
+		return false;
+	//Only the moved models get new bounds, static ones keep theirs
+	for (size_t modelIndex = 0; modelIndex < modelNmb; modelIndex++)
 	{
-		if(pointLight.enable)
-		{
-			pointLight.Bind(shader, i);
-			i++;
-		}
+		if (!transforms.WasUpdated(modelNodes[modelIndex]))
+			continue;
+		worldBounds[modelIndex] = TransformBoundingBox(models[modelIndex]->bounds, GetModelMatrix(modelIndex));
+		occlusionCuller.SetOccludeeBox((int)modelIndex, worldBounds[modelIndex]);
 	}
-	shader.SetInt("pointLightsNmb", i);
-	i = 0;
-	for (auto& spotLight : spotLights)
+	registry.ParallelEach<TransformComponent, BoundsComponent>(Engine::GetPtr()->GetJobSystem(), 256,
+		[this](Entity, TransformComponent& transform, BoundsComponent& bounds)
 	{
-		if (spotLight.enable)
-		{
-			spotLight.Bind(shader, i);
-			i++;
-		}
+		if (!transforms.WasUpdated(transform.node))
+			return;
+		transform.modelMatrix = transforms.GetWorldMatrix(transform.node);
+		bounds.worldBounds = worldBounds[bounds.cullIndex];
+	});
+	UpdateSceneBounds();
+	return true;
+}
+
+void Scene::UpdateSceneBounds()
+{
+	sceneBounds.min = glm::vec3(std::numeric_limits<float>::max());
+	sceneBounds.max = glm::vec3(-std::numeric_limits<float>::max());
+	for (auto& bounds : worldBounds)
+	{
+		sceneBounds.min = glm::min(sceneBounds.min, bounds.min);
+		sceneBounds.max = glm::max(sceneBounds.max, bounds.max);
 	}
-	shader.SetInt("spotLightsNmb", i);
+}
+
+int Scene::RegisterOccluder(const std::vector<glm::vec3>& triangles)
+{
+	return occlusionCuller.RegisterOccluder(triangles);
+}
+
+int Scene::RegisterOccludee(const BoundingBox& worldBox)
+{
+	return occlusionCuller.RegisterOccludee(worldBox);
+}
+
+void Scene::BindLights(Shader& shader)
+{
+	//Point and spot lights go through the light clusters
 	shader.SetBool("directionalLightEnable", directionLight.enable);
 	if(directionLight.enable)
 	{
@@ -102,16 +192,30 @@ void Scene::BindLights(Shader& shader)
 void SceneDrawingProgram::Init()
 {
 	programName = "Scene Drawing Program";
-	scene.Init();
 	modelShader.CompileSource(
 		"shaders/engine/model.vert",
 		"shaders/engine/model.frag");
 	shaders.push_back(&modelShader);
+	pbrShader.CompileSource(
+		"shaders/engine/model.vert",
+		"shaders/engine/pbr.frag");
+	shaders.push_back(&pbrShader);
+	sceneLoaded = scene.Init(modelShader, pbrShader);
+	if (!sceneLoaded)
+		return;
+	hiZCuller.Init();
+	hiZCuller.SetBoxes(scene.GetWorldBounds());
+	renderQueue.Init();
+	lightCluster.Init();
+	shadowSystem.Init();
+	ibl.Init("data/skybox/ridgecrest_road/Ridgecrest_Road_Env.hdr");
 }
 void SceneDrawingProgram::Draw()
 {
 	rmt_ScopedOpenGLSample(DrawScene);
 	rmt_ScopedCPUSample(DrawSceneCPU, 0);
+	if (!sceneLoaded)
+		return;
 
 	ProcessInput();
 
@@ -125,24 +229,160 @@ void SceneDrawingProgram::Draw()
 		0.1f, 
 		100.0f);
 
-	modelShader.Bind();
-	scene.BindLights(modelShader);
-	modelShader.SetMat4("projection", projection);
-	modelShader.SetMat4("view", camera.GetViewMatrix());
-	for (auto i = 0u; i < scene.GetModelNmb(); i++)
+	const glm::mat4 view = camera.GetViewMatrix();
+	//The culling keeps the stable projection, the draws use the TAA jittered one
+	const glm::mat4 viewProjection = projection * view;
+	projection = engine->JitterProjection(view, projection);
+	if (scene.Update())
+	{
+		hiZCuller.SetBoxes(scene.GetWorldBounds());
+	}
+	auto& occlusionCuller = scene.GetOcclusionCuller();
+	occlusionCuller.Update(viewProjection);
+	//Visibility tested against the depth of the previous frame, read back a few frames later
+	hiZCuller.CullFirstPass();
+
+	lightCluster.Update(scene.GetPointLights(), scene.GetSpotLights(), view, projection, 0.1f, 100.0f);
+	if (scene.GetDirectionLight().enable)
 	{
-		glm::mat4 modelMatrix(1.0f);
-		modelMatrix = glm::translate(modelMatrix, scene.GetPositions()[i]);
-		modelMatrix = glm::scale(modelMatrix, scene.GetScales()[i]);
-		auto quaternion = glm::quat(scene.GetRotations()[i]);
-		modelMatrix = glm::mat4_cast(quaternion)*modelMatrix;
-		modelShader.SetMat4("model", modelMatrix);
-		scene.GetModels()[i]->Draw(modelShader);
+		shadowSystem.Update(
+			view,
+			glm::radians(camera.Zoom),
+			(float)config.screenWidth / (float)config.screenHeight,
+			0.1f,
+			scene.GetDirectionLight().direction,
+			scene.GetSceneBounds());
+		shadowSystem.Render(scene.GetWorldBounds(), [this](size_t index, Shader& shader)
+		{
+			shader.SetMat4("model", scene.GetModelMatrix(index));
+			for (auto& mesh : scene.GetModels()[index]->meshes)
+				mesh.DrawGeometry();
+		});
+	}
+
+	for (Shader* shader : { &modelShader, &pbrShader })
+	{
+		shader->Bind();
+		scene.BindLights(*shader);
+		lightCluster.Bind(*shader);
+		shadowSystem.Bind(*shader);
+		ibl.Bind(*shader);
+		shader->SetMat4("projection", projection);
+		shader->SetMat4("view", view);
+		shader->SetVec3("viewPos", camera.Position);
 	}
+	renderQueue.Begin(view, projection, 0.1f, 100.0f);
+	CullEntities();
+	const size_t drawnNmb = SubmitVisibleEntities(false);
+	renderQueue.Flush();
+	size_t drawCallNmb = renderQueue.GetDrawCallNmb();
+	//The first pass rejections are tested again against the depth just drawn, in the same frame. Their draws read
+	//the result from indirect commands so the CPU never waits for it.
+	hiZCuller.BuildPyramid(viewProjection);
+	const size_t lateNmb = SubmitVisibleEntities(true);
+	hiZCuller.CullSecondPass();
+	renderQueue.Flush();
+	drawCallNmb += renderQueue.GetDrawCallNmb();
+	//The next first pass tests against the complete depth, otherwise what the late draws revealed is culled again
+	if (hiZCuller.GetLateDrawNmb() > 0)
+	{
+		hiZCuller.BuildPyramid(viewProjection);
+	}
+
+	engine->SetFrameCounter("CPU occlusion culled", occlusionCuller.GetCulledNmb());
+	engine->SetFrameCounter("Hi-Z culled", hiZCuller.GetCulledNmb());
+	engine->SetFrameCounter("Hi-Z latency", (size_t)hiZCuller.GetLatency());
+	engine->SetFrameCounter("Hi-Z late draws", lateNmb);
+	engine->SetFrameCounter("Visible meshes", drawnNmb);
+	engine->SetFrameCounter("Transforms updated", scene.GetTransforms().GetUpdatedNmb());
+	engine->SetFrameCounter("Draw calls", drawCallNmb);
+	engine->SetFrameCounter("Point lights", lightCluster.GetLightNmb());
+	engine->SetFrameCounter("Spot lights", lightCluster.GetSpotLightNmb());
+	engine->SetFrameCounter("Cluster light indices", lightCluster.GetLightIndexNmb());
+	engine->SetFrameCounter("Shadow casters", shadowSystem.GetCasterDrawNmb());
+	engine->SetFrameCounter("Shadow cascade draws", shadowSystem.GetCascadeDrawNmb());
 }
+
+void SceneDrawingProgram::CullEntities()
+{
+	rmt_ScopedCPUSample(CullEntities, 0);
+	auto& occlusionCuller = scene.GetOcclusionCuller();
+	scene.GetRegistry().ParallelEach<VisibilityComponent, BoundsComponent>(Engine::GetPtr()->GetJobSystem(), 256,
+		[this, &occlusionCuller](Entity, VisibilityComponent& visibility, const BoundsComponent& bounds)
+	{
+		const bool occluderVisible = occlusionCuller.IsVisible(bounds.cullIndex);
+		const bool hiZVisible = hiZCuller.IsVisibleFirstPass(bounds.cullIndex);
+		visibility.visible = occluderVisible && hiZVisible;
+		visibility.late = occluderVisible && !hiZVisible;
+	});
+}
+
+size_t SceneDrawingProgram::SubmitVisibleEntities(bool late)
+{
+	rmt_ScopedCPUSample(SubmitEntities, 0);
+	size_t submittedNmb = 0;
+	scene.GetRegistry().Each<VisibilityComponent, TransformComponent, BoundsComponent, MeshComponent, MaterialComponent>(
+		[this, late, &submittedNmb](Entity, const VisibilityComponent& visibility, const TransformComponent& transform,
+			const BoundsComponent& bounds, const MeshComponent& mesh, const MaterialComponent& material)
+	{
+		if (late ? !visibility.late : !visibility.visible)
+			return;
+		DrawPacket packet;
+		packet.pass = material.transparent ? RenderPass::TRANSPARENT_PASS : RenderPass::OPAQUE_PASS;
+		packet.shader = material.shader;
+		packet.material = material.sortKey;
+		packet.mesh = mesh.vao;
+		packet.modelMatrix = transform.modelMatrix;
+		packet.previousModelMatrix = &scene.GetTransforms().GetPreviousWorldMatrix(transform.node);
+		packet.worldCenter = (bounds.worldBounds.min + bounds.worldBounds.max) * 0.5f;
+		if (late)
+		{
+			const unsigned commandBuffer = hiZCuller.GetLateCommandBuffer();
+			const size_t commandOffset = hiZCuller.AddLateDraw(bounds.cullIndex, mesh.elementNmb);
+			packet.draw = [&mesh, &material, commandBuffer, commandOffset]()
+			{
+				BindMaterialComponent(material);
+				DrawMeshComponentIndirect(mesh, commandBuffer, commandOffset);
+			};
+			packet.drawGeometry = [&mesh, commandBuffer, commandOffset]() { DrawMeshComponentIndirect(mesh, commandBuffer, commandOffset); };
+		}
+		else
+		{
+			packet.draw = [&mesh, &material]()
+			{
+				BindMaterialComponent(material);
+				DrawMeshComponent(mesh);
+			};
+			packet.drawGeometry = [&mesh]() { DrawMeshComponent(mesh); };
+		}
+		renderQueue.Submit(packet);
+		submittedNmb++;
+	});
+	return submittedNmb;
+}
+
 void SceneDrawingProgram::Destroy()
 {
-	
+	if (!sceneLoaded)
+		return;
+	hiZCuller.Destroy();
+	renderQueue.Destroy();
+	lightCluster.Destroy();
+	shadowSystem.Destroy();
+	ibl.Destroy();
+}
+
+void SceneDrawingProgram::UpdateUi()
+{
+	auto& occlusionCuller = scene.GetOcclusionCuller();
+	ImGui::Separator();
+	ImGui::Checkbox("Occlusion culling", &occlusionCuller.GetEnable());
+	ImGui::Text("Occlusion culled: %zu / %zu", occlusionCuller.GetCulledNmb(), occlusionCuller.GetOccludeeNmb());
+	ImGui::Checkbox("Hi-Z culling", &hiZCuller.GetEnable());
+	ImGui::Checkbox("Depth prepass", &renderQueue.GetDepthPrepass());
+	ImGui::Checkbox("Shadows", &shadowSystem.GetEnable());
+	ImGui::SliderFloat("Shadow distance", &shadowSystem.GetShadowDistance(), 5.0f, 100.0f);
+	ImGui::Text("Hi-Z culled: %zu, %d frames late, %zu late draws", hiZCuller.GetCulledNmb(), hiZCuller.GetLatency(), hiZCuller.GetLateDrawNmb());
 }
 
 void SceneDrawingProgram::ProcessInput()
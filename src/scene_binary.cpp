@@ -0,0 +1,335 @@
+#include <scene_binary.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <json_utility.h>
+#include <Remotery.h>
+
+namespace
+{
+const size_t sceneBinaryAlignment = 16;
+
+uint64_t AlignOffset(uint64_t offset)
+{
+	return (offset + sceneBinaryAlignment - 1) & ~(uint64_t)(sceneBinaryAlignment - 1);
+}
+
+template<typename T>
+void WriteArray(std::ofstream& file, uint64_t offset, const std::vector<T>& records)
+{
+	file.seekp(offset);
+	file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+}
+
+template<typename T>
+bool MapArray(const uint8_t* data, size_t size, uint64_t offset, uint32_t count, const T*& records)
+{
+	if (offset % sceneBinaryAlignment != 0 || offset > size || (size - offset) / sizeof(T) < count)
+		return false;
+	records = reinterpret_cast<const T*>(data + offset);
+	return true;
+}
+
+//Fills the records while parsing, the scene is never held as a JSON document
+class SceneJsonReader : public JsonSaxReader
+{
+public:
+	SceneBinaryHeader header;
+	std::string stringTable;
+	std::vector<SceneBinaryModel> models;
+	std::vector<SceneBinaryPointLight> pointLights;
+	std::vector<SceneBinarySpotLight> spotLights;
+protected:
+	bool OnStartObject() override
+	{
+		if (Matches({ "models", "[]" }) || Matches({ "lights", "point_lights", "[]" }) ||
+			Matches({ "lights", "spot_lights", "[]" }) || Matches({ "lights", "direction_light" }))
+		{
+			fields = 0;
+		}
+		if (Matches({ "models", "[]" }))
+		{
+			SceneBinaryModel model = {};
+			model.scale[0] = model.scale[1] = model.scale[2] = 1.0f;
+			model.parent = -1;
+			model.material = SceneBinaryModel::noMaterial;
+			models.push_back(model);
+		}
+		else if (Matches({ "lights", "point_lights", "[]" }))
+		{
+			pointLights.push_back({});
+		}
+		else if (Matches({ "lights", "spot_lights", "[]" }))
+		{
+			spotLights.push_back({});
+		}
+		return true;
+	}
+	bool OnEndObject() override
+	{
+		if (Matches({ "models", "[]" }))
+			return RequireFields(modelField | positionField, "model and position");
+		if (Matches({ "lights", "point_lights", "[]" }))
+			return RequireFields(positionField | intensityField | distanceField | enableField, "position, intensity, distance and enable");
+		if (Matches({ "lights", "spot_lights", "[]" }))
+			return RequireFields(positionField | directionField | cutOffField | outerCutOffField | intensityField,
+				"position, direction, cutOff, outerCutOff and intensity");
+		if (Matches({ "lights", "direction_light" }))
+		{
+			if (!RequireFields(enableField, "enable"))
+				return false;
+			//A disabled light may leave out the rest
+			if (header.directionLightEnable)
+				return RequireFields(directionField | positionField | intensityField, "direction, position and intensity");
+		}
+		return true;
+	}
+	bool OnString(const std::string& value) override
+	{
+		if (Matches({ "models", "[]", "model" }))
+		{
+			fields |= modelField;
+			models.back().modelName = AddString(value);
+		}
+		else if (Matches({ "models", "[]", "material" }))
+			models.back().material = AddString(value);
+		return true;
+	}
+	bool OnBoolean(bool value) override
+	{
+		if (Matches({ "models", "[]", "occluder" }))
+		{
+			if (value)
+				models.back().flags |= SceneBinaryModel::occluderFlag;
+		}
+		else if (Matches({ "lights", "point_lights", "[]", "enable" }))
+		{
+			fields |= enableField;
+			pointLights.back().enable = value;
+		}
+		else if (Matches({ "lights", "spot_lights", "[]", "enable" }))
+			spotLights.back().enable = value;
+		else if (Matches({ "lights", "direction_light", "enable" }))
+		{
+			fields |= enableField;
+			header.directionLightEnable = value;
+		}
+		return true;
+	}
+	bool OnNumber(double value) override
+	{
+		const float number = (float)value;
+		if (Matches({ "models", "[]", "position", "[]" }))
+			return SetComponent(models.back().position, number, positionField);
+		if (Matches({ "models", "[]", "angles", "[]" }))
+			return SetComponent(models.back().angles, number);
+		if (Matches({ "models", "[]", "scale", "[]" }))
+			return SetComponent(models.back().scale, number);
+		if (Matches({ "models", "[]", "parent" }))
+		{
+			if (value < 0.0 || value >= (double)(models.size() - 1))
+				return Fail("the parent must be defined before the model");
+			models.back().parent = (int32_t)value;
+		}
+		else if (Matches({ "lights", "ambient" }))
+			header.ambient = number;
+		else if (Matches({ "lights", "point_lights", "[]", "position", "[]" }))
+			return SetComponent(pointLights.back().position, number, positionField);
+		else if (Matches({ "lights", "point_lights", "[]", "intensity" }))
+			pointLights.back().intensity = SetField(number, intensityField);
+		else if (Matches({ "lights", "point_lights", "[]", "distance" }))
+			pointLights.back().distance = SetField(number, distanceField);
+		else if (Matches({ "lights", "spot_lights", "[]", "position", "[]" }))
+			return SetComponent(spotLights.back().position, number, positionField);
+		else if (Matches({ "lights", "spot_lights", "[]", "direction", "[]" }))
+			return SetComponent(spotLights.back().direction, number, directionField);
+		else if (Matches({ "lights", "spot_lights", "[]", "cutOff" }))
+			spotLights.back().cutOff = SetField(number, cutOffField);
+		else if (Matches({ "lights", "spot_lights", "[]", "outerCutOff" }))
+			spotLights.back().outerCutOff = SetField(number, outerCutOffField);
+		else if (Matches({ "lights", "spot_lights", "[]", "intensity" }))
+			spotLights.back().intensity = SetField(number, intensityField);
+		else if (Matches({ "lights", "direction_light", "direction", "[]" }))
+			return SetComponent(header.directionLightDirection, number, directionField);
+		else if (Matches({ "lights", "direction_light", "position", "[]" }))
+			return SetComponent(header.directionLightPosition, number, positionField);
+		else if (Matches({ "lights", "direction_light", "intensity" }))
+			header.directionLightIntensity = SetField(number, intensityField);
+		return true;
+	}
+private:
+	uint32_t AddString(const std::string& value)
+	{
+		auto string = stringOffsets.find(value);
+		if (string == stringOffsets.end())
+		{
+			string = stringOffsets.emplace(value, (uint32_t)stringTable.size()).first;
+			stringTable.append(value);
+			stringTable.push_back('\0');
+		}
+		return string->second;
+	}
+	bool SetComponent(float* vector, float value, uint32_t field = 0)
+	{
+		const size_t index = GetIndex(GetDepth() - 1);
+		if (index >= 3)
+			return Fail("expected three components");
+		vector[index] = value;
+		fields |= field;
+		return true;
+	}
+	float SetField(float value, uint32_t field)
+	{
+		fields |= field;
+		return value;
+	}
+	bool RequireFields(uint32_t required, const char* names)
+	{
+		if ((fields & required) != required)
+			return Fail(std::string("missing a required field, expected ") + names);
+		return true;
+	}
+
+	//Bits of the fields seen in the model or light being read, the required ones are checked when it ends
+	enum Field : uint32_t
+	{
+		modelField = 1 << 0,
+		positionField = 1 << 1,
+		directionField = 1 << 2,
+		intensityField = 1 << 3,
+		distanceField = 1 << 4,
+		enableField = 1 << 5,
+		cutOffField = 1 << 6,
+		outerCutOffField = 1 << 7,
+	};
+	uint32_t fields = 0;
+	std::unordered_map<std::string, uint32_t> stringOffsets;
+};
+}
+
+bool ConvertSceneToBinary(const std::string& jsonPath, const std::string& outputPath)
+{
+	rmt_ScopedCPUSample(ConvertSceneToBinary, 0);
+	SceneJsonReader reader;
+	if (!reader.Parse(jsonPath))
+		return false;
+	SceneBinaryHeader& header = reader.header;
+	const std::string& stringTable = reader.stringTable;
+	const auto& models = reader.models;
+	const auto& pointLights = reader.pointLights;
+	const auto& spotLights = reader.spotLights;
+
+	header.modelNmb = (uint32_t)models.size();
+	header.pointLightNmb = (uint32_t)pointLights.size();
+	header.spotLightNmb = (uint32_t)spotLights.size();
+	header.stringTableSize = (uint32_t)stringTable.size();
+	header.modelOffset = AlignOffset(sizeof(SceneBinaryHeader));
+	header.pointLightOffset = AlignOffset(header.modelOffset + models.size() * sizeof(SceneBinaryModel));
+	header.spotLightOffset = AlignOffset(header.pointLightOffset + pointLights.size() * sizeof(SceneBinaryPointLight));
+	header.stringTableOffset = AlignOffset(header.spotLightOffset + spotLights.size() * sizeof(SceneBinarySpotLight));
+
+	std::ofstream file(outputPath, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "[Error] Scene: cannot write " << outputPath << "\n";
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	WriteArray(file, header.modelOffset, models);
+	WriteArray(file, header.pointLightOffset, pointLights);
+	WriteArray(file, header.spotLightOffset, spotLights);
+	file.seekp(header.stringTableOffset);
+	file.write(stringTable.data(), stringTable.size());
+	return (bool)file;
+}
+
+std::string CompileScene(const std::string& jsonPath)
+{
+	std::filesystem::path binaryPath(jsonPath);
+	binaryPath.replace_extension(".scene");
+	std::error_code error;
+	const auto jsonTime = std::filesystem::last_write_time(jsonPath, error);
+	//Without the loose JSON the compiled scene can still come from a pak
+	if (error)
+		return binaryPath.string();
+	const auto binaryTime = std::filesystem::last_write_time(binaryPath, error);
+	SceneBinaryHeader header;
+	const uint32_t version = header.version;
+	if (!error)
+	{
+		std::ifstream file(binaryPath, std::ios::binary);
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	}
+	if (error || binaryTime < jsonTime || header.version != version)
+	{
+		//A stale or partly written output would otherwise be loaded as if the conversion worked
+		if (!ConvertSceneToBinary(jsonPath, binaryPath.string()))
+		{
+			std::cerr << "[Error] Scene: cannot compile " << jsonPath << "\n";
+			std::filesystem::remove(binaryPath, error);
+			return std::string();
+		}
+	}
+	return binaryPath.string();
+}
+
+bool SceneBinaryFile::Open(const std::string& path)
+{
+	Close();
+	file = LoadBinaryFile(path);
+	if (!file.IsValid())
+		return false;
+	const uint8_t* data = file.GetData();
+	const size_t size = file.GetSize();
+	const SceneBinaryHeader defaultHeader;
+	if (size < sizeof(SceneBinaryHeader) || std::memcmp(data, defaultHeader.magic, sizeof(defaultHeader.magic)) != 0)
+	{
+		std::cerr << "[Error] Scene: " << path << " is not a compiled scene\n";
+		Close();
+		return false;
+	}
+	header = reinterpret_cast<const SceneBinaryHeader*>(data);
+	if (header->version != defaultHeader.version)
+	{
+		std::cerr << "[Error] Scene: " << path << " has version " << header->version << ", expected " << defaultHeader.version << "\n";
+		Close();
+		return false;
+	}
+	const uint8_t* stringData = nullptr;
+	if (!MapArray(data, size, header->modelOffset, header->modelNmb, models) ||
+		!MapArray(data, size, header->pointLightOffset, header->pointLightNmb, pointLights) ||
+		!MapArray(data, size, header->spotLightOffset, header->spotLightNmb, spotLights) ||
+		!MapArray(data, size, header->stringTableOffset, header->stringTableSize, stringData) ||
+		(header->stringTableSize > 0 && stringData[header->stringTableSize - 1] != '\0'))
+	{
+		std::cerr << "[Error] Scene: " << path << " is truncated\n";
+		Close();
+		return false;
+	}
+	strings = reinterpret_cast<const char*>(stringData);
+	for (uint32_t i = 0; i < header->modelNmb; i++)
+	{
+		if (models[i].modelName >= header->stringTableSize || models[i].parent >= (int32_t)i ||
+			(models[i].material != SceneBinaryModel::noMaterial && models[i].material >= header->stringTableSize))
+		{
+			std::cerr << "[Error] Scene: model " << i << " of " << path << " is invalid\n";
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void SceneBinaryFile::Close()
+{
+	header = nullptr;
+	models = nullptr;
+	pointLights = nullptr;
+	spotLights = nullptr;
+	strings = nullptr;
+	file = FileView();
+}
@@ -0,0 +1,198 @@
+#include <shadow.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <Remotery.h>
+
+void ShadowSystem::Init(int shadowMapSize, int cascadeNmb)
+{
+	this->shadowMapSize = shadowMapSize;
+	this->cascadeNmb = std::min(cascadeNmb, maxCascadeNmb);
+	shadowShader.CompileSource(
+		"shaders/engine/shadow.vert",
+		"shaders/engine/shadow.geom",
+		"shaders/engine/shadow.frag");
+
+	glGenTextures(1, &shadowMap);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, shadowMapSize, shadowMapSize, this->cascadeNmb);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	const float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	glGenFramebuffers(1, &shadowFbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, shadowFbo);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMap, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "[Error] Shadow map framebuffer is not complete\n";
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowSystem::Destroy()
+{
+	glDeleteFramebuffers(1, &shadowFbo);
+	glDeleteTextures(1, &shadowMap);
+}
+
+void ShadowSystem::Update(const glm::mat4& view, float fovY, float aspect, float near,
+	const glm::vec3& lightDirection, const BoundingBox& sceneBounds)
+{
+	cameraView = view;
+	const glm::vec3 direction = glm::normalize(lightDirection);
+	const glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	//Only the rotation is shared by the cascades, it never changes with the camera so the texel grid stays put
+	lightRotation = glm::lookAt(glm::vec3(0.0f), direction, up);
+	const BoundingBox lightSceneBounds = TransformBoundingBox(sceneBounds, lightRotation);
+
+	const glm::mat4 inverseView = glm::inverse(view);
+	const float tanHalfFovY = std::tan(fovY * 0.5f);
+	float sliceNear = near;
+	for (int cascade = 0; cascade < cascadeNmb; cascade++)
+	{
+		//Practical split scheme, blend of logarithmic and uniform splits
+		const float ratio = (float)(cascade + 1) / cascadeNmb;
+		const float logSplit = near * std::pow(shadowDistance / near, ratio);
+		const float uniformSplit = near + (shadowDistance - near) * ratio;
+		const float sliceFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+		cascadeSplits[cascade] = sliceFar;
+
+		glm::vec3 corners[8];
+		for (int i = 0; i < 8; i++)
+		{
+			const float depth = i & 4 ? sliceFar : sliceNear;
+			const float height = depth * tanHalfFovY;
+			const glm::vec4 viewCorner(
+				(i & 1 ? 1.0f : -1.0f) * height * aspect,
+				(i & 2 ? 1.0f : -1.0f) * height,
+				-depth,
+				1.0f);
+			corners[i] = glm::vec3(inverseView * viewCorner);
+		}
+		//A bounding sphere does not change size when the camera rotates, which keeps the cascade stable
+		glm::vec3 center(0.0f);
+		for (auto& corner : corners)
+			center += corner / 8.0f;
+		float radius = 0.0f;
+		for (auto& corner : corners)
+			radius = std::max(radius, glm::length(corner - center));
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		//Snap the center on the shadow map texel grid
+		glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+		const float texelSize = 2.0f * radius / shadowMapSize;
+		lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+		lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+		//Casters between the light and the cascade are kept up to the scene bounds
+		const float zNear = -std::max(lightSceneBounds.max.z, lightCenter.z + radius);
+		const float zFar = -std::min(lightSceneBounds.min.z, lightCenter.z - radius);
+		const glm::mat4 projection = glm::ortho(
+			lightCenter.x - radius, lightCenter.x + radius,
+			lightCenter.y - radius, lightCenter.y + radius,
+			zNear, zFar);
+		cascadeMatrices[cascade] = projection * lightRotation;
+		cascadeCenters[cascade] = lightCenter;
+		cascadeRadius[cascade] = radius;
+		sliceNear = sliceFar;
+	}
+}
+
+void ShadowSystem::Render(const std::vector<BoundingBox>& casterBounds, const std::function<void(size_t caster, Shader& shader)>& drawCaster)
+{
+	rmt_ScopedOpenGLSample(RenderShadows);
+	casterDrawNmb = 0;
+	cascadeDrawNmb = 0;
+	if (!enable)
+		return;
+
+	casterMasks.resize(casterBounds.size());
+	Engine::GetPtr()->GetJobSystem().ParallelFor(casterBounds.size(), 64, [this, &casterBounds](size_t begin, size_t end)
+	{
+		for (size_t caster = begin; caster < end; caster++)
+		{
+			const BoundingBox lightBox = TransformBoundingBox(casterBounds[caster], lightRotation);
+			int mask = 0;
+			for (int cascade = 0; cascade < cascadeNmb; cascade++)
+			{
+				const glm::vec3& center = cascadeCenters[cascade];
+				const float radius = cascadeRadius[cascade];
+				//Anything toward the light can cast on the cascade, only the far side is rejected
+				if (lightBox.max.x < center.x - radius || lightBox.min.x > center.x + radius ||
+					lightBox.max.y < center.y - radius || lightBox.min.y > center.y + radius ||
+					lightBox.max.z < center.z - radius)
+					continue;
+				mask |= 1 << cascade;
+			}
+			casterMasks[caster] = mask;
+		}
+	});
+
+	GLint currentFbo = 0;
+	GLint viewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &currentFbo);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, shadowFbo);
+	glViewport(0, 0, shadowMapSize, shadowMapSize);
+	glEnable(GL_DEPTH_TEST);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+
+	shadowShader.Bind();
+	shadowShader.SetInt("cascadeNmb", cascadeNmb);
+	for (int cascade = 0; cascade < cascadeNmb; cascade++)
+	{
+		shadowShader.SetMat4("cascadeMatrices[" + std::to_string(cascade) + "]", cascadeMatrices[cascade]);
+	}
+	for (size_t caster = 0; caster < casterBounds.size(); caster++)
+	{
+		const int mask = casterMasks[caster];
+		if (mask == 0)
+			continue;
+		shadowShader.SetInt("cascadeMask", mask);
+		drawCaster(caster, shadowShader);
+		casterDrawNmb++;
+		for (int cascade = 0; cascade < cascadeNmb; cascade++)
+			cascadeDrawNmb += (mask >> cascade) & 1;
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, currentFbo);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void ShadowSystem::Bind(Shader& shader) const
+{
+	//The sampler always points to its own unit so it never aliases a sampler2D
+	shader.SetInt("shadowMap", shadowMapTextureUnit);
+	glActiveTexture(GL_TEXTURE0 + shadowMapTextureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap);
+	glActiveTexture(GL_TEXTURE0);
+	if (!enable)
+	{
+		shader.SetInt("cascadeNmb", 0);
+		return;
+	}
+	shader.SetInt("cascadeNmb", cascadeNmb);
+	shader.SetMat4("shadowCameraView", cameraView);
+	for (int cascade = 0; cascade < cascadeNmb; cascade++)
+	{
+		const std::string index = std::to_string(cascade);
+		shader.SetMat4("cascadeMatrices[" + index + "]", cascadeMatrices[cascade]);
+		shader.SetFloat("cascadeSplits[" + index + "]", cascadeSplits[cascade]);
+	}
+}
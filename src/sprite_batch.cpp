@@ -0,0 +1,331 @@
+#include <sprite_batch.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <Remotery.h>
+#include <math_utility.h>
+#include "file_utility.h"
+#include "stb_image.h"
+
+namespace
+{
+struct SpriteImage
+{
+	std::vector<uint8_t> pixels;
+	int width = 0;
+	int height = 0;
+};
+
+//Box filtered half size, an odd size keeps the last row or column out of the average
+void HalveImage(SpriteImage& image)
+{
+	SpriteImage half;
+	half.width = std::max(image.width / 2, 1);
+	half.height = std::max(image.height / 2, 1);
+	half.pixels.resize((size_t)half.width * half.height * 4);
+	for (int y = 0; y < half.height; y++)
+	{
+		for (int x = 0; x < half.width; x++)
+		{
+			const int x0 = std::min(x * 2, image.width - 1);
+			const int x1 = std::min(x * 2 + 1, image.width - 1);
+			const int y0 = std::min(y * 2, image.height - 1);
+			const int y1 = std::min(y * 2 + 1, image.height - 1);
+			for (int channel = 0; channel < 4; channel++)
+			{
+				const unsigned sum = image.pixels[((size_t)y0 * image.width + x0) * 4 + channel] +
+					image.pixels[((size_t)y0 * image.width + x1) * 4 + channel] +
+					image.pixels[((size_t)y1 * image.width + x0) * 4 + channel] +
+					image.pixels[((size_t)y1 * image.width + x1) * 4 + channel];
+				half.pixels[((size_t)y * half.width + x) * 4 + channel] = (uint8_t)((sum + 2) / 4);
+			}
+		}
+	}
+	image = std::move(half);
+}
+}
+
+int SpriteAtlas::Add(const std::string& path)
+{
+	paths.push_back(path);
+	return (int)paths.size() - 1;
+}
+
+bool SpriteAtlas::Build(int pageSize, int padding)
+{
+	rmt_ScopedCPUSample(BuildSpriteAtlas, 0);
+	const int maxImageSize = pageSize - 2 * padding;
+	std::vector<SpriteImage> images(paths.size());
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		SpriteImage& image = images[i];
+		const FileView file = LoadBinaryFile(paths[i]);
+		int channelNmb = 0;
+		uint8_t* data = file.IsValid() ?
+			stbi_load_from_memory(file.GetData(), (int)file.GetSize(), &image.width, &image.height, &channelNmb, 4) : nullptr;
+		if (data == nullptr)
+		{
+			std::cerr << "[Error] Sprite atlas: cannot load " << paths[i] << "\n";
+			return false;
+		}
+		image.pixels.assign(data, data + (size_t)image.width * image.height * 4);
+		stbi_image_free(data);
+		while (image.width > maxImageSize || image.height > maxImageSize)
+			HalveImage(image);
+	}
+
+	//The mips stop where the padding no longer covers the filter footprint, the images start on a texel of the last one
+	int levelNmb = 1;
+	while ((padding >> levelNmb) >= 1)
+		levelNmb++;
+	const int alignment = 1 << (levelNmb - 1);
+	auto align = [alignment](int size) { return (size + alignment - 1) / alignment * alignment; };
+
+	//Shelf packing of the padded images, tallest first
+	std::vector<size_t> packOrder(images.size());
+	std::iota(packOrder.begin(), packOrder.end(), 0);
+	std::sort(packOrder.begin(), packOrder.end(), [&images](size_t a, size_t b)
+	{
+		return images[a].height > images[b].height;
+	});
+	regions.assign(images.size(), SpriteRegion());
+	std::vector<glm::ivec3> positions(images.size());
+	int x = 0, y = 0, shelfHeight = 0;
+	pageNmb = images.empty() ? 0 : 1;
+	for (const size_t index : packOrder)
+	{
+		const int width = align(images[index].width + 2 * padding);
+		const int height = align(images[index].height + 2 * padding);
+		if (x + width > pageSize)
+		{
+			x = 0;
+			y += shelfHeight;
+			shelfHeight = 0;
+		}
+		if (y + height > pageSize)
+		{
+			x = 0;
+			y = 0;
+			shelfHeight = 0;
+			pageNmb++;
+		}
+		positions[index] = glm::ivec3(x, y, pageNmb - 1);
+		x += width;
+		shelfHeight = std::max(shelfHeight, height);
+	}
+	if (pageNmb == 0)
+		return true;
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelNmb, GL_RGBA8, pageSize, pageSize, pageNmb);
+	std::vector<uint8_t> padded;
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		const SpriteImage& image = images[i];
+		const int width = image.width + 2 * padding;
+		const int height = image.height + 2 * padding;
+		//Clamped copy, the border pixels are repeated over the padding
+		padded.resize((size_t)width * height * 4);
+		for (int row = 0; row < height; row++)
+		{
+			const int sourceRow = glm::clamp(row - padding, 0, image.height - 1);
+			for (int column = 0; column < width; column++)
+			{
+				const int sourceColumn = glm::clamp(column - padding, 0, image.width - 1);
+				memcpy(&padded[((size_t)row * width + column) * 4], &image.pixels[((size_t)sourceRow * image.width + sourceColumn) * 4], 4);
+			}
+		}
+		const glm::ivec3& position = positions[i];
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, position.x, position.y, position.z, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, padded.data());
+
+		SpriteRegion& region = regions[i];
+		region.texture = texture;
+		region.page = position.z;
+		region.uvRect = glm::vec4(glm::vec2(position.x + padding, position.y + padding), image.width, image.height) / (float)pageSize;
+		region.size = glm::vec2(image.width, image.height);
+	}
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return true;
+}
+
+void SpriteAtlas::Destroy()
+{
+	glDeleteTextures(1, &texture);
+	texture = 0;
+	pageNmb = 0;
+	regions.clear();
+	paths.clear();
+}
+
+bool SpriteBatch::Init(size_t maxSpriteNmb)
+{
+	this->maxSpriteNmb = maxSpriteNmb;
+	spriteShader.CompileSource("shaders/engine/sprite.vert", "shaders/engine/sprite.frag");
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &instanceVbo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	glBufferData(GL_ARRAY_BUFFER, maxSpriteNmb * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, positionSize));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, uvRect));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, rotationPage));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, tint));
+	for (unsigned i = 0; i < 4; i++)
+		glVertexAttribDivisor(i, 1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return true;
+}
+
+void SpriteBatch::Destroy()
+{
+	glDeleteBuffers(1, &instanceVbo);
+	glDeleteVertexArrays(1, &vao);
+	instanceVbo = 0;
+	vao = 0;
+}
+
+void SpriteBatch::Begin(const glm::mat4& viewProjection)
+{
+	this->viewProjection = viewProjection;
+	instances.clear();
+	keys.clear();
+	textures.clear();
+}
+
+void SpriteBatch::Add(const SpriteRegion& region, const Sprite& sprite)
+{
+	uint32_t slot = 0;
+	while (slot < textures.size() && textures[slot] != region.texture)
+		slot++;
+	if (slot == textures.size())
+		textures.push_back(region.texture);
+
+	SpriteInstance instance;
+	instance.positionSize = glm::vec4(sprite.position, sprite.size);
+	instance.uvRect = glm::vec4(
+		glm::vec2(region.uvRect) + glm::vec2(sprite.uvRect) * glm::vec2(region.uvRect.z, region.uvRect.w),
+		glm::vec2(sprite.uvRect.z, sprite.uvRect.w) * glm::vec2(region.uvRect.z, region.uvRect.w));
+	instance.rotationPage = glm::vec2(sprite.rotation, (float)region.page);
+	instance.tint = PackColor(sprite.tint);
+	instances.push_back(instance);
+	//The bias keeps the negative layers first
+	keys.push_back((uint32_t)(uint16_t)(sprite.layer + 32768) << 16 | slot);
+}
+
+void SpriteBatch::SortKeys()
+{
+	const size_t keyNmb = keys.size();
+	order.resize(keyNmb);
+	tmpOrder.resize(keyNmb);
+	for (uint32_t i = 0; i < keyNmb; i++)
+		order[i] = i;
+
+	//Stable LSD radix sort on bytes like the render queue, a byte identical for every key is skipped
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		size_t histogram[256] = {};
+		for (auto key : keys)
+			histogram[(key >> shift) & 0xFF]++;
+		if (histogram[(keys[0] >> shift) & 0xFF] == keyNmb)
+			continue;
+		size_t offset = 0;
+		for (auto& count : histogram)
+		{
+			const size_t tmp = count;
+			count = offset;
+			offset += tmp;
+		}
+		for (auto index : order)
+			tmpOrder[histogram[(keys[index] >> shift) & 0xFF]++] = index;
+		std::swap(order, tmpOrder);
+	}
+}
+
+void SpriteBatch::End()
+{
+	drawCallNmb = 0;
+	spriteNmb = instances.size();
+	if (instances.empty())
+		return;
+	rmt_ScopedCPUSample(DrawSpriteBatch, 0);
+	rmt_ScopedOpenGLSample(DrawSpriteBatch);
+	SortKeys();
+
+	GLboolean depthTest, blend;
+	glGetBooleanv(GL_DEPTH_TEST, &depthTest);
+	glGetBooleanv(GL_BLEND, &blend);
+	GLint blendFunc[4];
+	glGetIntegerv(GL_BLEND_SRC_RGB, &blendFunc[0]);
+	glGetIntegerv(GL_BLEND_DST_RGB, &blendFunc[1]);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendFunc[2]);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &blendFunc[3]);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	spriteShader.Bind();
+	spriteShader.SetMat4("viewProjection", viewProjection);
+	spriteShader.SetInt("atlas", 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	unsigned boundTexture = 0;
+	//More sprites than the buffer holds are streamed in several rounds
+	for (size_t first = 0; first < instances.size(); first += maxSpriteNmb)
+	{
+		const size_t count = std::min(maxSpriteNmb, instances.size() - first);
+		//Orphan the storage, the draws of the previous round keep reading the old one
+		glBufferData(GL_ARRAY_BUFFER, maxSpriteNmb * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+		auto* mapped = (SpriteInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, count * sizeof(SpriteInstance),
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (mapped == nullptr)
+		{
+			std::cerr << "[Error] Sprite batch: cannot map the instance buffer\n";
+			break;
+		}
+		for (size_t i = 0; i < count; i++)
+			mapped[i] = instances[order[first + i]];
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+
+		//One draw per run of the same texture, the layers only order the instances inside it
+		size_t runStart = 0;
+		while (runStart < count)
+		{
+			const uint32_t slot = keys[order[first + runStart]] & 0xFFFF;
+			size_t runEnd = runStart + 1;
+			while (runEnd < count && (keys[order[first + runEnd]] & 0xFFFF) == slot)
+				runEnd++;
+			if (textures[slot] != boundTexture)
+			{
+				boundTexture = textures[slot];
+				glBindTexture(GL_TEXTURE_2D_ARRAY, boundTexture);
+			}
+			glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)(runEnd - runStart), (GLuint)runStart);
+			drawCallNmb++;
+			runStart = runEnd;
+		}
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+	glBlendFuncSeparate(blendFunc[0], blendFunc[1], blendFunc[2], blendFunc[3]);
+	if (!blend)
+		glDisable(GL_BLEND);
+}
@@ -0,0 +1,223 @@
+#include <taa.h>
+#include <engine.h>
+#include <dynamic_resolution.h>
+
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include "imgui.h"
+#include <Remotery.h>
+
+namespace
+{
+float Halton(int index, int base)
+{
+	float result = 0.0f;
+	float fraction = 1.0f;
+	while (index > 0)
+	{
+		fraction /= base;
+		result += fraction * (index % base);
+		index /= base;
+	}
+	return result;
+}
+
+//Velocity of the texels no object wrote, the resolve rebuilds the camera motion there
+constexpr float noVelocity = -2.0f;
+}
+
+void TemporalAntiAliasing::Init()
+{
+	motionShader.CompileSource("shaders/engine/motion.vert", "shaders/engine/motion.frag");
+	resolveShader.CompileSource("shaders/engine/fullscreen.vert", "shaders/engine/taa_resolve.frag");
+	glGenVertexArrays(1, &emptyVao);
+	glGenFramebuffers(1, &motionFbo);
+	glGenFramebuffers(1, &historyFbo);
+}
+
+void TemporalAntiAliasing::Destroy()
+{
+	glDeleteFramebuffers(1, &motionFbo);
+	glDeleteFramebuffers(1, &historyFbo);
+	glDeleteVertexArrays(1, &emptyVao);
+	glDeleteTextures(1, &velocityTexture);
+	glDeleteTextures(2, historyTextures);
+	velocityTexture = 0;
+	historyTextures[0] = historyTextures[1] = 0;
+	velocityWidth = velocityHeight = 0;
+	historyWidth = historyHeight = 0;
+}
+
+void TemporalAntiAliasing::ResizeVelocity(int width, int height)
+{
+	velocityWidth = width;
+	velocityHeight = height;
+	glDeleteTextures(1, &velocityTexture);
+	glGenTextures(1, &velocityTexture);
+	glBindTexture(GL_TEXTURE_2D, velocityTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG16F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TemporalAntiAliasing::ResizeHistory(int width, int height)
+{
+	historyWidth = width;
+	historyHeight = height;
+	glDeleteTextures(2, historyTextures);
+	glGenTextures(2, historyTextures);
+	for (auto texture : historyTextures)
+	{
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	historyValid = false;
+}
+
+void TemporalAntiAliasing::BeginFrame(const DynamicResolution& dynamicResolution)
+{
+	//A frame without anti-aliasing leaves a history that no longer matches the screen
+	if (!enable || !cameraSet)
+		historyValid = false;
+	cameraSet = false;
+	if (!enable)
+		return;
+	//Same allocation as the scene target, the velocity shares its depth attachment
+	if (dynamicResolution.GetTargetWidth() != velocityWidth || dynamicResolution.GetTargetHeight() != velocityHeight ||
+		dynamicResolution.GetDepthTexture() != sceneDepthTexture)
+	{
+		ResizeVelocity(dynamicResolution.GetTargetWidth(), dynamicResolution.GetTargetHeight());
+		sceneDepthTexture = dynamicResolution.GetDepthTexture();
+		glBindFramebuffer(GL_FRAMEBUFFER, motionFbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, velocityTexture, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, sceneDepthTexture, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cerr << "[Error] TAA: motion vector framebuffer is not complete\n";
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, dynamicResolution.GetFramebuffer());
+	}
+	const float clearVelocity[4] = { noVelocity, noVelocity, 0.0f, 0.0f };
+	glClearTexImage(velocityTexture, 0, GL_RG, GL_FLOAT, clearVelocity);
+
+	auto& config = Engine::GetPtr()->GetConfiguration();
+	renderSize = glm::vec2(config.renderWidth, config.renderHeight);
+	frameIndex = (frameIndex + 1) % jitterSampleNmb;
+	jitter = glm::vec2(Halton(frameIndex + 1, 2), Halton(frameIndex + 1, 3)) - 0.5f;
+}
+
+glm::mat4 TemporalAntiAliasing::JitterProjection(const glm::mat4& view, const glm::mat4& projection)
+{
+	if (!enable)
+		return projection;
+	cameraSet = true;
+	viewProjection = projection * view;
+	//A shift after the projection moves the whole image by the same sub-pixel offset at any depth
+	const glm::vec2 jitterNdc = 2.0f * jitter / renderSize;
+	const glm::mat4 jittered = glm::translate(glm::mat4(1.0f), glm::vec3(jitterNdc, 0.0f)) * projection;
+	jitteredViewProjection = jittered * view;
+	return jittered;
+}
+
+Shader& TemporalAntiAliasing::BeginMotionVectors()
+{
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, motionFbo);
+	//Drawn over the depth of the same geometry, pulled forward like the color pass over the prepass
+	glDepthMask(GL_FALSE);
+	glDepthFunc(GL_LEQUAL);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(-1.0f, -1.0f);
+	motionShader.Bind();
+	motionShader.SetMat4("jitteredViewProjection", jitteredViewProjection);
+	motionShader.SetMat4("viewProjection", viewProjection);
+	motionShader.SetMat4("previousViewProjection", previousViewProjection);
+	return motionShader;
+}
+
+void TemporalAntiAliasing::EndMotionVectors()
+{
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+}
+
+glm::vec2 TemporalAntiAliasing::GetOutputUvScale() const
+{
+	return glm::vec2((float)outputWidth / historyWidth, (float)outputHeight / historyHeight);
+}
+
+void TemporalAntiAliasing::Resolve(const DynamicResolution& dynamicResolution, int windowWidth, int windowHeight)
+{
+	rmt_ScopedCPUSample(ResolveTaa, 0);
+	rmt_ScopedOpenGLSample(ResolveTaa);
+	//Grows with the scene target steps, a new size drops the history
+	if (dynamicResolution.GetTargetWidth() != historyWidth || dynamicResolution.GetTargetHeight() != historyHeight)
+	{
+		ResizeHistory(dynamicResolution.GetTargetWidth(), dynamicResolution.GetTargetHeight());
+	}
+	if (windowWidth != outputWidth || windowHeight != outputHeight)
+	{
+		outputWidth = windowWidth;
+		outputHeight = windowHeight;
+		historyValid = false;
+	}
+	const int readIndex = historyIndex;
+	historyIndex = 1 - historyIndex;
+
+	GLboolean depthTest, blend;
+	glGetBooleanv(GL_DEPTH_TEST, &depthTest);
+	glGetBooleanv(GL_BLEND, &blend);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glBindFramebuffer(GL_FRAMEBUFFER, historyFbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, historyTextures[historyIndex], 0);
+	glViewport(0, 0, outputWidth, outputHeight);
+
+	const glm::vec2 targetSize(dynamicResolution.GetTargetWidth(), dynamicResolution.GetTargetHeight());
+	resolveShader.Bind();
+	resolveShader.SetInt("currentColor", 0);
+	resolveShader.SetInt("currentDepth", 1);
+	resolveShader.SetInt("velocity", 2);
+	resolveShader.SetInt("history", 3);
+	resolveShader.SetVec2("renderUvScale", renderSize / targetSize);
+	resolveShader.SetVec2("renderTexelSize", 1.0f / targetSize);
+	resolveShader.SetVec2("historyUvScale", GetOutputUvScale());
+	resolveShader.SetVec2("jitterUv", jitter / renderSize);
+	resolveShader.SetMat4("inverseViewProjection", glm::inverse(viewProjection));
+	resolveShader.SetMat4("previousViewProjection", previousViewProjection);
+	resolveShader.SetBool("historyValid", historyValid);
+	resolveShader.SetFloat("feedback", feedback);
+	const unsigned textures[4] = { dynamicResolution.GetColorTexture(), dynamicResolution.GetDepthTexture(), velocityTexture, historyTextures[readIndex] };
+	for (int i = 0; i < 4; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+	glBindVertexArray(emptyVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
+
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+	if (blend)
+		glEnable(GL_BLEND);
+	previousViewProjection = viewProjection;
+	historyValid = true;
+}
+
+void TemporalAntiAliasing::UpdateUi()
+{
+	ImGui::Checkbox("Temporal anti-aliasing", &enable);
+	ImGui::SliderFloat("TAA feedback", &feedback, 0.02f, 0.5f);
+}
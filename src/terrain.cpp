@@ -0,0 +1,511 @@
+#include <terrain.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <Remotery.h>
+#include "stb_image.h"
+#include "imgui.h"
+
+namespace
+{
+bool BoxIntersectsSphere(const BoundingBox& box, const glm::vec3& center, float radius)
+{
+	const glm::vec3 closest = glm::clamp(center, box.min, box.max);
+	const glm::vec3 delta = closest - center;
+	return glm::dot(delta, delta) <= radius * radius;
+}
+
+const float morphStartRatio = 0.66f;
+const float morphEndRatio = 0.95f;
+//Clip planes of the terrain view, the water reads its depth back with them
+const float terrainNear = 0.5f;
+const float terrainFar = 2000.0f;
+}
+
+bool Terrain::Init(const std::string& heightmapPath, const std::string& texturePath, float worldSize, float heightScale, int leafNodeSize)
+{
+	int width, height, channelNmb;
+	const FileView heightmapFile = LoadBinaryFile(heightmapPath);
+	stbi_us* data = heightmapFile.IsValid() ?
+		stbi_load_16_from_memory(heightmapFile.GetData(), (int)heightmapFile.GetSize(), &width, &height, &channelNmb, 1) : nullptr;
+	if (data == nullptr)
+	{
+		std::cerr << "[Error] Terrain: cannot load " << heightmapPath << "\n";
+		return false;
+	}
+	if (width != height)
+	{
+		std::cerr << "[Error] Terrain: heightmap " << heightmapPath << " must be square\n";
+		stbi_image_free(data);
+		return false;
+	}
+	this->worldSize = worldSize;
+	this->heightScale = heightScale;
+	this->leafNodeSize = leafNodeSize;
+	heightmapSize = width;
+	heights.resize(width * height);
+	for (size_t i = 0; i < heights.size(); i++)
+	{
+		heights[i] = data[i] / 65535.0f;
+	}
+
+	glGenTextures(1, &heightmapTexture);
+	glBindTexture(GL_TEXTURE_2D, heightmapTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, width, height, 0, GL_RED, GL_UNSIGNED_SHORT, data);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	stbi_image_free(data);
+
+	albedoTexture = stbCreateTexture(texturePath.c_str(), true, true, true);
+
+	//Height range of the leaves, then each level merges its four children
+	const int nodeNmb = (heightmapSize - 1 + leafNodeSize - 1) / leafNodeSize;
+	nodeHeightRanges.assign(1, std::vector<glm::vec2>(nodeNmb * nodeNmb));
+	for (int nodeZ = 0; nodeZ < nodeNmb; nodeZ++)
+	{
+		for (int nodeX = 0; nodeX < nodeNmb; nodeX++)
+		{
+			glm::vec2 range(1.0f, 0.0f);
+			for (int z = nodeZ * leafNodeSize; z <= std::min((nodeZ + 1) * leafNodeSize, heightmapSize - 1); z++)
+			{
+				for (int x = nodeX * leafNodeSize; x <= std::min((nodeX + 1) * leafNodeSize, heightmapSize - 1); x++)
+				{
+					const float sample = heights[z * heightmapSize + x];
+					range.x = std::min(range.x, sample);
+					range.y = std::max(range.y, sample);
+				}
+			}
+			nodeHeightRanges[0][nodeZ * nodeNmb + nodeX] = range;
+		}
+	}
+	InitNodes(nodeNmb);
+	return true;
+}
+
+bool Terrain::InitStreamed(const std::string& tilePath, int slotNmb, int leafNodeSize)
+{
+	if (!streamer.Init(tilePath, slotNmb))
+		return false;
+	const TerrainTileHeader& header = streamer.GetHeader();
+	if (leafNodeSize > (int)header.tileInnerSize || header.tileInnerSize % leafNodeSize != 0)
+	{
+		std::cerr << "[Error] Terrain: leaf node size " << leafNodeSize << " does not divide the tiles of " << tilePath << "\n";
+		streamer.Destroy();
+		return false;
+	}
+	streamed = true;
+	worldSize = header.worldSize;
+	heightScale = header.heightScale;
+	this->leafNodeSize = leafNodeSize;
+	//Virtual heightmap covering all the finest tiles, only used for the sample spacing
+	heightmapSize = header.tileNmb * header.tileInnerSize + 1;
+
+	//Leaves take the height range of their finest tile, the only data kept on the CPU
+	const int nodeNmb = (heightmapSize - 1) / leafNodeSize;
+	const int nodesPerTile = header.tileInnerSize / leafNodeSize;
+	nodeHeightRanges.assign(1, std::vector<glm::vec2>(nodeNmb * nodeNmb));
+	for (int nodeZ = 0; nodeZ < nodeNmb; nodeZ++)
+	{
+		for (int nodeX = 0; nodeX < nodeNmb; nodeX++)
+		{
+			const TerrainTileEntry& entry = streamer.GetEntry(0, nodeX / nodesPerTile, nodeZ / nodesPerTile);
+			nodeHeightRanges[0][nodeZ * nodeNmb + nodeX] = glm::vec2(entry.minHeight, entry.maxHeight);
+		}
+	}
+	InitNodes(nodeNmb);
+	return true;
+}
+
+void Terrain::InitNodes(int nodeNmb)
+{
+	lodNmb = 1;
+	while ((1 << (lodNmb - 1)) < nodeNmb && lodNmb < maxLodNmb)
+		lodNmb++;
+	nodeHeightRanges.resize(lodNmb);
+	for (int lod = 1; lod < lodNmb; lod++)
+	{
+		const int childNmb = nodeNmb;
+		nodeNmb = (nodeNmb + 1) / 2;
+		nodeHeightRanges[lod].assign(nodeNmb * nodeNmb, glm::vec2(1.0f, 0.0f));
+		for (int z = 0; z < childNmb; z++)
+		{
+			for (int x = 0; x < childNmb; x++)
+			{
+				const glm::vec2 childRange = nodeHeightRanges[lod - 1][z * childNmb + x];
+				glm::vec2& range = nodeHeightRanges[lod][(z / 2) * nodeNmb + x / 2];
+				range.x = std::min(range.x, childRange.x);
+				range.y = std::max(range.y, childRange.y);
+			}
+		}
+	}
+
+	//Leaves match the heightmap resolution
+	grid.Init(leafNodeSize + 1);
+	glGenBuffers(1, &instanceVbo);
+	glBindVertexArray(grid.GetVAO());
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	glEnableVertexAttribArray(5);
+	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+	glVertexAttribDivisor(5, 1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	terrainShader.CompileSource(
+		"shaders/engine/terrain.vert",
+		"shaders/engine/terrain.frag");
+}
+
+void Terrain::Destroy()
+{
+	glDeleteTextures(1, &heightmapTexture);
+	glDeleteTextures(1, &albedoTexture);
+	glDeleteBuffers(1, &instanceVbo);
+	if (streamed)
+	{
+		streamer.Destroy();
+		streamed = false;
+	}
+}
+
+float Terrain::GetHeight(float x, float z) const
+{
+	if (heights.empty())
+	{
+		//Streamed terrain reads the resident tiles, the root height range is the fallback until one is uploaded
+		float height;
+		if (streamed && streamer.SampleHeight(x, z, height))
+			return height * heightScale;
+		return nodeHeightRanges.empty() ? 0.0f : nodeHeightRanges.back()[0].y * heightScale;
+	}
+	const float sampleX = glm::clamp(x / worldSize * (heightmapSize - 1), 0.0f, (float)(heightmapSize - 1));
+	const float sampleZ = glm::clamp(z / worldSize * (heightmapSize - 1), 0.0f, (float)(heightmapSize - 1));
+	const int x0 = std::min((int)sampleX, heightmapSize - 2);
+	const int z0 = std::min((int)sampleZ, heightmapSize - 2);
+	const float fx = sampleX - x0;
+	const float fz = sampleZ - z0;
+	const float h00 = heights[z0 * heightmapSize + x0];
+	const float h10 = heights[z0 * heightmapSize + x0 + 1];
+	const float h01 = heights[(z0 + 1) * heightmapSize + x0];
+	const float h11 = heights[(z0 + 1) * heightmapSize + x0 + 1];
+	return glm::mix(glm::mix(h00, h10, fx), glm::mix(h01, h11, fx), fz) * heightScale;
+}
+
+void Terrain::BindHeights(Shader& shader, int firstTextureUnit) const
+{
+	shader.SetFloat("worldSize", worldSize);
+	shader.SetFloat("heightScale", heightScale);
+	shader.SetFloat("heightmapSize", (float)heightmapSize);
+	shader.SetBool("virtualTerrain", streamed);
+	shader.SetInt("heightmap", firstTextureUnit);
+	glActiveTexture(GL_TEXTURE0 + firstTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, heightmapTexture);
+	glActiveTexture(GL_TEXTURE0);
+	if (streamed)
+	{
+		streamer.Bind(shader, firstTextureUnit + 1);
+	}
+}
+
+glm::vec2 Terrain::GetHeightRange(const glm::vec2& min, const glm::vec2& max) const
+{
+	if (nodeHeightRanges.empty())
+		return glm::vec2(0.0f);
+	const float leafWorldSize = worldSize * leafNodeSize / (heightmapSize - 1);
+	const int nodeNmb = (int)std::sqrt((double)nodeHeightRanges[0].size());
+	const int x0 = glm::clamp((int)std::floor(min.x / leafWorldSize), 0, nodeNmb - 1);
+	const int z0 = glm::clamp((int)std::floor(min.y / leafWorldSize), 0, nodeNmb - 1);
+	const int x1 = glm::clamp((int)std::floor(max.x / leafWorldSize), 0, nodeNmb - 1);
+	const int z1 = glm::clamp((int)std::floor(max.y / leafWorldSize), 0, nodeNmb - 1);
+	glm::vec2 range(1.0f, 0.0f);
+	for (int z = z0; z <= z1; z++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			const glm::vec2 nodeRange = nodeHeightRanges[0][z * nodeNmb + x];
+			range = glm::vec2(std::min(range.x, nodeRange.x), std::max(range.y, nodeRange.y));
+		}
+	}
+	return range * heightScale;
+}
+
+BoundingBox Terrain::GetNodeBox(int lod, int nodeX, int nodeZ) const
+{
+	const float leafWorldSize = worldSize * leafNodeSize / (heightmapSize - 1);
+	const float nodeWorldSize = leafWorldSize * (1 << lod);
+	const int nodeNmb = (int)std::sqrt((double)nodeHeightRanges[lod].size());
+	const glm::vec2 range = nodeHeightRanges[lod][nodeZ * nodeNmb + nodeX];
+	BoundingBox box;
+	box.min = glm::vec3(nodeX * nodeWorldSize, range.x * heightScale, nodeZ * nodeWorldSize);
+	box.max = glm::vec3((nodeX + 1) * nodeWorldSize, range.y * heightScale, (nodeZ + 1) * nodeWorldSize);
+	return box;
+}
+
+void Terrain::AddNode(int lod, int nodeX, int nodeZ)
+{
+	const BoundingBox box = GetNodeBox(lod, nodeX, nodeZ);
+	selectedNodes.push_back({ glm::vec2(box.min.x, box.min.z), box.max.x - box.min.x, lod });
+}
+
+bool Terrain::SelectNode(int lod, int nodeX, int nodeZ)
+{
+	const BoundingBox box = GetNodeBox(lod, nodeX, nodeZ);
+	if (!BoxIntersectsSphere(box, selectionPosition, lodRanges[lod]))
+		return false;
+	//Culled nodes are handled, nothing to draw
+	if (!IsInFrustum(selectionFrustum, box))
+		return true;
+	if (lod == 0 || !BoxIntersectsSphere(box, selectionPosition, lodRanges[lod - 1]))
+	{
+		AddNode(lod, nodeX, nodeZ);
+		return true;
+	}
+	const int childNmb = (int)std::sqrt((double)nodeHeightRanges[lod - 1].size());
+	for (int childZ = nodeZ * 2; childZ < std::min(nodeZ * 2 + 2, childNmb); childZ++)
+	{
+		for (int childX = nodeX * 2; childX < std::min(nodeX * 2 + 2, childNmb); childX++)
+		{
+			//Out of the finer range, the child is drawn fully morphed which matches this level
+			if (!SelectNode(lod - 1, childX, childZ) && IsInFrustum(selectionFrustum, GetNodeBox(lod - 1, childX, childZ)))
+			{
+				AddNode(lod - 1, childX, childZ);
+			}
+		}
+	}
+	return true;
+}
+
+void Terrain::Update(const glm::vec3& cameraPosition, const glm::mat4& viewProjection)
+{
+	rmt_ScopedCPUSample(TerrainSelection, 0);
+	if (streamed)
+	{
+		streamer.Update(cameraPosition);
+	}
+	selectedNodes.clear();
+	if (lodNmb == 0)
+		return;
+	const float leafWorldSize = worldSize * leafNodeSize / (heightmapSize - 1);
+	for (int lod = 0; lod < lodNmb; lod++)
+	{
+		lodRanges[lod] = leafWorldSize * lodDistance * (1 << lod);
+	}
+	selectionPosition = cameraPosition;
+	selectionFrustum = ExtractFrustum(viewProjection);
+	const int rootLod = lodNmb - 1;
+	if (!SelectNode(rootLod, 0, 0) && IsInFrustum(selectionFrustum, GetNodeBox(rootLod, 0, 0)))
+	{
+		AddNode(rootLod, 0, 0);
+	}
+}
+
+void Terrain::Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, const glm::vec4& clipPlane)
+{
+	rmt_ScopedOpenGLSample(DrawTerrain);
+	if (selectedNodes.empty())
+		return;
+
+	std::vector<glm::vec4> instances;
+	instances.reserve(selectedNodes.size());
+	for (auto& node : selectedNodes)
+	{
+		instances.emplace_back(node.position, node.size, (float)node.lod);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(glm::vec4), instances.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	terrainShader.Bind();
+	terrainShader.SetMat4("view", view);
+	terrainShader.SetMat4("projection", projection);
+	terrainShader.SetVec3("cameraPosition", cameraPosition);
+	terrainShader.SetVec4("clipPlane", clipPlane);
+	terrainShader.SetFloat("gridDim", (float)leafNodeSize);
+	for (int lod = 0; lod < lodNmb; lod++)
+	{
+		const float previousRange = lod == 0 ? 0.0f : lodRanges[lod - 1];
+		const float morphEnd = lodRanges[lod] * morphEndRatio;
+		const float morphStart = previousRange + (morphEnd - previousRange) * morphStartRatio;
+		terrainShader.SetVec2("morphRanges[" + std::to_string(lod) + "]", morphStart, morphEnd);
+	}
+	terrainShader.SetInt("albedo", 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, albedoTexture);
+	BindHeights(terrainShader, 1);
+
+	grid.DrawInstanced((int)selectedNodes.size());
+}
+
+void TerrainDrawingProgram::Init()
+{
+	programName = "Terrain";
+	//The tiles are cut once from the source images, then only the tiles around the camera stay in memory
+	const std::string tilePath = "data/terrain/terrain.tiles";
+	//The streamer keeps its own seek-based reader on the loose file, so the cache is checked there and never in a pak
+	TerrainTileHeader cachedHeader;
+	cachedHeader.version = 0;
+	std::ifstream(tilePath, std::ios::binary).read((char*)&cachedHeader, sizeof(cachedHeader));
+	//Missing, or written by another converter version
+	if (cachedHeader.version != TerrainTileHeader().version)
+	{
+		//The World Machine heightfield keeps its float precision, the 16 bits export is the fallback
+		TmdFile tmdFile;
+		if (tmdFile.Open("terrain/valley.tmd") && !tmdFile.GetHeights().empty())
+		{
+			ConvertToTerrainTiles(tmdFile.GetHeights(), "data/terrain/terrain_texture2048.png", tilePath, 512.0f, 60.0f);
+		}
+		else
+		{
+			ConvertToTerrainTiles("data/terrain/terrain_height.png", "data/terrain/terrain_texture2048.png", tilePath, 512.0f, 60.0f);
+		}
+	}
+	terrainLoaded = terrain.InitStreamed(tilePath) ||
+		terrain.Init("data/terrain/terrain_height.png", "data/terrain/terrain_texture.png");
+	if (!terrainLoaded)
+	{
+		std::cerr << "[Error] Terrain: no streamed or dense terrain could be loaded\n";
+		return;
+	}
+	//Dense grass patches following the noise, with sparse larger billboards seen from further
+	FoliageLayer grass;
+	grass.density = 14.0f;
+	grass.sizeRange = glm::vec2(0.4f, 0.9f);
+	grass.fadeStart = 40.0f;
+	grass.fadeEnd = 90.0f;
+	grass.noiseThreshold = 0.3f;
+	FoliageLayer bushes;
+	bushes.billboard = true;
+	bushes.density = 0.05f;
+	bushes.sizeRange = glm::vec2(1.5f, 3.0f);
+	bushes.fadeStart = 150.0f;
+	bushes.fadeEnd = 250.0f;
+	bushes.noiseFrequency = 0.005f;
+	foliage.Init({ grass, bushes }, MakeFoliageSurface(terrain));
+
+	//Lakes fill the valleys up to a fifth of the relief
+	const glm::vec2 terrainSize(terrain.GetWorldSize());
+	const glm::vec2 heightRange = terrain.GetHeightRange(glm::vec2(0.0f), terrainSize);
+	water.Init(glm::mix(heightRange.x, heightRange.y, 0.2f), glm::vec2(0.0f), terrainSize);
+
+	auto& camera = Engine::GetPtr()->GetCamera();
+	camera.MovementSpeed = 50.0f;
+	camera.Position = glm::vec3(256.0f, terrain.GetHeight(256.0f, 256.0f) + 20.0f, 256.0f);
+}
+
+void TerrainDrawingProgram::Draw()
+{
+	rmt_ScopedCPUSample(DrawTerrainProgram, 0);
+	if (!terrainLoaded)
+		return;
+	ProcessInput();
+
+	glEnable(GL_DEPTH_TEST);
+	Engine* engine = Engine::GetPtr();
+	auto& camera = engine->GetCamera();
+	auto& config = engine->GetConfiguration();
+	const glm::mat4 projection = glm::perspective(
+		glm::radians(camera.Zoom),
+		(float)config.screenWidth / (float)config.screenHeight,
+		terrainNear,
+		terrainFar);
+	const glm::mat4 view = camera.GetViewMatrix();
+	if (!freezeSelection)
+	{
+		//The reflection only shows the terrain, selected coarser than the main view
+		water.UpdateReflection(view, projection, camera.Position,
+			[this](const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, const glm::vec4& clipPlane)
+		{
+			float& lodDistance = terrain.GetLodDistance();
+			const float mainLodDistance = lodDistance;
+			lodDistance *= water.GetReflectionLodBias();
+			terrain.Update(cameraPosition, projection * view);
+			lodDistance = mainLodDistance;
+			terrain.Draw(view, projection, cameraPosition, clipPlane);
+		});
+		terrain.Update(camera.Position, projection * view);
+		foliage.Update(camera.Position, projection * view);
+	}
+	//The selection and the reflection keep the stable projection, only the main view is jittered
+	const glm::mat4 jitteredProjection = engine->JitterProjection(view, projection);
+	terrain.Draw(view, jitteredProjection, camera.Position);
+	foliage.Draw(view, jitteredProjection, camera.Position, &terrain);
+	water.Draw(view, jitteredProjection, camera.Position, terrainNear, terrainFar);
+
+	engine->SetFrameCounter("Terrain nodes", terrain.GetSelectedNodeNmb());
+	engine->SetFrameCounter("Terrain triangles", terrain.GetTriangleNmb());
+	engine->SetFrameCounter("Foliage chunks", foliage.GetVisibleChunkNmb());
+	engine->SetFrameCounter("Foliage instances", foliage.GetDrawnInstanceNmb());
+	engine->SetFrameCounter("Water reflection updates", water.GetReflectionUpdateNmb());
+	if (terrain.IsStreamed())
+	{
+		engine->SetFrameCounter("Terrain resident tiles", terrain.GetStreamer().GetResidentNmb());
+		engine->SetFrameCounter("Terrain pending tiles", terrain.GetStreamer().GetPendingNmb());
+	}
+}
+
+void TerrainDrawingProgram::Destroy()
+{
+	water.Destroy();
+	foliage.Destroy();
+	terrain.Destroy();
+}
+
+void TerrainDrawingProgram::UpdateUi()
+{
+	if (!terrainLoaded)
+		return;
+	ImGui::Separator();
+	ImGui::SliderFloat("LOD distance", &terrain.GetLodDistance(), 1.0f, 8.0f);
+	ImGui::Checkbox("Freeze selection", &freezeSelection);
+	ImGui::Text("Nodes: %zu, triangles: %zu", terrain.GetSelectedNodeNmb(), terrain.GetTriangleNmb());
+	ImGui::Text("Foliage: %zu / %zu instances in %zu chunks", foliage.GetDrawnInstanceNmb(), foliage.GetInstanceNmb(), foliage.GetVisibleChunkNmb());
+	ImGui::SliderFloat("Wind", &foliage.GetWindStrength(), 0.0f, 0.5f);
+	ImGui::SliderFloat("Reflection scale", &water.GetReflectionScale(), 0.125f, 1.0f);
+	ImGui::SliderInt("Reflection interval", &water.GetReflectionInterval(), 1, 8);
+	ImGui::SliderFloat("Reflection LOD bias", &water.GetReflectionLodBias(), 0.25f, 1.0f);
+	if (terrain.IsStreamed())
+	{
+		auto& streamer = terrain.GetStreamer();
+		ImGui::SliderFloat("Residency radius", &streamer.GetResidencyRadius(), 1.0f, 4.0f);
+		ImGui::SliderInt("Uploads per frame", &streamer.GetUploadBudget(), 1, 32);
+		ImGui::Text("Resident tiles: %zu / %d, pending: %zu", streamer.GetResidentNmb(), streamer.GetSlotNmb(), streamer.GetPendingNmb());
+	}
+}
+
+void TerrainDrawingProgram::ProcessInput()
+{
+	Engine* engine = Engine::GetPtr();
+	auto& inputManager = engine->GetInputManager();
+	auto& camera = engine->GetCamera();
+#ifdef USE_SDL2
+	if (inputManager.GetButton(SDLK_w))
+	{
+		camera.ProcessKeyboard(FORWARD, engine->GetDeltaTime());
+	}
+	if (inputManager.GetButton(SDLK_s))
+	{
+		camera.ProcessKeyboard(BACKWARD, engine->GetDeltaTime());
+	}
+	if (inputManager.GetButton(SDLK_a))
+	{
+		camera.ProcessKeyboard(LEFT, engine->GetDeltaTime());
+	}
+	if (inputManager.GetButton(SDLK_d))
+	{
+		camera.ProcessKeyboard(RIGHT, engine->GetDeltaTime());
+	}
+#endif
+
+	auto mousePos = inputManager.GetMousePosition();
+
+	camera.ProcessMouseMovement(mousePos.x, mousePos.y, true);
+
+	camera.ProcessMouseScroll(inputManager.GetMouseWheelDelta());
+}
@@ -0,0 +1,514 @@
+#include <terrain_tiles.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <Remotery.h>
+#include "stb_image.h"
+
+namespace
+{
+bool WriteTerrainTiles(const uint16_t* heightData, int heightmapSize, const stbi_uc* albedoData, int albedoWidth, int albedoHeight,
+	const std::string& outputPath, float worldSize, float heightScale, int tileInnerSize, int albedoInnerSize)
+{
+	TerrainTileHeader header;
+	header.tileInnerSize = tileInnerSize;
+	header.albedoInnerSize = albedoInnerSize;
+	header.tileNmb = 1;
+	while ((int)header.tileNmb * tileInnerSize < heightmapSize - 1)
+		header.tileNmb *= 2;
+	header.levelNmb = 1;
+	while ((header.tileNmb >> (header.levelNmb - 1)) > 1)
+		header.levelNmb++;
+	//The tile grid can be larger than the heightmap, the spacing between samples is kept
+	const int sampleNmb = header.tileNmb * tileInnerSize;
+	header.worldSize = worldSize * sampleNmb / (heightmapSize - 1);
+	header.heightScale = heightScale;
+
+	size_t entryNmb = 0;
+	for (uint32_t level = 0; level < header.levelNmb; level++)
+		entryNmb += (header.tileNmb >> level) * (header.tileNmb >> level);
+	std::vector<TerrainTileEntry> entries(entryNmb);
+	const size_t heightTileSize = (tileInnerSize + 1) * (tileInnerSize + 1);
+	const size_t albedoTileSize = (albedoInnerSize + 1) * (albedoInnerSize + 1) * 4;
+	const uint64_t dataOffset = sizeof(TerrainTileHeader) + entryNmb * sizeof(TerrainTileEntry);
+
+	std::ofstream file(outputPath, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "[Error] Terrain tiles: cannot write " << outputPath << "\n";
+		return false;
+	}
+	file.seekp(dataOffset);
+
+	//Albedo grid coordinate of the finest level to source pixel
+	const float albedoScale = (float)sampleNmb / (heightmapSize - 1) / (header.tileNmb * albedoInnerSize);
+	std::vector<uint16_t> tileHeights(heightTileSize);
+	std::vector<uint8_t> tileAlbedo(albedoTileSize);
+	size_t entryIndex = 0;
+	for (uint32_t level = 0; level < header.levelNmb; level++)
+	{
+		const int levelTileNmb = header.tileNmb >> level;
+		for (int tileZ = 0; tileZ < levelTileNmb; tileZ++)
+		{
+			for (int tileX = 0; tileX < levelTileNmb; tileX++)
+			{
+				TerrainTileEntry& entry = entries[entryIndex++];
+				entry.offset = (uint64_t)file.tellp();
+				entry.minHeight = 1.0f;
+				entry.maxHeight = 0.0f;
+				//Coarser levels keep every 2^level sample so their vertices match the finer ones
+				for (int z = 0; z <= tileInnerSize; z++)
+				{
+					const int sampleZ = std::min((tileZ * tileInnerSize + z) << level, heightmapSize - 1);
+					for (int x = 0; x <= tileInnerSize; x++)
+					{
+						const int sampleX = std::min((tileX * tileInnerSize + x) << level, heightmapSize - 1);
+						const uint16_t sample = heightData[sampleZ * heightmapSize + sampleX];
+						tileHeights[z * (tileInnerSize + 1) + x] = sample;
+						entry.minHeight = std::min(entry.minHeight, sample / 65535.0f);
+						entry.maxHeight = std::max(entry.maxHeight, sample / 65535.0f);
+					}
+				}
+				//Albedo is box filtered over the texel footprint
+				const float footprint = std::max(1.0f, (1 << level) * albedoScale * (albedoWidth - 1));
+				const int filterSize = std::max(1, (int)std::round(footprint));
+				for (int z = 0; z <= albedoInnerSize; z++)
+				{
+					const float sourceZ = ((tileZ * albedoInnerSize + z) << level) * albedoScale * (albedoHeight - 1);
+					for (int x = 0; x <= albedoInnerSize; x++)
+					{
+						const float sourceX = ((tileX * albedoInnerSize + x) << level) * albedoScale * (albedoWidth - 1);
+						int sum[4] = {};
+						for (int filterZ = 0; filterZ < filterSize; filterZ++)
+						{
+							const int pixelZ = std::min((int)sourceZ + filterZ, albedoHeight - 1);
+							for (int filterX = 0; filterX < filterSize; filterX++)
+							{
+								const int pixelX = std::min((int)sourceX + filterX, albedoWidth - 1);
+								const stbi_uc* pixel = albedoData + (pixelZ * albedoWidth + pixelX) * 4;
+								for (int channel = 0; channel < 4; channel++)
+									sum[channel] += pixel[channel];
+							}
+						}
+						for (int channel = 0; channel < 4; channel++)
+						{
+							tileAlbedo[(z * (albedoInnerSize + 1) + x) * 4 + channel] = (uint8_t)(sum[channel] / (filterSize * filterSize));
+						}
+					}
+				}
+				file.write((const char*)tileHeights.data(), tileHeights.size() * sizeof(uint16_t));
+				file.write((const char*)tileAlbedo.data(), tileAlbedo.size());
+			}
+		}
+	}
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)entries.data(), entries.size() * sizeof(TerrainTileEntry));
+	if (!file)
+	{
+		std::cerr << "[Error] Terrain tiles: failed writing " << outputPath << "\n";
+		return false;
+	}
+	return true;
+}
+}
+
+bool ConvertToTerrainTiles(const std::string& heightmapPath, const std::string& albedoPath, const std::string& outputPath,
+	float worldSize, float heightScale, int tileInnerSize, int albedoInnerSize)
+{
+	rmt_ScopedCPUSample(ConvertTerrainTiles, 0);
+	int heightmapSize, height, channelNmb;
+	const FileView heightmapFile = LoadBinaryFile(heightmapPath);
+	stbi_us* heightData = heightmapFile.IsValid() ?
+		stbi_load_16_from_memory(heightmapFile.GetData(), (int)heightmapFile.GetSize(), &heightmapSize, &height, &channelNmb, 1) : nullptr;
+	if (heightData == nullptr)
+	{
+		std::cerr << "[Error] Terrain tiles: cannot load " << heightmapPath << "\n";
+		return false;
+	}
+	if (heightmapSize != height)
+	{
+		std::cerr << "[Error] Terrain tiles: heightmap " << heightmapPath << " must be square\n";
+		stbi_image_free(heightData);
+		return false;
+	}
+	int albedoWidth, albedoHeight;
+	const FileView albedoFile = LoadBinaryFile(albedoPath);
+	stbi_uc* albedoData = albedoFile.IsValid() ?
+		stbi_load_from_memory(albedoFile.GetData(), (int)albedoFile.GetSize(), &albedoWidth, &albedoHeight, &channelNmb, 4) : nullptr;
+	if (albedoData == nullptr)
+	{
+		std::cerr << "[Error] Terrain tiles: cannot load " << albedoPath << "\n";
+		stbi_image_free(heightData);
+		return false;
+	}
+	const bool result = WriteTerrainTiles(heightData, heightmapSize, albedoData, albedoWidth, albedoHeight,
+		outputPath, worldSize, heightScale, tileInnerSize, albedoInnerSize);
+	stbi_image_free(heightData);
+	stbi_image_free(albedoData);
+	return result;
+}
+
+bool ConvertToTerrainTiles(const TmdHeightSpan& heights, const std::string& albedoPath, const std::string& outputPath,
+	float worldSize, float heightScale, int tileInnerSize, int albedoInnerSize)
+{
+	rmt_ScopedCPUSample(ConvertTmdTerrainTiles, 0);
+	if (heights.empty() || heights.width != heights.height)
+	{
+		std::cerr << "[Error] Terrain tiles: the heightfield must be square\n";
+		return false;
+	}
+	int albedoWidth, albedoHeight, channelNmb;
+	const FileView albedoFile = LoadBinaryFile(albedoPath);
+	stbi_uc* albedoData = albedoFile.IsValid() ?
+		stbi_load_from_memory(albedoFile.GetData(), (int)albedoFile.GetSize(), &albedoWidth, &albedoHeight, &channelNmb, 4) : nullptr;
+	if (albedoData == nullptr)
+	{
+		std::cerr << "[Error] Terrain tiles: cannot load " << albedoPath << "\n";
+		return false;
+	}
+	//Tiles store normalized 16 bits heights from zero, the heights are rescaled by their maximum to use all of them
+	const float maxHeight = std::max(*std::max_element(heights.begin(), heights.end()), 1e-6f);
+	std::vector<uint16_t> heightData(heights.size());
+	for (size_t i = 0; i < heightData.size(); i++)
+	{
+		heightData[i] = (uint16_t)std::lround(glm::clamp(heights.data[i] / maxHeight, 0.0f, 1.0f) * 65535.0f);
+	}
+	const bool result = WriteTerrainTiles(heightData.data(), heights.width, albedoData, albedoWidth, albedoHeight,
+		outputPath, worldSize, heightScale * maxHeight, tileInnerSize, albedoInnerSize);
+	stbi_image_free(albedoData);
+	return result;
+}
+
+bool TerrainStreamer::Init(const std::string& tilePath, int slotNmb)
+{
+	std::ifstream file(tilePath, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "[Error] Terrain tiles: cannot open " << tilePath << "\n";
+		return false;
+	}
+	file.read((char*)&header, sizeof(header));
+	const TerrainTileHeader expected;
+	if (!file || !std::equal(header.magic, header.magic + 4, expected.magic) || header.version != expected.version)
+	{
+		std::cerr << "[Error] Terrain tiles: " << tilePath << " is not a terrain tile file\n";
+		return false;
+	}
+	size_t entryNmb = 0;
+	for (uint32_t level = 0; level < header.levelNmb; level++)
+		entryNmb += GetTileNmb(level) * GetTileNmb(level);
+	entries.resize(entryNmb);
+	file.read((char*)entries.data(), entryNmb * sizeof(TerrainTileEntry));
+	if (!file)
+	{
+		std::cerr << "[Error] Terrain tiles: " << tilePath << " is truncated\n";
+		return false;
+	}
+
+	this->tilePath = tilePath;
+	//The coarsest tile is always resident, at least one more slot is needed to refine
+	this->slotNmb = std::max(slotNmb, 2);
+	heightTileSize = header.tileInnerSize + 1;
+	albedoTileSize = header.albedoInnerSize + 1;
+
+	glGenTextures(1, &heightTiles);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, heightTiles);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R16, heightTileSize, heightTileSize, this->slotNmb);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenTextures(1, &albedoTiles);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, albedoTiles);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, albedoTileSize, albedoTileSize, this->slotNmb);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	//Page table, one mip per level, empty at start
+	glGenTextures(1, &pageTable);
+	glBindTexture(GL_TEXTURE_2D, pageTable);
+	glTexStorage2D(GL_TEXTURE_2D, header.levelNmb, GL_R16UI, header.tileNmb, header.tileNmb);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	pages.resize(header.levelNmb);
+	for (uint32_t level = 0; level < header.levelNmb; level++)
+	{
+		const int levelTileNmb = GetTileNmb(level);
+		pages[level].assign(levelTileNmb * levelTileNmb, 0);
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelTileNmb, levelTileNmb, GL_RED_INTEGER, GL_UNSIGNED_SHORT, pages[level].data());
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	slotHeights.assign(this->slotNmb, {});
+	freeSlots.clear();
+	for (int slot = this->slotNmb - 1; slot >= 0; slot--)
+		freeSlots.push_back(slot);
+
+	running = true;
+	loadingThread = std::thread(&TerrainStreamer::LoadingLoop, this);
+	return true;
+}
+
+void TerrainStreamer::Destroy()
+{
+	if (loadingThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(loadingMutex);
+			running = false;
+		}
+		loadingCondition.notify_all();
+		loadingThread.join();
+	}
+	requests.clear();
+	loadedTiles.clear();
+	uploadQueue.clear();
+	pendingTiles.clear();
+	residentTiles.clear();
+	lruTiles.clear();
+	slotHeights.clear();
+	glDeleteTextures(1, &pageTable);
+	glDeleteTextures(1, &heightTiles);
+	glDeleteTextures(1, &albedoTiles);
+}
+
+size_t TerrainStreamer::GetEntryIndex(int level, int tileX, int tileZ) const
+{
+	size_t index = 0;
+	for (int finerLevel = 0; finerLevel < level; finerLevel++)
+		index += GetTileNmb(finerLevel) * GetTileNmb(finerLevel);
+	return index + tileZ * GetTileNmb(level) + tileX;
+}
+
+const TerrainTileEntry& TerrainStreamer::GetEntry(int level, int tileX, int tileZ) const
+{
+	return entries[GetEntryIndex(level, tileX, tileZ)];
+}
+
+void TerrainStreamer::LoadingLoop()
+{
+	std::ifstream file(tilePath, std::ios::binary);
+	const size_t heightSampleNmb = heightTileSize * heightTileSize;
+	const size_t albedoByteNmb = albedoTileSize * albedoTileSize * 4;
+	while (true)
+	{
+		uint32_t key;
+		{
+			std::unique_lock<std::mutex> lock(loadingMutex);
+			loadingCondition.wait(lock, [this] { return !running || !requests.empty(); });
+			if (!running)
+				return;
+			key = requests.front();
+			requests.pop_front();
+		}
+		TileData tile;
+		tile.key = key;
+		tile.heights.resize(heightSampleNmb);
+		tile.albedo.resize(albedoByteNmb);
+		const TerrainTileEntry& entry = GetEntry(key >> 24, key & 0xFFF, (key >> 12) & 0xFFF);
+		file.seekg(entry.offset);
+		file.read((char*)tile.heights.data(), heightSampleNmb * sizeof(uint16_t));
+		file.read((char*)tile.albedo.data(), albedoByteNmb);
+		if (!file)
+		{
+			std::cerr << "[Error] Terrain tiles: cannot read tile " << key << " from " << tilePath << "\n";
+			file.clear();
+		}
+		std::lock_guard<std::mutex> lock(loadingMutex);
+		loadedTiles.push_back(std::move(tile));
+	}
+}
+
+void TerrainStreamer::SetPage(uint32_t key, uint16_t value)
+{
+	const int level = key >> 24;
+	const int tileX = key & 0xFFF;
+	const int tileZ = (key >> 12) & 0xFFF;
+	pages[level][tileZ * GetTileNmb(level) + tileX] = value;
+	glBindTexture(GL_TEXTURE_2D, pageTable);
+	glTexSubImage2D(GL_TEXTURE_2D, level, tileX, tileZ, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_SHORT, &value);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool TerrainStreamer::UploadTile(const TileData& tile, const std::unordered_set<uint32_t>& desiredTiles)
+{
+	int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		//The least recently used tile leaves, unless it is still needed which means the budget is full
+		const uint32_t evictedKey = lruTiles.back();
+		if (desiredTiles.find(evictedKey) != desiredTiles.end())
+			return false;
+		slot = residentTiles[evictedKey].slot;
+		SetPage(evictedKey, 0);
+		residentTiles.erase(evictedKey);
+		lruTiles.pop_back();
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, heightTiles);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slot, heightTileSize, heightTileSize, 1, GL_RED, GL_UNSIGNED_SHORT, tile.heights.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, albedoTiles);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slot, albedoTileSize, albedoTileSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, tile.albedo.data());
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	slotHeights[slot] = tile.heights;
+
+	lruTiles.push_front(tile.key);
+	residentTiles[tile.key] = { slot, lruTiles.begin() };
+	SetPage(tile.key, (uint16_t)(slot + 1));
+	return true;
+}
+
+bool TerrainStreamer::SampleHeight(float x, float z, float& height) const
+{
+	//Same walk as find_tile in terrain_heights.glsl, from the finest level up to the first resident tile
+	for (uint32_t level = 0; level < pages.size(); level++)
+	{
+		const int levelTileNmb = GetTileNmb(level);
+		const glm::vec2 pagePos = glm::vec2(x, z) / header.worldSize * (float)levelTileNmb;
+		const glm::ivec2 page = glm::clamp(glm::ivec2(pagePos), glm::ivec2(0), glm::ivec2(levelTileNmb - 1));
+		const uint16_t slot = pages[level][page.y * levelTileNmb + page.x];
+		if (slot == 0)
+			continue;
+		const std::vector<uint16_t>& tileHeights = slotHeights[slot - 1];
+		const glm::vec2 sample = glm::clamp(pagePos - glm::vec2(page), 0.0f, 1.0f) * (float)header.tileInnerSize;
+		const int x0 = std::min((int)sample.x, heightTileSize - 2);
+		const int z0 = std::min((int)sample.y, heightTileSize - 2);
+		const float fx = sample.x - x0;
+		const float fz = sample.y - z0;
+		const float h00 = tileHeights[z0 * heightTileSize + x0];
+		const float h10 = tileHeights[z0 * heightTileSize + x0 + 1];
+		const float h01 = tileHeights[(z0 + 1) * heightTileSize + x0];
+		const float h11 = tileHeights[(z0 + 1) * heightTileSize + x0 + 1];
+		height = glm::mix(glm::mix(h00, h10, fx), glm::mix(h01, h11, fx), fz) / 65535.0f;
+		return true;
+	}
+	return false;
+}
+
+void TerrainStreamer::Update(const glm::vec3& cameraPosition)
+{
+	rmt_ScopedCPUSample(TerrainStreaming, 0);
+	if (entries.empty())
+		return;
+
+	//Wanted tiles from the coarsest level to the finest, a tile is wanted when the camera is within
+	//residencyRadius tiles of it, so the wanted count per level is bounded and does not depend on the world size
+	std::vector<uint32_t> wantedTiles;
+	std::unordered_set<uint32_t> desiredTiles;
+	const glm::vec2 position(cameraPosition.x, cameraPosition.z);
+	for (int level = header.levelNmb - 1; level >= 0; level--)
+	{
+		const int levelTileNmb = GetTileNmb(level);
+		const float tileWorldSize = header.worldSize / levelTileNmb;
+		const float radius = tileWorldSize * residencyRadius;
+		const int minX = std::max(0, (int)std::floor((position.x - radius) / tileWorldSize));
+		const int maxX = std::min(levelTileNmb - 1, (int)std::floor((position.x + radius) / tileWorldSize));
+		const int minZ = std::max(0, (int)std::floor((position.y - radius) / tileWorldSize));
+		const int maxZ = std::min(levelTileNmb - 1, (int)std::floor((position.y + radius) / tileWorldSize));
+		const size_t levelStart = wantedTiles.size();
+		for (int tileZ = minZ; tileZ <= maxZ; tileZ++)
+		{
+			for (int tileX = minX; tileX <= maxX; tileX++)
+			{
+				const glm::vec2 tileMin = glm::vec2(tileX, tileZ) * tileWorldSize;
+				const glm::vec2 closest = glm::clamp(position, tileMin, tileMin + tileWorldSize);
+				if (glm::length(closest - position) < radius)
+					wantedTiles.push_back(MakeKey(level, tileX, tileZ));
+			}
+		}
+		//Nearest first inside a level
+		std::sort(wantedTiles.begin() + levelStart, wantedTiles.end(), [&](uint32_t a, uint32_t b)
+		{
+			const glm::vec2 centerA = (glm::vec2(a & 0xFFF, (a >> 12) & 0xFFF) + 0.5f) * tileWorldSize;
+			const glm::vec2 centerB = (glm::vec2(b & 0xFFF, (b >> 12) & 0xFFF) + 0.5f) * tileWorldSize;
+			return glm::length(centerA - position) < glm::length(centerB - position);
+		});
+		if ((int)wantedTiles.size() >= slotNmb)
+		{
+			wantedTiles.resize(slotNmb);
+			break;
+		}
+	}
+	desiredTiles.insert(wantedTiles.begin(), wantedTiles.end());
+
+	//Touch the resident tiles, queue the missing ones and drop the requests nobody wants anymore
+	std::vector<TileData> newTiles;
+	{
+		std::lock_guard<std::mutex> lock(loadingMutex);
+		newTiles.swap(loadedTiles);
+		for (auto it = requests.begin(); it != requests.end();)
+		{
+			if (desiredTiles.find(*it) == desiredTiles.end())
+			{
+				pendingTiles.erase(*it);
+				it = requests.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		for (auto it = wantedTiles.rbegin(); it != wantedTiles.rend(); ++it)
+		{
+			auto resident = residentTiles.find(*it);
+			if (resident != residentTiles.end())
+			{
+				lruTiles.splice(lruTiles.begin(), lruTiles, resident->second.lruIterator);
+			}
+		}
+		for (uint32_t key : wantedTiles)
+		{
+			if (residentTiles.find(key) == residentTiles.end() && pendingTiles.insert(key).second)
+			{
+				requests.push_back(key);
+			}
+		}
+	}
+	loadingCondition.notify_one();
+
+	for (auto& tile : newTiles)
+		uploadQueue.push_back(std::move(tile));
+	int uploadNmb = 0;
+	while (!uploadQueue.empty() && uploadNmb < uploadBudget)
+	{
+		TileData& tile = uploadQueue.front();
+		if (desiredTiles.find(tile.key) != desiredTiles.end() && UploadTile(tile, desiredTiles))
+			uploadNmb++;
+		pendingTiles.erase(tile.key);
+		uploadQueue.pop_front();
+	}
+}
+
+void TerrainStreamer::Bind(Shader& shader, int firstTextureUnit) const
+{
+	shader.SetInt("pageTable", firstTextureUnit);
+	shader.SetInt("heightTiles", firstTextureUnit + 1);
+	shader.SetInt("albedoTiles", firstTextureUnit + 2);
+	shader.SetInt("pageLevelNmb", header.levelNmb);
+	shader.SetFloat("tileInnerSize", (float)header.tileInnerSize);
+	shader.SetFloat("albedoInnerSize", (float)header.albedoInnerSize);
+	shader.SetFloat("residencyRadius", residencyRadius);
+	glActiveTexture(GL_TEXTURE0 + firstTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, pageTable);
+	glActiveTexture(GL_TEXTURE0 + firstTextureUnit + 1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, heightTiles);
+	glActiveTexture(GL_TEXTURE0 + firstTextureUnit + 2);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, albedoTiles);
+	glActiveTexture(GL_TEXTURE0);
+}
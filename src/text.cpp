@@ -0,0 +1,406 @@
+#include <text.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <Remotery.h>
+#include <math_utility.h>
+#include "file_utility.h"
+
+//imgui compiles its own static copy, this one stays private to the baking
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "imstb_truetype.h"
+
+namespace
+{
+constexpr uint32_t atlasMagic = 0x41464453; //"SDFA"
+constexpr uint32_t atlasVersion = 1;
+constexpr int bakedGlyphSize = 48;
+//Distance in baked pixels covered by the field around the outline
+constexpr int glyphPadding = 6;
+constexpr int atlasWidth = 1024;
+//Texture size every OpenGL 4 driver supports, a larger atlas comes from a corrupted file
+constexpr int maxAtlasSize = 16384;
+constexpr int characterNmb = 256;
+
+struct AtlasHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t glyphSize;
+	int32_t padding;
+	int32_t width;
+	int32_t height;
+	int32_t glyphNmb;
+	float lineHeight;
+};
+struct AtlasGlyph
+{
+	int32_t codepoint;
+	int32_t x, y, w, h;
+	int32_t xoff, yoff;
+	float advance;
+};
+
+bool IsCacheOutdated(const std::string& cachePath, const std::string& fontPath)
+{
+	std::error_code error;
+	const auto cacheTime = std::filesystem::last_write_time(cachePath, error);
+	if (error)
+		return !Engine::GetPtr()->GetFileSystem().Exists(cachePath);
+	const auto fontTime = std::filesystem::last_write_time(fontPath, error);
+	return !error && fontTime > cacheTime;
+}
+}
+
+bool TextRenderer::Init(const std::string& fontPath, int maxGlyphNmb)
+{
+	rmt_ScopedCPUSample(InitTextRenderer, 0);
+	const std::string cachePath = std::filesystem::path(fontPath).replace_extension(".sdf").generic_string();
+	if (IsCacheOutdated(cachePath, fontPath) && !BakeAtlas(fontPath, cachePath))
+		return false;
+	if (!LoadAtlas(cachePath))
+		return false;
+
+	textShader.CompileSource("shaders/engine/text.vert", "shaders/engine/text.frag");
+
+	this->maxGlyphNmb = maxGlyphNmb;
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &instanceBuffer);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	//One region per frame in flight, the CPU writes the next one while the GPU still reads the previous ones
+	const GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr bufferSize = (GLsizeiptr)sizeof(GlyphInstance) * maxGlyphNmb * regionNmb;
+	glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, mapFlags);
+	mappedInstances = (GlyphInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, mapFlags);
+	if (mappedInstances == nullptr)
+	{
+		std::cerr << "[Error] Text: cannot map the instance buffer\n";
+		Destroy();
+		return false;
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		glEnableVertexAttribArray(i);
+		glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (void*)(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(i, 1);
+	}
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, color));
+	glVertexAttribDivisor(3, 1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return true;
+}
+
+void TextRenderer::Destroy()
+{
+	for (auto& fence : fences)
+	{
+		if (fence != nullptr)
+			glDeleteSync((GLsync)fence);
+		fence = nullptr;
+	}
+	if (mappedInstances != nullptr)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		mappedInstances = nullptr;
+	}
+	glDeleteBuffers(1, &instanceBuffer);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteTextures(1, &atlasTexture);
+	instanceBuffer = 0;
+	vao = 0;
+	atlasTexture = 0;
+	glyphs.clear();
+}
+
+bool TextRenderer::BakeAtlas(const std::string& fontPath, const std::string& cachePath)
+{
+	rmt_ScopedCPUSample(BakeSdfAtlas, 0);
+	const FileView file = LoadBinaryFile(fontPath);
+	stbtt_fontinfo font;
+	if (!file.IsValid() || !stbtt_InitFont(&font, file.GetData(), stbtt_GetFontOffsetForIndex(file.GetData(), 0)))
+	{
+		std::cerr << "[Error] Text: cannot load the font " << fontPath << "\n";
+		return false;
+	}
+	const float scale = stbtt_ScaleForPixelHeight(&font, (float)bakedGlyphSize);
+	int ascent, descent, lineGap;
+	stbtt_GetFontVMetrics(&font, &ascent, &descent, &lineGap);
+
+	struct BakedGlyph
+	{
+		AtlasGlyph glyph;
+		unsigned char* pixels;
+	};
+	std::vector<BakedGlyph> baked;
+	//Printable ASCII and Latin-1
+	for (int codepoint = 32; codepoint < characterNmb; codepoint++)
+	{
+		if (codepoint >= 127 && codepoint < 160)
+			continue;
+		if (stbtt_FindGlyphIndex(&font, codepoint) == 0 && codepoint != ' ')
+			continue;
+		BakedGlyph bakedGlyph = {};
+		AtlasGlyph& glyph = bakedGlyph.glyph;
+		glyph.codepoint = codepoint;
+		int advance, leftBearing;
+		stbtt_GetCodepointHMetrics(&font, codepoint, &advance, &leftBearing);
+		glyph.advance = advance * scale;
+		bakedGlyph.pixels = stbtt_GetCodepointSDF(&font, scale, codepoint, glyphPadding, 128, 128.0f / glyphPadding,
+			&glyph.w, &glyph.h, &glyph.xoff, &glyph.yoff);
+		baked.push_back(bakedGlyph);
+	}
+
+	//Shelf packing, tallest glyphs first
+	std::sort(baked.begin(), baked.end(), [](const BakedGlyph& a, const BakedGlyph& b)
+	{
+		return a.glyph.h > b.glyph.h;
+	});
+	int x = 0, y = 0, shelfHeight = 0;
+	for (auto& bakedGlyph : baked)
+	{
+		AtlasGlyph& glyph = bakedGlyph.glyph;
+		if (x + glyph.w + 1 > atlasWidth)
+		{
+			x = 0;
+			y += shelfHeight + 1;
+			shelfHeight = 0;
+		}
+		glyph.x = x;
+		glyph.y = y;
+		x += glyph.w + 1;
+		shelfHeight = std::max(shelfHeight, glyph.h);
+	}
+	const int atlasHeight = y + shelfHeight;
+	std::vector<unsigned char> atlas((size_t)atlasWidth * atlasHeight, 0);
+	std::vector<AtlasGlyph> records;
+	for (auto& bakedGlyph : baked)
+	{
+		const AtlasGlyph& glyph = bakedGlyph.glyph;
+		for (int row = 0; row < glyph.h; row++)
+		{
+			memcpy(&atlas[(size_t)(glyph.y + row) * atlasWidth + glyph.x], bakedGlyph.pixels + row * glyph.w, glyph.w);
+		}
+		if (bakedGlyph.pixels != nullptr)
+			stbtt_FreeSDF(bakedGlyph.pixels, nullptr);
+		records.push_back(glyph);
+	}
+
+	AtlasHeader header = {};
+	header.magic = atlasMagic;
+	header.version = atlasVersion;
+	header.glyphSize = bakedGlyphSize;
+	header.padding = glyphPadding;
+	header.width = atlasWidth;
+	header.height = atlasHeight;
+	header.glyphNmb = (int32_t)records.size();
+	header.lineHeight = (ascent - descent + lineGap) * scale;
+	std::ofstream cache(cachePath, std::ios::binary);
+	cache.write((const char*)&header, sizeof(header));
+	cache.write((const char*)records.data(), records.size() * sizeof(AtlasGlyph));
+	cache.write((const char*)atlas.data(), atlas.size());
+	if (!cache)
+	{
+		std::cerr << "[Error] Text: cannot write " << cachePath << "\n";
+		return false;
+	}
+	return true;
+}
+
+bool TextRenderer::LoadAtlas(const std::string& cachePath)
+{
+	const FileView file = LoadBinaryFile(cachePath);
+	AtlasHeader header = {};
+	if (file.IsValid() && file.GetSize() >= sizeof(AtlasHeader))
+		memcpy(&header, file.GetData(), sizeof(header));
+	//The counts are checked before they size anything, a negative one would wrap the expected size
+	const bool validHeader = header.magic == atlasMagic && header.version == atlasVersion &&
+		header.glyphNmb >= 0 && header.glyphNmb <= characterNmb &&
+		header.width > 0 && header.width <= maxAtlasSize && header.height > 0 && header.height <= maxAtlasSize;
+	const size_t expectedSize = validHeader ?
+		sizeof(AtlasHeader) + header.glyphNmb * sizeof(AtlasGlyph) + (size_t)header.width * header.height : 0;
+	if (!validHeader || file.GetSize() != expectedSize)
+	{
+		std::cerr << "[Error] Text: invalid atlas " << cachePath << "\n";
+		return false;
+	}
+	const AtlasGlyph* records = (const AtlasGlyph*)(file.GetData() + sizeof(AtlasHeader));
+	const unsigned char* pixels = file.GetData() + sizeof(AtlasHeader) + header.glyphNmb * sizeof(AtlasGlyph);
+
+	bakedSize = (float)header.glyphSize;
+	lineHeight = header.lineHeight;
+	distanceRange = (float)header.padding;
+	glyphs.assign(characterNmb, Glyph());
+	std::vector<bool> found(characterNmb, false);
+	const glm::vec2 atlasSize(header.width, header.height);
+	for (int i = 0; i < header.glyphNmb; i++)
+	{
+		AtlasGlyph record;
+		memcpy(&record, records + i, sizeof(record));
+		if (record.codepoint < 0 || record.codepoint >= characterNmb)
+			continue;
+		Glyph& glyph = glyphs[record.codepoint];
+		glyph.offset = glm::vec2(record.xoff, record.yoff);
+		glyph.size = glm::vec2(record.w, record.h);
+		glyph.uvRect = glm::vec4(glm::vec2(record.x, record.y) / atlasSize, glm::vec2(record.w, record.h) / atlasSize);
+		glyph.advance = record.advance;
+		found[record.codepoint] = true;
+	}
+	for (int codepoint = 0; codepoint < characterNmb; codepoint++)
+	{
+		if (!found[codepoint])
+			glyphs[codepoint] = glyphs['?'];
+	}
+
+	glGenTextures(1, &atlasTexture);
+	glBindTexture(GL_TEXTURE_2D, atlasTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, header.width, header.height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return true;
+}
+
+const TextRenderer::Glyph& TextRenderer::GetGlyph(unsigned char character) const
+{
+	return glyphs[character];
+}
+
+void TextRenderer::Begin()
+{
+	if (mappedInstances == nullptr)
+		return;
+	region = (region + 1) % regionNmb;
+	glyphNmb = 0;
+	droppedGlyphNmb = 0;
+	//Wait for the draw that read this region regionNmb frames ago, normally long done
+	if (fences[region] != nullptr)
+	{
+		rmt_ScopedCPUSample(WaitTextRegion, 0);
+		const GLsync fence = (GLsync)fences[region];
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+		{
+		}
+		glDeleteSync(fence);
+		fences[region] = nullptr;
+	}
+}
+
+glm::vec2 TextRenderer::Measure(const std::string& text, float pixelHeight) const
+{
+	const float scale = pixelHeight / bakedSize;
+	float lineWidth = 0.0f;
+	glm::vec2 size(0.0f, text.empty() ? 0.0f : lineHeight * scale);
+	for (const char character : text)
+	{
+		if (character == '\n')
+		{
+			lineWidth = 0.0f;
+			size.y += lineHeight * scale;
+			continue;
+		}
+		lineWidth += GetGlyph((unsigned char)character).advance * scale;
+		size.x = std::max(size.x, lineWidth);
+	}
+	return size;
+}
+
+void TextRenderer::AddText(const std::string& text, const glm::vec4& anchor, glm::vec2 origin, float pixelHeight, const glm::vec4& color)
+{
+	if (mappedInstances == nullptr)
+		return;
+	const float scale = pixelHeight / bakedSize;
+	const uint32_t packedColor = PackColor(color);
+	GlyphInstance* instances = mappedInstances + (size_t)region * maxGlyphNmb;
+	//The pen starts on the baseline of the first line
+	glm::vec2 pen = origin + glm::vec2(0.0f, pixelHeight * 0.8f);
+	for (const char character : text)
+	{
+		if (character == '\n')
+		{
+			pen = glm::vec2(origin.x, pen.y + lineHeight * scale);
+			continue;
+		}
+		const Glyph& glyph = GetGlyph((unsigned char)character);
+		if (glyph.size.x > 0.0f && character != ' ')
+		{
+			if (glyphNmb == (size_t)maxGlyphNmb)
+			{
+				droppedGlyphNmb++;
+			}
+			else
+			{
+				//Written once, never read back from the mapped memory
+				GlyphInstance& instance = instances[glyphNmb++];
+				instance.anchor = anchor;
+				instance.rect = glm::vec4(pen + glyph.offset * scale, glyph.size * scale);
+				instance.uvRect = glyph.uvRect;
+				instance.color = packedColor;
+			}
+		}
+		pen.x += glyph.advance * scale;
+	}
+}
+
+void TextRenderer::AddWorldText(const std::string& text, const glm::vec3& position, float pixelHeight, const glm::vec4& color)
+{
+	AddText(text, glm::vec4(position, 1.0f), -Measure(text, pixelHeight) * 0.5f, pixelHeight, color);
+}
+
+void TextRenderer::AddScreenText(const std::string& text, const glm::vec2& position, float pixelHeight, const glm::vec4& color)
+{
+	AddText(text, glm::vec4(position, 0.0f, 0.0f), glm::vec2(0.0f), pixelHeight, color);
+}
+
+void TextRenderer::Draw(const glm::mat4& view, const glm::mat4& projection)
+{
+	if (glyphNmb == 0)
+		return;
+	rmt_ScopedCPUSample(DrawText, 0);
+	rmt_ScopedOpenGLSample(DrawText);
+	auto& config = Engine::GetPtr()->GetConfiguration();
+	GLboolean depthTest, blend;
+	glGetBooleanv(GL_DEPTH_TEST, &depthTest);
+	glGetBooleanv(GL_BLEND, &blend);
+	GLint blendFunc[4];
+	glGetIntegerv(GL_BLEND_SRC_RGB, &blendFunc[0]);
+	glGetIntegerv(GL_BLEND_DST_RGB, &blendFunc[1]);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendFunc[2]);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &blendFunc[3]);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	textShader.Bind();
+	textShader.SetMat4("viewProjection", projection * view);
+	textShader.SetVec2("screenSize", (float)config.screenWidth, (float)config.screenHeight);
+	textShader.SetFloat("distanceRange", distanceRange);
+	textShader.SetInt("atlas", 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, atlasTexture);
+	glBindVertexArray(vao);
+	glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6, (GLsizei)glyphNmb, (GLuint)(region * maxGlyphNmb));
+	glBindVertexArray(0);
+	if (fences[region] != nullptr)
+		glDeleteSync((GLsync)fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+	glBlendFuncSeparate(blendFunc[0], blendFunc[1], blendFunc[2], blendFunc[3]);
+	if (!blend)
+		glDisable(GL_BLEND);
+}
@@ -0,0 +1,149 @@
+#include <texture_residency.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+void TextureResidency::Init(bool allowBindless)
+{
+	//The shaders build the handle from a per draw index, which needs the non uniform sampler support
+	bindless = allowBindless && GLEW_ARB_bindless_texture && GLEW_NV_gpu_shader5;
+	glGenBuffers(1, &ssbo);
+}
+
+void TextureResidency::Destroy()
+{
+	for (auto handle : residentHandles)
+		glMakeTextureHandleNonResidentARB(handle);
+	residentHandles.clear();
+	for (auto& page : pages)
+		glDeleteTextures(1, &page.texture);
+	pages.clear();
+	pagesByFormat.clear();
+	indices.clear();
+	entries.clear();
+	glDeleteBuffers(1, &ssbo);
+	ssbo = 0;
+}
+
+int TextureResidency::Register(unsigned texture)
+{
+	const auto registered = indices.find(texture);
+	if (registered != indices.end())
+		return registered->second;
+	glm::uvec2 entry;
+	if (bindless)
+	{
+		const GLuint64 handle = glGetTextureHandleARB(texture);
+		if (handle == 0)
+		{
+			std::cerr << "[Error] Texture residency: no handle for texture " << texture << "\n";
+			return -1;
+		}
+		glMakeTextureHandleResidentARB(handle);
+		residentHandles.push_back(handle);
+		entry = glm::uvec2(uint32_t(handle), uint32_t(handle >> 32));
+	}
+	else if (!AddToPage(texture, entry))
+	{
+		return -1;
+	}
+	const int index = (int)entries.size();
+	entries.push_back(entry);
+	indices[texture] = index;
+	dirty = true;
+	return index;
+}
+
+bool TextureResidency::AddToPage(unsigned texture, glm::uvec2& entry)
+{
+	int width = 0;
+	int height = 0;
+	int internalFormat = 0;
+	int maxLevel = 0;
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+	//Only the levels that were really allocated are copied
+	int levelNmb = 0;
+	for (int levelWidth = 0; levelNmb <= maxLevel; levelNmb++)
+	{
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levelNmb, GL_TEXTURE_WIDTH, &levelWidth);
+		if (levelWidth == 0)
+			break;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	if (levelNmb == 0)
+	{
+		std::cerr << "[Error] Texture residency: texture " << texture << " has no storage\n";
+		return false;
+	}
+
+	const PageFormat format(width, height, internalFormat, levelNmb);
+	int pageIndex = -1;
+	const auto samePages = pagesByFormat.equal_range(format);
+	for (auto page = samePages.first; page != samePages.second; ++page)
+	{
+		if (pages[page->second].layerNmb < pageLayerNmb)
+			pageIndex = page->second;
+	}
+	if (pageIndex < 0)
+	{
+		if (pages.size() == maxPageNmb)
+		{
+			std::cerr << "[Error] Texture residency: more than " << maxPageNmb << " texture array pages\n";
+			return false;
+		}
+		Page page;
+		glGenTextures(1, &page.texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, page.texture);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelNmb, internalFormat, width, height, pageLayerNmb);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levelNmb > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		pageIndex = (int)pages.size();
+		pages.push_back(page);
+		pagesByFormat.emplace(format, pageIndex);
+	}
+	Page& page = pages[pageIndex];
+	for (int level = 0; level < levelNmb; level++)
+	{
+		glCopyImageSubData(
+			texture, GL_TEXTURE_2D, level, 0, 0, 0,
+			page.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, page.layerNmb,
+			std::max(width >> level, 1), std::max(height >> level, 1), 1);
+	}
+	entry = glm::uvec2(pageIndex, page.layerNmb);
+	page.layerNmb++;
+	return true;
+}
+
+void TextureResidency::Upload()
+{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, entries.size() * sizeof(glm::uvec2), entries.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	dirty = false;
+}
+
+void TextureResidency::Bind(Shader& shader, int firstTextureUnit)
+{
+	if (dirty)
+		Upload();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ssboBinding, ssbo);
+	shader.SetBool("residencyBindless", bindless);
+	if (bindless)
+		return;
+	for (int i = 0; i < (int)pages.size(); i++)
+	{
+		shader.SetInt("residencyPages[" + std::to_string(i) + "]", firstTextureUnit + i);
+		glActiveTexture(GL_TEXTURE0 + firstTextureUnit + i);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, pages[i].texture);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,145 @@
+#include <tmd_file.h>
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+const char tmdMagic[] = "TMDFile2";
+const size_t tmdMagicSize = sizeof(tmdMagic) - 1;
+const int maxChunkDepth = 16;
+
+bool IsChunkStart(const uint8_t* begin, const uint8_t* end)
+{
+	return end - begin >= 2 && begin[0] == 'W' && begin[1] == 'M';
+}
+}
+
+bool TmdFile::Open(const std::string& path)
+{
+	Close();
+	if (!file.Open(path))
+		return false;
+	this->path = path;
+	const uint8_t* begin = file.GetData();
+	const uint8_t* end = begin + file.GetSize();
+	if (file.GetSize() < tmdMagicSize || std::memcmp(begin, tmdMagic, tmdMagicSize) != 0)
+	{
+		std::cerr << "[Error] TMD: " << path << " is not a TMDFile2 file\n";
+		Close();
+		return false;
+	}
+	//Trailing bytes after the chunks are editor state, they are ignored
+	if (!ParseChunks(begin + tmdMagicSize, end, chunks, 0))
+	{
+		std::cerr << "[Error] TMD: chunks of " << path << " are truncated\n";
+		Close();
+		return false;
+	}
+
+	const TmdChunk* heightfield = FindHeightfield(chunks);
+	if (heightfield == nullptr)
+		return true;
+	uint32_t size[2];
+	if (heightfield->size < sizeof(size))
+	{
+		std::cerr << "[Error] TMD: heightfield of " << path << " is truncated\n";
+		Close();
+		return false;
+	}
+	std::memcpy(size, heightfield->data, sizeof(size));
+	const uint8_t* samples = heightfield->data + sizeof(size);
+	if ((heightfield->size - sizeof(size)) / sizeof(float) < (uint64_t)size[0] * size[1])
+	{
+		std::cerr << "[Error] TMD: heightfield of " << path << " is truncated\n";
+		Close();
+		return false;
+	}
+	if (reinterpret_cast<uintptr_t>(samples) % alignof(float) != 0)
+	{
+		std::cerr << "[Error] TMD: heightfield of " << path << " is not aligned and cannot be mapped\n";
+		Close();
+		return false;
+	}
+	heights.data = reinterpret_cast<const float*>(samples);
+	heights.width = (int)size[0];
+	heights.height = (int)size[1];
+	return true;
+}
+
+void TmdFile::Close()
+{
+	chunks.clear();
+	heights = TmdHeightSpan();
+	file.Close();
+}
+
+bool TmdFile::ParseChunks(const uint8_t* begin, const uint8_t* end, std::vector<TmdChunk>& chunks, int depth)
+{
+	if (depth > maxChunkDepth)
+		return false;
+	const uint8_t* cursor = begin;
+	while (IsChunkStart(cursor, end))
+	{
+		if (end - cursor < 3 || end - cursor < 3 + cursor[2] + (ptrdiff_t)sizeof(uint64_t))
+			return false;
+		TmdChunk chunk;
+		const uint8_t nameSize = cursor[2];
+		chunk.name = std::string_view(reinterpret_cast<const char*>(cursor + 3), nameSize);
+		uint64_t size;
+		std::memcpy(&size, cursor + 3 + nameSize, sizeof(size));
+		chunk.data = cursor + 3 + nameSize + sizeof(size);
+		if (size > (uint64_t)(end - chunk.data))
+			return false;
+		chunk.size = (size_t)size;
+		//A payload can start with "WM" by chance, it is then kept as raw data
+		if (IsChunkStart(chunk.data, chunk.data + chunk.size) &&
+			!ParseChunks(chunk.data, chunk.data + chunk.size, chunk.children, depth + 1))
+		{
+			chunk.children.clear();
+		}
+		cursor = chunk.data + chunk.size;
+		chunks.push_back(std::move(chunk));
+	}
+	return true;
+}
+
+const TmdChunk* TmdFile::FindChunk(const std::string& path) const
+{
+	const std::vector<TmdChunk>* level = &chunks;
+	const TmdChunk* found = nullptr;
+	size_t start = 0;
+	while (start <= path.size())
+	{
+		size_t separator = path.find('/', start);
+		if (separator == std::string::npos)
+			separator = path.size();
+		const std::string_view name(path.data() + start, separator - start);
+		found = nullptr;
+		for (auto& chunk : *level)
+		{
+			if (chunk.name == name)
+			{
+				found = &chunk;
+				break;
+			}
+		}
+		if (found == nullptr)
+			return nullptr;
+		level = &found->children;
+		start = separator + 1;
+	}
+	return found;
+}
+
+const TmdChunk* TmdFile::FindHeightfield(const std::vector<TmdChunk>& chunks) const
+{
+	for (auto& chunk : chunks)
+	{
+		if (chunk.name == "Heightfield")
+			return &chunk;
+		if (const TmdChunk* child = FindHeightfield(chunk.children))
+			return child;
+	}
+	return nullptr;
+}
@@ -0,0 +1,158 @@
+#include <transform.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <numeric>
+#include <glm/gtc/matrix_transform.hpp>
+#include <Remotery.h>
+
+namespace
+{
+constexpr uint8_t changedFlag = 1;
+//A new node has no previous matrix, it starts without motion
+constexpr uint8_t addedFlag = 2;
+}
+
+int TransformHierarchy::AddNode(int parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	const int handle = (int)slots.size();
+	const int parentSlot = parent == noParent ? noParent : slots[parent];
+	slots.push_back((int)handles.size());
+	handles.push_back(handle);
+	parents.push_back(parentSlot);
+	depths.push_back(parentSlot == noParent ? 0 : depths[parentSlot] + 1);
+	localPositions.push_back(position);
+	localRotations.push_back(rotation);
+	localScales.push_back(scale);
+	worldMatrices.emplace_back(1.0f);
+	previousWorldMatrices.emplace_back(1.0f);
+	dirty.push_back(changedFlag | addedFlag);
+	updated.push_back(0);
+	sorted = false;
+	return handle;
+}
+
+void TransformHierarchy::Clear()
+{
+	handles.clear();
+	parents.clear();
+	depths.clear();
+	localPositions.clear();
+	localRotations.clear();
+	localScales.clear();
+	worldMatrices.clear();
+	previousWorldMatrices.clear();
+	dirty.clear();
+	updated.clear();
+	slots.clear();
+	depthStarts.clear();
+	sorted = true;
+	updatedNmb = 0;
+}
+
+void TransformHierarchy::SetLocalPosition(int node, const glm::vec3& position)
+{
+	localPositions[slots[node]] = position;
+	dirty[slots[node]] |= changedFlag;
+}
+
+void TransformHierarchy::SetLocalRotation(int node, const glm::quat& rotation)
+{
+	localRotations[slots[node]] = rotation;
+	dirty[slots[node]] |= changedFlag;
+}
+
+void TransformHierarchy::SetLocalScale(int node, const glm::vec3& scale)
+{
+	localScales[slots[node]] = scale;
+	dirty[slots[node]] |= changedFlag;
+}
+
+void TransformHierarchy::SortByDepth()
+{
+	const size_t nodeNmb = handles.size();
+	std::vector<int> order(nodeNmb);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return depths[a] < depths[b]; });
+	std::vector<int> newSlots(nodeNmb);
+	for (size_t slot = 0; slot < nodeNmb; slot++)
+		newSlots[order[slot]] = (int)slot;
+
+	auto reorder = [&order](auto& values)
+	{
+		auto sortedValues = values;
+		for (size_t slot = 0; slot < order.size(); slot++)
+			sortedValues[slot] = values[order[slot]];
+		values.swap(sortedValues);
+	};
+	reorder(handles);
+	reorder(parents);
+	reorder(depths);
+	reorder(localPositions);
+	reorder(localRotations);
+	reorder(localScales);
+	reorder(worldMatrices);
+	reorder(previousWorldMatrices);
+	reorder(dirty);
+	reorder(updated);
+	for (auto& parent : parents)
+	{
+		if (parent != noParent)
+			parent = newSlots[parent];
+	}
+	for (size_t slot = 0; slot < nodeNmb; slot++)
+		slots[handles[slot]] = (int)slot;
+
+	depthStarts.clear();
+	for (size_t slot = 0; slot < nodeNmb; slot++)
+	{
+		if (slot == 0 || depths[slot] != depths[slot - 1])
+			depthStarts.push_back(slot);
+	}
+	depthStarts.push_back(nodeNmb);
+	sorted = true;
+}
+
+size_t TransformHierarchy::Update()
+{
+	rmt_ScopedCPUSample(UpdateTransforms, 0);
+	if (!sorted)
+		SortByDepth();
+	//The nodes moved by the last update keep the matrix they had until now, the others already match
+	for (size_t slot = 0; slot < updated.size(); slot++)
+	{
+		if (updated[slot])
+			previousWorldMatrices[slot] = worldMatrices[slot];
+	}
+	std::fill(updated.begin(), updated.end(), 0);
+	updatedNmb = 0;
+	if (std::find_if(dirty.begin(), dirty.end(), [](uint8_t flags) { return flags != 0; }) == dirty.end())
+		return 0;
+
+	//A level only reads the previous one, the nodes of a level are independent
+	auto& jobSystem = Engine::GetPtr()->GetJobSystem();
+	for (size_t depth = 0; depth + 1 < depthStarts.size(); depth++)
+	{
+		const size_t begin = depthStarts[depth];
+		const size_t end = depthStarts[depth + 1];
+		jobSystem.ParallelFor(end - begin, 256, [this, begin](size_t first, size_t last)
+		{
+			for (size_t slot = begin + first; slot < begin + last; slot++)
+			{
+				const int parent = parents[slot];
+				if (!dirty[slot] && (parent == noParent || !updated[parent]))
+					continue;
+				glm::mat4 local = glm::translate(glm::mat4(1.0f), localPositions[slot]);
+				local = local * glm::mat4_cast(localRotations[slot]);
+				local = glm::scale(local, localScales[slot]);
+				worldMatrices[slot] = parent == noParent ? local : worldMatrices[parent] * local;
+				if (dirty[slot] & addedFlag)
+					previousWorldMatrices[slot] = worldMatrices[slot];
+				updated[slot] = 1;
+			}
+		});
+	}
+	std::fill(dirty.begin(), dirty.end(), 0);
+	updatedNmb = std::count(updated.begin(), updated.end(), 1);
+	return updatedNmb;
+}
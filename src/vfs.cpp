@@ -0,0 +1,298 @@
+#include <vfs.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <Remotery.h>
+
+namespace
+{
+const uint64_t pakAlignment = 64;
+
+uint64_t AlignPakOffset(uint64_t offset)
+{
+	return (offset + pakAlignment - 1) & ~(pakAlignment - 1);
+}
+
+std::string_view GetEntryName(const PakEntry& entry, const char* strings)
+{
+	return std::string_view(strings + entry.nameOffset, entry.nameSize);
+}
+
+//Loaders build paths like "data/models/x/../y.png" or "./data", the pak only knows the plain form
+std::string NormalizePath(std::string_view path)
+{
+	std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+	return normalized == "." ? std::string() : normalized;
+}
+}
+
+bool BuildPak(const std::vector<std::string>& directories, const std::string& outputPath,
+	const std::vector<std::string>& excludedPaths)
+{
+	rmt_ScopedCPUSample(BuildPak, 0);
+	std::vector<std::string> paths;
+	for (auto& directory : directories)
+	{
+		std::error_code error;
+		for (auto it = std::filesystem::recursive_directory_iterator(directory, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+		{
+			if (it->is_regular_file())
+				paths.push_back(NormalizePath(it->path().generic_string()));
+		}
+		if (error)
+		{
+			std::cerr << "[Error] Pak: cannot list " << directory << "\n";
+			return false;
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+	paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+	for (auto& excludedPath : excludedPaths)
+	{
+		const auto excluded = std::lower_bound(paths.begin(), paths.end(), NormalizePath(excludedPath));
+		if (excluded != paths.end() && *excluded == NormalizePath(excludedPath))
+			paths.erase(excluded);
+	}
+
+	PakHeader header;
+	std::vector<PakEntry> entries(paths.size());
+	std::string stringTable;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		entries[i].nameOffset = (uint32_t)stringTable.size();
+		entries[i].nameSize = (uint32_t)paths[i].size();
+		stringTable.append(paths[i]);
+	}
+	header.entryNmb = (uint32_t)entries.size();
+	header.stringTableSize = (uint32_t)stringTable.size();
+	header.entryOffset = AlignPakOffset(sizeof(PakHeader));
+	header.stringTableOffset = header.entryOffset + entries.size() * sizeof(PakEntry);
+
+	std::ofstream file(outputPath, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "[Error] Pak: cannot write " << outputPath << "\n";
+		return false;
+	}
+	uint64_t offset = AlignPakOffset(header.stringTableOffset + stringTable.size());
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		MappedFile source;
+		const uint64_t size = std::filesystem::file_size(paths[i]);
+		if (size > 0 && !source.Open(paths[i]))
+			return false;
+		entries[i].offset = offset;
+		entries[i].size = size;
+		file.seekp(offset);
+		file.write(reinterpret_cast<const char*>(source.GetData()), size);
+		offset = AlignPakOffset(offset + size);
+	}
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.seekp(header.entryOffset);
+	file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PakEntry));
+	file.write(stringTable.data(), stringTable.size());
+	return (bool)file;
+}
+
+bool FileSystem::MountDirectory(const std::string& directory, const std::string& mountPoint)
+{
+	if (!std::filesystem::is_directory(directory))
+	{
+		std::cerr << "[Error] File system: " << directory << " is not a directory\n";
+		return false;
+	}
+	Mount mount;
+	mount.mountPoint = NormalizePath(mountPoint);
+	mount.directory = directory;
+	mounts.push_back(std::move(mount));
+	return true;
+}
+
+bool FileSystem::MountPak(const std::string& pakPath, const std::string& mountPoint)
+{
+	auto pak = std::make_unique<MappedFile>();
+	if (!pak->Open(pakPath))
+		return false;
+	const PakHeader defaultHeader;
+	PakHeader header;
+	if (pak->GetSize() < sizeof(PakHeader) || std::memcmp(pak->GetData(), defaultHeader.magic, sizeof(defaultHeader.magic)) != 0)
+	{
+		std::cerr << "[Error] File system: " << pakPath << " is not a pak\n";
+		return false;
+	}
+	std::memcpy(&header, pak->GetData(), sizeof(header));
+	if (header.version != defaultHeader.version)
+	{
+		std::cerr << "[Error] File system: " << pakPath << " has version " << header.version << ", expected " << defaultHeader.version << "\n";
+		return false;
+	}
+	const size_t size = pak->GetSize();
+	if (header.entryOffset % alignof(PakEntry) != 0 ||
+		header.entryOffset > size || (size - header.entryOffset) / sizeof(PakEntry) < header.entryNmb ||
+		header.stringTableOffset > size || size - header.stringTableOffset < header.stringTableSize)
+	{
+		std::cerr << "[Error] File system: index of " << pakPath << " is truncated\n";
+		return false;
+	}
+	Mount mount;
+	mount.mountPoint = NormalizePath(mountPoint);
+	mount.entries = reinterpret_cast<const PakEntry*>(pak->GetData() + header.entryOffset);
+	mount.entryNmb = header.entryNmb;
+	mount.strings = reinterpret_cast<const char*>(pak->GetData() + header.stringTableOffset);
+	for (uint32_t i = 0; i < header.entryNmb; i++)
+	{
+		const PakEntry& entry = mount.entries[i];
+		if ((uint64_t)entry.nameOffset + entry.nameSize > header.stringTableSize ||
+			entry.offset > size || size - entry.offset < entry.size)
+		{
+			std::cerr << "[Error] File system: entry " << i << " of " << pakPath << " is out of the file\n";
+			return false;
+		}
+	}
+	//The whole archive is read ahead in large sequential requests instead of one fault per asset
+	pak->Prefetch(0, size);
+	mount.pak = std::move(pak);
+	mounts.push_back(std::move(mount));
+	return true;
+}
+
+void FileSystem::UnmountAll()
+{
+	mounts.clear();
+}
+
+bool FileSystem::GetRelativePath(const Mount& mount, std::string_view path, std::string_view& relativePath)
+{
+	if (mount.mountPoint.empty())
+	{
+		relativePath = path;
+		return true;
+	}
+	if (path.size() <= mount.mountPoint.size() || path.compare(0, mount.mountPoint.size(), mount.mountPoint) != 0 ||
+		path[mount.mountPoint.size()] != '/')
+	{
+		return false;
+	}
+	relativePath = path.substr(mount.mountPoint.size() + 1);
+	return true;
+}
+
+const PakEntry* FileSystem::FindEntry(const Mount& mount, std::string_view relativePath)
+{
+	const PakEntry* end = mount.entries + mount.entryNmb;
+	const PakEntry* entry = std::lower_bound(mount.entries, end, relativePath, [&mount](const PakEntry& entry, std::string_view name)
+	{
+		return GetEntryName(entry, mount.strings) < name;
+	});
+	if (entry == end || GetEntryName(*entry, mount.strings) != relativePath)
+		return nullptr;
+	return entry;
+}
+
+FileView FileSystem::Read(const std::string& path) const
+{
+	const std::string normalizedPath = NormalizePath(path);
+	for (auto mount = mounts.rbegin(); mount != mounts.rend(); ++mount)
+	{
+		std::string_view relativePath;
+		if (!GetRelativePath(*mount, normalizedPath, relativePath))
+			continue;
+		if (mount->pak != nullptr)
+		{
+			const PakEntry* entry = FindEntry(*mount, relativePath);
+			if (entry == nullptr)
+				continue;
+			if (entry->compression != PakCompression::NONE)
+			{
+				std::cerr << "[Error] File system: " << path << " uses an unsupported compression\n";
+				return FileView();
+			}
+			return FileView(mount->pak->GetData() + entry->offset, (size_t)entry->size);
+		}
+		const std::filesystem::path loosePath = std::filesystem::path(mount->directory) / relativePath;
+		std::error_code error;
+		const uintmax_t size = std::filesystem::file_size(loosePath, error);
+		if (error)
+			continue;
+		if (size == 0)
+		{
+			//Nothing to map, the span still has to be valid
+			static const uint8_t emptyFile = 0;
+			return FileView(&emptyFile, 0);
+		}
+		auto file = std::make_unique<MappedFile>();
+		if (!file->Open(loosePath.string()))
+			return FileView();
+		return FileView(std::move(file));
+	}
+	std::cerr << "[Error] File system: could not find \"" << path << "\"\n";
+	return FileView();
+}
+
+bool FileSystem::Exists(const std::string& path) const
+{
+	const std::string normalizedPath = NormalizePath(path);
+	for (auto mount = mounts.rbegin(); mount != mounts.rend(); ++mount)
+	{
+		std::string_view relativePath;
+		if (!GetRelativePath(*mount, normalizedPath, relativePath))
+			continue;
+		if (mount->pak != nullptr ? FindEntry(*mount, relativePath) != nullptr :
+			std::filesystem::is_regular_file(std::filesystem::path(mount->directory) / relativePath))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<std::string> FileSystem::List(const std::string& directory) const
+{
+	const std::string normalizedDirectory = NormalizePath(directory);
+	std::vector<std::string> paths;
+	for (auto& mount : mounts)
+	{
+		std::string_view relativeDirectory;
+		if (!GetRelativePath(mount, normalizedDirectory, relativeDirectory))
+			continue;
+		if (mount.pak != nullptr)
+		{
+			//The entries are sorted, the ones of the directory follow each other
+			const std::string prefix = relativeDirectory.empty() ? std::string() : std::string(relativeDirectory) + "/";
+			const PakEntry* end = mount.entries + mount.entryNmb;
+			const PakEntry* entry = std::lower_bound(mount.entries, end, prefix, [&mount](const PakEntry& entry, const std::string& name)
+			{
+				return GetEntryName(entry, mount.strings) < name;
+			});
+			for (; entry != end; ++entry)
+			{
+				const std::string_view name = GetEntryName(*entry, mount.strings);
+				if (name.compare(0, prefix.size(), prefix) != 0)
+					break;
+				const std::string_view fileName = name.substr(prefix.size());
+				if (fileName.find('/') == std::string_view::npos)
+					paths.push_back((std::filesystem::path(normalizedDirectory) / fileName).generic_string());
+			}
+			continue;
+		}
+		std::error_code error;
+		for (auto& file : std::filesystem::directory_iterator(std::filesystem::path(mount.directory) / relativeDirectory, error))
+		{
+			if (file.is_regular_file())
+				paths.push_back((std::filesystem::path(normalizedDirectory) / file.path().filename()).generic_string());
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+	paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+	return paths;
+}
+
+std::future<FileView> FileSystem::ReadAsync(const std::string& path) const
+{
+	return Engine::GetPtr()->GetJobSystem().Schedule([this, path]() { return Read(path); });
+}
@@ -0,0 +1,194 @@
+#include <water.h>
+#include <engine.h>
+
+#include <algorithm>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <Remotery.h>
+
+void Water::Init(float height, const glm::vec2& min, const glm::vec2& max)
+{
+	this->height = height;
+	this->min = min;
+	this->max = max;
+	waterShader.CompileSource(
+		"shaders/engine/water.vert",
+		"shaders/engine/water.frag");
+	dudvMap = stbCreateTexture("data/sprites/waveDUDV.png");
+	normalMap = stbCreateTexture("data/sprites/waveNM.png");
+	glGenVertexArrays(1, &emptyVao);
+	glGenFramebuffers(1, &reflectionFbo);
+	glGenFramebuffers(1, &refractionFbo);
+}
+
+void Water::Destroy()
+{
+	glDeleteTextures(1, &dudvMap);
+	glDeleteTextures(1, &normalMap);
+	glDeleteVertexArrays(1, &emptyVao);
+	glDeleteFramebuffers(1, &reflectionFbo);
+	glDeleteFramebuffers(1, &refractionFbo);
+	glDeleteTextures(1, &reflectionTexture);
+	glDeleteRenderbuffers(1, &reflectionDepth);
+	glDeleteTextures(1, &refractionTexture);
+	glDeleteTextures(1, &refractionDepth);
+	reflectionTexture = 0;
+	reflectionDepth = 0;
+	refractionTexture = 0;
+	refractionDepth = 0;
+	reflectionWidth = reflectionHeight = 0;
+	refractionWidth = refractionHeight = 0;
+	reflectionValid = false;
+}
+
+void Water::ResizeReflection(int width, int height)
+{
+	reflectionWidth = width;
+	reflectionHeight = height;
+	glDeleteTextures(1, &reflectionTexture);
+	glGenTextures(1, &reflectionTexture);
+	glBindTexture(GL_TEXTURE_2D, reflectionTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	//The reflection depth is never sampled
+	glDeleteRenderbuffers(1, &reflectionDepth);
+	glGenRenderbuffers(1, &reflectionDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, reflectionDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, reflectionFbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, reflectionTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, reflectionDepth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "[Error] Water: reflection framebuffer is not complete\n";
+	}
+	reflectionValid = false;
+}
+
+void Water::ResizeRefraction(int width, int height)
+{
+	refractionWidth = width;
+	refractionHeight = height;
+	//HDR like the scene it is copied from
+	const unsigned formats[2] = { GL_RGBA16F, GL_DEPTH24_STENCIL8 };
+	unsigned* textures[2] = { &refractionTexture, &refractionDepth };
+	for (int i = 0; i < 2; i++)
+	{
+		glDeleteTextures(1, textures[i]);
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_2D, *textures[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, refractionFbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, refractionTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, refractionDepth, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "[Error] Water: refraction framebuffer is not complete\n";
+	}
+}
+
+void Water::UpdateReflection(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, const DrawScene& drawScene)
+{
+	Engine* engine = Engine::GetPtr();
+	auto& config = engine->GetConfiguration();
+	auto& dynamicResolution = engine->GetDynamicResolution();
+	//Allocated from the scene target, the render scale only changes the viewport
+	const int width = std::max(1, (int)(dynamicResolution.GetTargetWidth() * reflectionScale));
+	const int height = std::max(1, (int)(dynamicResolution.GetTargetHeight() * reflectionScale));
+	if (width != reflectionWidth || height != reflectionHeight)
+	{
+		ResizeReflection(width, height);
+	}
+	reflectionUpdateNmb = 0;
+	if (reflectionValid && ++framesSinceReflection < reflectionInterval)
+		return;
+	rmt_ScopedOpenGLSample(WaterReflection);
+	framesSinceReflection = 0;
+	reflectionValid = true;
+	reflectionUpdateNmb++;
+	reflectionViewProjection = projection * view;
+	const int viewportWidth = std::clamp((int)(config.renderWidth * reflectionScale), 1, reflectionWidth);
+	const int viewportHeight = std::clamp((int)(config.renderHeight * reflectionScale), 1, reflectionHeight);
+	reflectionUvScale = glm::vec2((float)viewportWidth / reflectionWidth, (float)viewportHeight / reflectionHeight);
+
+	GLint previousFbo = 0;
+	GLint previousViewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFbo);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, reflectionFbo);
+	glViewport(0, 0, viewportWidth, viewportHeight);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	//The scene is mirrored by the plane, a point seen through the water is drawn where the real camera sees its image
+	glm::mat4 mirror = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, this->height, 0.0f));
+	mirror = glm::scale(mirror, glm::vec3(1.0f, -1.0f, 1.0f));
+	mirror = glm::translate(mirror, glm::vec3(0.0f, -this->height, 0.0f));
+	const glm::vec3 mirroredPosition(cameraPosition.x, 2.0f * this->height - cameraPosition.y, cameraPosition.z);
+	//Slightly under the surface so the shore does not show a gap
+	const glm::vec4 clipPlane(0.0f, 1.0f, 0.0f, -this->height + 0.1f);
+	glEnable(GL_CLIP_DISTANCE0);
+	drawScene(view * mirror, projection, mirroredPosition, clipPlane);
+	glDisable(GL_CLIP_DISTANCE0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+void Water::Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float near, float far)
+{
+	rmt_ScopedOpenGLSample(DrawWater);
+	Engine* engine = Engine::GetPtr();
+	auto& config = engine->GetConfiguration();
+	auto& dynamicResolution = engine->GetDynamicResolution();
+	if (dynamicResolution.GetTargetWidth() != refractionWidth || dynamicResolution.GetTargetHeight() != refractionHeight)
+	{
+		ResizeRefraction(dynamicResolution.GetTargetWidth(), dynamicResolution.GetTargetHeight());
+	}
+	const int renderWidth = (int)config.renderWidth;
+	const int renderHeight = (int)config.renderHeight;
+	GLint currentFbo = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &currentFbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, currentFbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, refractionFbo);
+	glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight,
+		GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, currentFbo);
+
+	waterShader.Bind();
+	waterShader.SetMat4("view", view);
+	waterShader.SetMat4("projection", projection);
+	waterShader.SetMat4("reflectionViewProjection", reflectionViewProjection);
+	waterShader.SetVec2("reflectionUvScale", reflectionUvScale);
+	waterShader.SetVec2("refractionUvScale", (float)renderWidth / refractionWidth, (float)renderHeight / refractionHeight);
+	waterShader.SetVec3("cameraPosition", cameraPosition);
+	waterShader.SetFloat("waterHeight", height);
+	waterShader.SetVec2("waterMin", min);
+	waterShader.SetVec2("waterMax", max);
+	waterShader.SetFloat("time", Engine::GetPtr()->GetTimeSinceInit());
+	waterShader.SetFloat("near", near);
+	waterShader.SetFloat("far", far);
+	const char* samplers[5] = { "reflectionTexture", "refractionTexture", "refractionDepth", "dudvMap", "normalMap" };
+	const unsigned textures[5] = { reflectionTexture, refractionTexture, refractionDepth, dudvMap, normalMap };
+	for (int i = 0; i < 5; i++)
+	{
+		waterShader.SetInt(samplers[i], i);
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(emptyVao);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,67 @@
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include <pbr_material.h>
+#include <vfs.h>
+
+//Resolves the shipped texture sets from the loose files then from a pak of them, runs from the source directory
+namespace
+{
+struct ExpectedSet
+{
+	const char* directory;
+	bool color;
+	bool normal;
+};
+
+//PavingStones only ships its AO, roughness and displacement maps
+const ExpectedSet expectedSets[] = {
+	{ "data/textures/EngravedMetal", true, true },
+	{ "data/textures/Metal", true, true },
+	{ "data/textures/PavingStones", false, false },
+};
+
+int CheckSets(const FileSystem& fileSystem, const char* source)
+{
+	int failureNmb = 0;
+	for (auto& expected : expectedSets)
+	{
+		const PbrTextureSet textureSet = FindPbrTextureSet(expected.directory, fileSystem);
+		const bool orm = !textureSet.occlusion.empty() || !textureSet.roughness.empty() || !textureSet.metallic.empty();
+		const std::pair<const char*, bool> checks[] = {
+			{ "albedo", textureSet.color.empty() != expected.color },
+			{ "normal", textureSet.normal.empty() != expected.normal },
+			{ "ORM", orm },
+			{ "height", !textureSet.height.empty() },
+		};
+		for (auto& check : checks)
+		{
+			if (check.second)
+				continue;
+			std::cerr << "[Error] " << source << ": " << check.first << " map of " << expected.directory << " not resolved\n";
+			failureNmb++;
+		}
+	}
+	return failureNmb;
+}
+}
+
+int main()
+{
+	FileSystem looseFileSystem;
+	if (!looseFileSystem.MountDirectory("."))
+		return EXIT_FAILURE;
+	int failureNmb = CheckSets(looseFileSystem, "Loose files");
+
+	const std::string pakPath = (std::filesystem::temp_directory_path() / "PbrTextureSetTest.pak").string();
+	FileSystem pakFileSystem;
+	if (!BuildPak({ "data/textures" }, pakPath) || !pakFileSystem.MountPak(pakPath))
+		return EXIT_FAILURE;
+	failureNmb += CheckSets(pakFileSystem, "Pak");
+	pakFileSystem.UnmountAll();
+	std::filesystem::remove(pakPath);
+	return failureNmb == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
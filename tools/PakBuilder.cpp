@@ -0,0 +1,32 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <vfs.h>
+
+//Packs directories into a pak archive: PakBuilder <output.pak> [--exclude <path>]... <directory>...
+//The entry names are the paths relative to the working directory, so it runs from where the programs run.
+int main(int argc, char** argv)
+{
+	std::vector<std::string> directories;
+	std::vector<std::string> excludedPaths;
+	for (int i = 2; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--exclude" && i + 1 < argc)
+			excludedPaths.push_back(argv[++i]);
+		else
+			directories.push_back(argv[i]);
+	}
+	if (directories.empty())
+	{
+		std::cerr << "[Error] Pak builder: usage PakBuilder <output.pak> [--exclude <path>]... <directory>...\n";
+		return EXIT_FAILURE;
+	}
+	if (!BuildPak(directories, argv[1], excludedPaths))
+	{
+		std::cerr << "[Error] Pak builder: cannot build " << argv[1] << "\n";
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}